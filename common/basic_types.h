@@ -245,12 +245,12 @@ struct basic_tree
 {
     CUDA_CALLABLE_MEMBER
     basic_tree(float x, float y, float radius, float height, float dbh)
-        : x(x), y(y), radius(radius), height(height), dbh(dbh)
+        : x(x), y(y), radius(radius), height(height), dbh(dbh), id(-1)
     {}
 
     CUDA_CALLABLE_MEMBER
     basic_tree()
-        : x(-1), y(-1), radius(-1), height(-1), dbh(-1)
+        : x(-1), y(-1), radius(-1), height(-1), dbh(-1), id(-1)
     {}
 
     bool operator == (const basic_tree &other) const
@@ -284,6 +284,7 @@ struct basic_tree
     float radius;
     float height;
     float dbh;
+    long long id;   // persistent identity across timesteps, -1 if unknown
     // float energy; // seems to be unused at the moment
     int species;
     //std::vector<float> velocity = std::vector<float> (2, 0.0f);
@@ -392,11 +393,27 @@ struct MinimalPlant
 
 namespace basic_types
 {
+    /// rectangle of grid cells [x0, x1) x [y0, y1)
+    struct MapRect
+    {
+        int x0, y0, x1, y1;
+
+        bool empty() const { return x0 >= x1 || y0 >= y1; }
+    };
+
     class MapFloat
     {
     private:
         int gx, gy;                     //< grid dimensions
         std::vector<float> fmap;        //< grid of floating point values
+        long revision = 0;              //< revision of the most recent change
+        std::vector<std::pair<long, MapRect>> changes; //< cells changed at each revision, oldest first, read by any number of consumers
+
+        static const int maxDirtyRects = 64; //< beyond this the change log collapses to its bounding rectangle
+
+        /// revisions are drawn from one counter shared by all maps, so a map allocated where another was freed
+        /// cannot repeat revisions that a consumer of the old map has already seen
+        static long nextRevision(){ static long counter = 0; return ++counter; }
 
 
     public:
@@ -453,21 +470,66 @@ namespace basic_types
         }
 
         /// clear the contents of the grid to empty
-        void initMap(){ fmap.clear(); fmap.resize(gx*gy); }
+        void initMap(){ fmap.clear(); fmap.resize(gx*gy); markAllDirty(); }
 
         /// completely delete map
         void delMap(){ fmap.clear(); }
 
         /// set grass heights to a uniform value
-        void fill(float h){ fmap.clear(); fmap.resize(gx*gy, h); }
+        void fill(float h){ fmap.clear(); fmap.resize(gx*gy, h); markAllDirty(); }
 
         /// getter and setter for map elements
         float get(int x, int y) const { return fmap.at( flatten(x, y) ); }
         float get(int idx) const{ return fmap[idx]; }
         void set(int x, int y, float val){ fmap[flatten(x, y)] = val; }
 
+        /**
+         * @brief markDirty Record that cells in a rectangle have changed. set() does not do this itself, so
+         *                  writers whose results are consumed incrementally (e.g., as texture updates) must call it.
+         * @param r     changed cells, clipped to the grid
+         */
+        void markDirty(MapRect r)
+        {
+            r.x0 = std::max(r.x0, 0); r.y0 = std::max(r.y0, 0);
+            r.x1 = std::min(r.x1, gx); r.y1 = std::min(r.y1, gy);
+            if(r.empty())
+                return;
+            revision = nextRevision();
+            if((int) changes.size() >= maxDirtyRects)
+            {
+                // collapsing to the bounding rectangle of every change keeps the log complete, if less precise
+                for(auto &c: changes)
+                {
+                    r.x0 = std::min(r.x0, c.second.x0); r.y0 = std::min(r.y0, c.second.y0);
+                    r.x1 = std::max(r.x1, c.second.x1); r.y1 = std::max(r.y1, c.second.y1);
+                }
+                changes.clear();
+            }
+            changes.push_back(std::make_pair(revision, r));
+        }
+
+        /// mark the whole grid as changed
+        void markAllDirty(){ revision = nextRevision(); changes.assign(1, std::make_pair(revision, MapRect{0, 0, gx, gy})); }
+
+        /// revision of the most recent change, which a consumer records once it has caught up
+        long getRevision() const { return revision; }
+
+        /**
+         * @brief changedSince  Find the cells changed after a given revision. The log is not consumed, so each reader
+         *                      keeps its own last seen revision.
+         * @param since     revision at which the consumer last caught up
+         * @param rects     changed cells, possibly overlapping, are appended here
+         */
+        void changedSince(long since, std::vector<MapRect> &rects) const
+        {
+            for(auto &c: changes)
+                if(c.first > since)
+                    rects.push_back(c.second);
+        }
+
         /// get pointer to the raw map structure
         float * getPtr(){ return &fmap[0]; }
+        const float * getPtr() const { return &fmap[0]; }
 
         /**
          * @brief read  read a floating point data grid from file
@@ -231,7 +231,8 @@ data_importer::ilanddata::filedata data_importer::ilanddata::read(std::string fi
 		basic_tree tree;
 		
 		int treeid;
-		ss >> treeid;    // TODO: leaving out ID for now, must include it later
+		ss >> treeid;
+		tree.id = treeid; // stable across timesteps, used for incremental updates
 
         ss >> species_id; // alpha-numeric species key
         // std::cerr << "Species ID = " << species_id << std::endl;
@@ -422,7 +423,7 @@ data_importer::ilanddata::filedata data_importer::ilanddata::readbinary(std::str
     {
         basic_tree tree;
 
-        // TODO: leaving out ID for now, must include it later
+        tree.id = Adata[i].treeid; // stable across timesteps, used for incremental updates
 
         std::string species_id; // alpha-numeric species key
         species_id += Adata[i].code[0];
@@ -0,0 +1,286 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "contour.h"
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+
+namespace
+{
+
+/// A piece of contour whose two ends are identified by the grid edge they cross, and the level
+struct Chain
+{
+    int level;                  //< index of the level
+    uint64_t ends[2];           //< keys of the first and last point
+    std::vector<float> xy;      //< interleaved points
+};
+
+/**
+ * Join chains that share end keys into maximal polylines. Every key is shared by at most two chains, since a grid edge
+ * borders two cells, so the chains form paths and cycles. Chains whose ends are left unmatched go to @a open, with
+ * their end keys, and cycles go straight to @a lines.
+ */
+void stitch(std::vector<Chain> & chains, const std::vector<float> & levels, std::vector<Chain> & open,
+            std::vector<ContourLine> & lines)
+{
+    int n = (int) chains.size();
+    std::unordered_map<uint64_t, int> first;    // end (2 * chain + side) that first showed each key
+    std::vector<int> next(2 * n, -1);           // end joined to each end, or -1
+
+    first.reserve(2 * n);
+    for(int e = 0; e < 2 * n; e++)
+    {
+        auto ins = first.insert(std::make_pair(chains[e/2].ends[e%2], e));
+        if(!ins.second && next[ins.first->second] < 0)
+        {
+            next[ins.first->second] = e;
+            next[e] = ins.first->second;
+        }
+    }
+
+    std::vector<bool> used(n, false);
+    auto walk = [&](int start, int side, Chain & out)
+    {
+        // append chains starting at end (start, side), returns when the path ends or comes back to start
+        int c = start, in = side;
+        out.level = chains[c].level;
+        out.ends[0] = chains[c].ends[side];
+        out.xy.clear();
+        while(true)
+        {
+            used[c] = true;
+            const std::vector<float> & pts = chains[c].xy;
+            int np = (int) pts.size() / 2;
+            for(int p = (out.xy.empty() ? 0 : 1); p < np; p++)
+            {
+                int q = (in == 0 ? p : np-1-p);
+                out.xy.push_back(pts[2*q]); out.xy.push_back(pts[2*q+1]);
+            }
+            out.ends[1] = chains[c].ends[1-in];
+            int e = next[2*c + 1-in];
+            if(e < 0)
+                return false;
+            if(e/2 == start)
+                return true;
+            c = e/2; in = e%2;
+        }
+    };
+
+    Chain path;
+    for(int c = 0; c < n; c++)
+        for(int side = 0; side < 2 && !used[c]; side++)
+            if(next[2*c+side] < 0)
+            {
+                walk(c, side, path);
+                open.push_back(path);
+            }
+    for(int c = 0; c < n; c++)
+        if(!used[c])
+        {
+            walk(c, 0, path);
+            ContourLine line;
+            line.level = levels[path.level];
+            line.closed = true;
+            line.xy.swap(path.xy);
+            // the walk returns to its first point, which need not be stored twice
+            if(line.xy.size() >= 4)
+                line.xy.resize(line.xy.size() - 2);
+            lines.push_back(line);
+        }
+}
+
+// marching squares segments for each corner classification, as pairs of cell edges (bottom, right, top, left)
+// terminated by -1; saddles 5 and 10 are resolved separately
+const int segTable[16][5] = {
+    {-1}, {3, 0, -1}, {0, 1, -1}, {3, 1, -1}, {1, 2, -1}, {-1}, {0, 2, -1}, {3, 2, -1},
+    {2, 3, -1}, {0, 2, -1}, {-1}, {1, 2, -1}, {3, 1, -1}, {0, 1, -1}, {3, 0, -1}, {-1}};
+
+} // namespace
+
+std::vector<float> contourLevels(float lo, float hi, float interval)
+{
+    std::vector<float> levels;
+    if(interval <= 0.0f || !(hi >= lo))
+        return levels;
+    for(double k = std::ceil((double) lo / interval); k * interval <= (double) hi; k += 1.0)
+        levels.push_back((float) (k * interval));
+    return levels;
+}
+
+void extractContours(const float * data, int gx, int gy, long xstride, long ystride,
+                     const std::vector<float> & levels, std::vector<ContourLine> & lines)
+{
+    lines.clear();
+    if(gx < 2 || gy < 2 || levels.empty())
+        return;
+
+    const int nlevels = (int) levels.size();
+    const int band = 64;
+    const int nbands = (gy - 1 + band - 1) / band;
+    std::vector<std::vector<Chain>> bandOpen(nbands);
+    std::vector<std::vector<ContourLine>> bandLines(nbands);
+
+    // each grid edge has its own key, horizontal edges even and vertical odd, shared by the cells on either side
+    auto edgeKey = [&](int x, int y, int vertical, int level) -> uint64_t
+    {
+        return ((uint64_t) (2 * ((uint64_t) y * gx + x) + vertical)) * nlevels + level;
+    };
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int b = 0; b < nbands; b++)
+    {
+        int y0 = b * band, y1 = std::min(y0 + band, gy - 1);
+        std::vector<Chain> segs;
+        Chain seg;
+        seg.xy.resize(4);
+
+        for(int y = y0; y < y1; y++)
+            for(int x = 0; x < gx - 1; x++)
+            {
+                const float * p = data + x * xstride + y * ystride;
+                float v[4] = {p[0], p[xstride], p[xstride + ystride], p[ystride]}; // corners anticlockwise from (x, y)
+                if(!std::isfinite(v[0]) || !std::isfinite(v[1]) || !std::isfinite(v[2]) || !std::isfinite(v[3]))
+                    continue;
+                float lo = std::min(std::min(v[0], v[1]), std::min(v[2], v[3]));
+                float hi = std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+
+                // levels crossing the cell are those with lo < level <= hi, as corners at a level count as above it
+                int l0 = (int) (std::upper_bound(levels.begin(), levels.end(), lo) - levels.begin());
+                int l1 = (int) (std::upper_bound(levels.begin(), levels.end(), hi) - levels.begin());
+                for(int l = l0; l < l1; l++)
+                {
+                    float lev = levels[l];
+                    int cs = (v[0] >= lev ? 1 : 0) | (v[1] >= lev ? 2 : 0) | (v[2] >= lev ? 4 : 0) | (v[3] >= lev ? 8 : 0);
+                    int pairs[4], np = 0;
+                    if(cs == 5 || cs == 10)
+                    {
+                        // saddle: join the corners above the level if the cell centre is above it too
+                        bool joined = (0.25f * (v[0] + v[1] + v[2] + v[3]) >= lev);
+                        if((cs == 5) == joined)
+                        { pairs[0] = 0; pairs[1] = 1; pairs[2] = 2; pairs[3] = 3; }
+                        else
+                        { pairs[0] = 3; pairs[1] = 0; pairs[2] = 1; pairs[3] = 2; }
+                        np = 4;
+                    }
+                    else
+                        for(; segTable[cs][np] >= 0; np++)
+                            pairs[np] = segTable[cs][np];
+
+                    for(int s = 0; s < np; s += 2)
+                    {
+                        for(int k = 0; k < 2; k++)
+                        {
+                            // edge e runs from corner e to corner e+1
+                            int e = pairs[s+k], ca = e, cb = (e + 1) % 4;
+                            float t = (lev - v[ca]) / (v[cb] - v[ca]);
+                            float ax = (float) (x + (ca == 1 || ca == 2)), ay = (float) (y + (ca >= 2));
+                            float bx = (float) (x + (cb == 1 || cb == 2)), by = (float) (y + (cb >= 2));
+                            seg.xy[2*k] = ax + t * (bx - ax);
+                            seg.xy[2*k+1] = ay + t * (by - ay);
+                            if(e == 0) seg.ends[k] = edgeKey(x, y, 0, l);
+                            else if(e == 1) seg.ends[k] = edgeKey(x+1, y, 1, l);
+                            else if(e == 2) seg.ends[k] = edgeKey(x, y+1, 0, l);
+                            else seg.ends[k] = edgeKey(x, y, 1, l);
+                        }
+                        seg.level = l;
+                        segs.push_back(seg);
+                    }
+                }
+            }
+
+        // join within the band, leaving paths that reach the band's top or bottom, or the grid border, open
+        stitch(segs, levels, bandOpen[b], bandLines[b]);
+    }
+
+    // join the open paths across bands, and gather everything
+    std::vector<Chain> open, border;
+    for(int b = 0; b < nbands; b++)
+    {
+        open.insert(open.end(), std::make_move_iterator(bandOpen[b].begin()), std::make_move_iterator(bandOpen[b].end()));
+        lines.insert(lines.end(), std::make_move_iterator(bandLines[b].begin()), std::make_move_iterator(bandLines[b].end()));
+    }
+    stitch(open, levels, border, lines);
+    for(auto & c: border)
+    {
+        ContourLine line;
+        line.level = levels[c.level];
+        line.closed = false;
+        line.xy.swap(c.xy);
+        lines.push_back(line);
+    }
+}
+
+bool writeContoursGeoJSON(const std::string & filename, const std::vector<ContourLine> & lines)
+{
+    std::ofstream outfile(filename);
+
+    if(!outfile.is_open())
+    {
+        std::cerr << "Error writeContoursGeoJSON: unable to open " << filename << std::endl;
+        return false;
+    }
+
+    outfile << "{\"type\": \"FeatureCollection\", \"features\": [\n";
+    for(int i = 0; i < (int) lines.size(); i++)
+    {
+        const std::vector<float> & xy = lines[i].xy;
+        outfile << "{\"type\": \"Feature\", \"properties\": {\"level\": " << lines[i].level << "}, ";
+        outfile << "\"geometry\": {\"type\": \"LineString\", \"coordinates\": [";
+        for(int p = 0; p < (int) xy.size() / 2; p++)
+            outfile << (p > 0 ? "," : "") << "[" << xy[2*p] << "," << xy[2*p+1] << "]";
+        if(lines[i].closed && xy.size() >= 2)
+            outfile << ",[" << xy[0] << "," << xy[1] << "]";
+        outfile << "]}}" << (i + 1 < (int) lines.size() ? ",\n" : "\n");
+    }
+    outfile << "]}\n";
+    return (bool) outfile;
+}
+
+bool writeContoursSVG(const std::string & filename, const std::vector<ContourLine> & lines, float width, float height,
+                      float interval, int major)
+{
+    std::ofstream outfile(filename);
+
+    if(!outfile.is_open())
+    {
+        std::cerr << "Error writeContoursSVG: unable to open " << filename << std::endl;
+        return false;
+    }
+
+    float thin = std::max(width, height) / 2000.0f;
+    outfile << "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 " << width << " " << height << "\">\n";
+    outfile << "<g fill=\"none\" stroke=\"#5a3c1e\" stroke-linejoin=\"round\">\n";
+    for(auto & line: lines)
+    {
+        bool heavy = (major > 0 && interval > 0.0f && std::lround(line.level / interval) % major == 0);
+        outfile << (line.closed ? "<polygon" : "<polyline") << " stroke-width=\"" << (heavy ? 2.5f * thin : thin) << "\" points=\"";
+        for(int p = 0; p < (int) line.xy.size() / 2; p++)
+            outfile << (p > 0 ? " " : "") << line.xy[2*p] << "," << line.xy[2*p+1];
+        outfile << "\"><title>" << line.level << "</title></" << (line.closed ? "polygon" : "polyline") << ">\n";
+    }
+    outfile << "</g>\n</svg>\n";
+    return (bool) outfile;
+}
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+/**
+ * @file
+ *
+ * Contour line extraction from scalar grids by marching squares, with vector file export.
+ */
+
+#ifndef UTS_COMMON_CONTOUR_H
+#define UTS_COMMON_CONTOUR_H
+
+#include <vector>
+#include <string>
+
+/// Polyline along which a grid takes a constant value
+struct ContourLine
+{
+    float level;                ///< value along the line
+    bool closed;                ///< true if the last point joins back to the first, which is not repeated
+    std::vector<float> xy;      ///< interleaved x, y coordinates of the points
+};
+
+/**
+ * Values from @a lo up to @a hi at multiples of @a interval, suitable as contour levels
+ * @param lo, hi    range of the data
+ * @param interval  separation of levels, no levels are returned if this is not positive
+ */
+std::vector<float> contourLevels(float lo, float hi, float interval);
+
+/**
+ * Extract the contour lines of a grid at the given levels. Cells are classified by marching squares, with saddles
+ * resolved by the mean of the cell corners, and crossings are placed by linear interpolation along cell edges, so
+ * lines pass through grid coordinates (x, y) with 0 <= x <= gx-1 and 0 <= y <= gy-1. Bands of rows are processed in
+ * parallel, their segments joined into polylines within each band, and polylines then joined across bands. Cells with
+ * a non-finite corner are skipped.
+ *
+ * @param data      grid values, with the value at (x, y) held in data[x * xstride + y * ystride]
+ * @param gx, gy    grid dimensions
+ * @param xstride, ystride  distance between neighbouring values in x and in y
+ * @param levels    contour values, in increasing order
+ * @param[out] lines    the contours of every level, replacing any previous content
+ */
+void extractContours(const float * data, int gx, int gy, long xstride, long ystride,
+                     const std::vector<float> & levels, std::vector<ContourLine> & lines);
+
+/**
+ * Write contours as a GeoJSON feature collection of LineStrings, each with its level as the "level" property.
+ * Closed lines repeat their first point at the end, as GeoJSON expects.
+ * @param filename  file to write
+ * @param lines     contours, in the coordinates to be written
+ * @retval @c true if the file was written
+ */
+bool writeContoursGeoJSON(const std::string & filename, const std::vector<ContourLine> & lines);
+
+/**
+ * Write contours as SVG polylines in a @a width by @a height view box. SVG y runs down the page, so the caller
+ * chooses the orientation of the coordinates. Every @a major th level is drawn heavier, counting from zero.
+ * @param filename  file to write
+ * @param lines     contours, in view box coordinates
+ * @param width, height extent of the view box
+ * @param interval  separation of the levels, used to pick out major lines
+ * @param major     number of intervals between major lines, or 0 for none
+ * @retval @c true if the file was written
+ */
+bool writeContoursSVG(const std::string & filename, const std::vector<ContourLine> & lines, float width, float height,
+                      float interval, int major = 5);
+
+#endif
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "horizon.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+void sweepHorizon(const float * surface, const float * receiver, int gx, int gy, float cell,
+                  float dirx, float diry, float radius, float * tanHorizon)
+{
+    // step one cell along the major axis of the direction, rounding the minor axis per step
+    bool xmajor = (std::fabs(dirx) >= std::fabs(diry));
+    int major = (xmajor ? gx : gy), minor = (xmajor ? gy : gx);
+    int mstep = ((xmajor ? dirx : diry) >= 0.0f ? 1 : -1);
+    float slope = (xmajor ? diry / std::fabs(dirx) : dirx / std::fabs(diry));
+    float dstep = cell * std::sqrt(1.0f + slope * slope);
+    int span = (int) std::ceil(std::fabs(slope) * (float) (major-1)) + 1;
+    std::vector<int> offset(major);
+    for(int t = 0; t < major; t++)
+        offset[t] = (int) std::floor(slope * (float) t + 0.5f);
+
+    // every cell lies on exactly one line, minor = c + offset[t] with t steps from the line start. Neighbouring
+    // lines are advanced together so that successive cells are adjacent in memory whichever the major axis.
+    const int block = 32;
+    int nlines = minor + 2 * span;
+    #pragma omp parallel for schedule(dynamic, 4)
+    for(int b = 0; b < (nlines + block - 1) / block; b++)
+    {
+        int c0 = b * block - span, c1 = std::min(c0 + block, minor + span);
+        std::vector<std::vector<std::pair<float, float>>> hulls(c1 - c0); // upper convex hull of (distance, height) behind the cell
+        std::vector<int> fronts(c1 - c0, 0);                                // hull entries before front are beyond the radius
+
+        for(int t = 0; t < major; t++)
+        {
+            int a = (mstep > 0 ? t : major-1-t);
+            float d = (float) t * dstep;
+            int lo = std::max(c0, -offset[t]), hi = std::min(c1, minor - offset[t]);
+
+            for(int c = lo; c < hi; c++)
+            {
+                std::vector<std::pair<float, float>> & hull = hulls[c - c0];
+                int & front = fronts[c - c0];
+                int m = c + offset[t];
+                long idx = (xmajor ? (long) m * gx + a : (long) a * gx + m);
+                float h = surface[idx];
+
+                if(radius > 0.0f)
+                    while(front < (int) hull.size() && d - hull[front].first > radius)
+                        front++;
+
+                int n = (int) hull.size();
+                float tanh = 0.0f;
+                if(receiver == nullptr)
+                {
+                    // discard hull points that can no longer be the horizon of this or any later cell
+                    while(n - front >= 2 && (hull[n-2].second - h) * (d - hull[n-1].first) >= (hull[n-1].second - h) * (d - hull[n-2].first))
+                        n--;
+                    hull.resize(n);
+                    if(n > front)
+                        tanh = (hull[n-1].second - h) / (d - hull[n-1].first);
+                }
+                else
+                {
+                    // the tangent from a point past the end of a convex chain is unimodal along it
+                    float r = receiver[idx];
+                    int l = front, u = n - 1;
+                    while(l < u)
+                    {
+                        int mid = (l + u) / 2;
+                        if((hull[mid].second - r) * (d - hull[mid+1].first) < (hull[mid+1].second - r) * (d - hull[mid].first))
+                            l = mid + 1;
+                        else
+                            u = mid;
+                    }
+                    if(n > front)
+                        tanh = (hull[l].second - r) / (d - hull[l].first);
+
+                    while(n - front >= 2 && (hull[n-2].second - h) * (d - hull[n-1].first) >= (hull[n-1].second - h) * (d - hull[n-2].first))
+                        n--;
+                    hull.resize(n);
+                }
+                tanHorizon[idx] = std::max(0.0f, tanh);
+
+                hull.push_back(std::make_pair(d, h));
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+/**
+ * @file
+ *
+ * Horizon scanning over row-major height grids, shared by terrain shading and the sun simulator.
+ */
+
+#ifndef UTS_COMMON_HORIZON_H
+#define UTS_COMMON_HORIZON_H
+
+/**
+ * Compute, for every cell of a height grid, the tangent of the elevation angle of the horizon seen when looking
+ * in grid direction (-dirx, -diry). The grid is swept along (dirx, diry) one rasterised line at a time, keeping
+ * the upper convex hull of the height profile already passed, so the cost is linear in the number of cells.
+ * Blocks of neighbouring lines advance together so that reads stay adjacent in memory, and blocks run in parallel.
+ *
+ * @param surface     heights that occlude, gx * gy values with x varying fastest
+ * @param receiver    heights from which the horizon is seen, or nullptr to use @a surface. Passing canopy top
+ *                    heights as @a surface and ground heights here gives the horizon under a canopy.
+ * @param gx, gy      grid dimensions
+ * @param cell        distance between neighbouring grid samples, in the units of the heights
+ * @param dirx, diry  sweep direction, need not be normalised
+ * @param radius      search distance, or unlimited if <= 0. Profile points beyond the radius are dropped from the far
+ *                    end of the hull, so a horizon just inside the radius can be underestimated when it was hidden
+ *                    behind one of them.
+ * @param[out] tanHorizon  gx * gy tangents, clamped below at zero
+ */
+void sweepHorizon(const float * surface, const float * receiver, int gx, int gy, float cell,
+                  float dirx, float diry, float radius, float * tanHorizon);
+
+#endif
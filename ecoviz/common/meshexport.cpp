@@ -0,0 +1,407 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "meshexport.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+
+/**
+ * Write @a n items in order, formatted by fill(first, count, buffer) into chunks that are filled in parallel a round
+ * at a time, so memory stays bounded however large the mesh.
+ */
+template<typename Fill>
+bool writeChunked(std::ofstream & out, int64_t n, Fill fill)
+{
+    const int chunk = 1 << 14, round = 64;
+    std::vector<std::vector<char>> bufs(round);
+
+    for(int64_t r = 0; r < n; r += (int64_t) chunk * round)
+    {
+        int nc = (int) std::min<int64_t>(round, (n - r + chunk - 1) / chunk);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(int c = 0; c < nc; c++)
+        {
+            int64_t first = r + (int64_t) c * chunk;
+            fill(first, (int) std::min<int64_t>(chunk, n - first), bufs[c]);
+        }
+        for(int c = 0; c < nc; c++)
+            out.write(bufs[c].data(), (std::streamsize) bufs[c].size());
+    }
+    return (bool) out;
+}
+
+/// Append the shortest text that reads back as @a v, with a leading separator
+inline char * putFloat(char * p, float v)
+{
+    *p++ = ' ';
+    return std::to_chars(p, p + 24, v).ptr;
+}
+
+/// Append "i/i/i" for one-based index @a i, with a leading separator
+inline char * putCorner(char * p, uint32_t i)
+{
+    char * s = p + 1;
+    *p = ' ';
+    p = std::to_chars(s, s + 10, i).ptr;
+    long len = p - s;
+    *p++ = '/';
+    std::memcpy(p, s, len); p += len;
+    *p++ = '/';
+    std::memcpy(p, s, len); p += len;
+    return p;
+}
+
+const int tileCells = 256;              // cells along a triangulation tile, a power of two
+const int tileSize = tileCells + 1;     // vertices along a triangulation tile
+
+/// Part of a height grid triangulated as a unit, which may extend beyond the grid at the far edges
+struct Tile
+{
+    const float * data;
+    int gx, gy;
+    long xstride, ystride;
+    int ox, oy;         // grid position of the tile's first vertex
+
+    bool inside(int x, int y) const { return ox + x < gx && oy + y < gy; }
+    bool border(int x, int y) const { return ox + x == 0 || oy + y == 0 || ox + x == gx-1 || oy + y == gy-1; }
+    float height(int x, int y) const { return data[(long) (ox + x) * xstride + (long) (oy + y) * ystride]; }
+};
+
+/// Triangle of a tile, as local vertex indices y * tileSize + x
+struct TileTriangle
+{
+    int a, b, c;        // hypotenuse ends and right angle
+    int m;              // hypotenuse midpoint
+    int left, right;    // hypotenuse midpoints of the two children
+};
+
+/**
+ * Every triangle of the tile hierarchy, numbered breadth first from the two halves of the tile, so that children
+ * always come after their parents. The hierarchy is the same for every tile, so it is decoded once.
+ */
+const std::vector<TileTriangle> & tileTriangles()
+{
+    static const std::vector<TileTriangle> table = []()
+    {
+        std::vector<TileTriangle> tris(tileCells * tileCells * 2 - 2);
+        for(int i = 0; i < (int) tris.size(); i++)
+        {
+            // the bits of the id below the leading one trace the path of halvings from the top triangle
+            int id = i + 2;
+            int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+            if(id & 1)
+                bx = by = cx = tileCells;
+            else
+                ax = ay = cy = tileCells;
+            while((id >>= 1) > 1)
+            {
+                int mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+                if(id & 1)
+                { bx = ax; by = ay; ax = cx; ay = cy; }
+                else
+                { ax = bx; ay = by; bx = cx; by = cy; }
+                cx = mx; cy = my;
+            }
+            TileTriangle & t = tris[i];
+            t.a = ay * tileSize + ax; t.b = by * tileSize + bx; t.c = cy * tileSize + cx;
+            t.m = ((ay + by) >> 1) * tileSize + ((ax + bx) >> 1);
+            t.left = ((ay + cy) >> 1) * tileSize + ((ax + cx) >> 1);
+            t.right = ((by + cy) >> 1) * tileSize + ((bx + cx) >> 1);
+        }
+        return tris;
+    }();
+    return table;
+}
+
+/**
+ * Accumulate into @a errors the interpolation error at the hypotenuse midpoint of every triangle in the tile, maxed
+ * with the errors of its descendants so that a triangle is split whenever any descendant must be. Values already in
+ * @a errors are kept if larger, which is how tile edges are made to agree. Triangles reaching beyond the grid, or
+ * splitting a border edge, are given an error that always forces a split.
+ * @param heights   workspace for the tile heights
+ */
+void tileErrors(const Tile & t, std::vector<float> & heights, std::vector<float> & errors)
+{
+    const std::vector<TileTriangle> & tris = tileTriangles();
+    const int numParents = (int) tris.size() - tileCells * tileCells;
+
+    // heights beyond the grid are NaN, which poisons the error of any triangle that reaches them
+    for(int y = 0; y < tileSize; y++)
+        for(int x = 0; x < tileSize; x++)
+        {
+            bool in = t.inside(x, y);
+            heights[y * tileSize + x] = (in ? t.height(x, y) : std::numeric_limits<float>::quiet_NaN());
+            if(in && t.border(x, y))
+                errors[y * tileSize + x] = FLT_MAX;
+        }
+
+    // children are processed before their parents
+    for(int i = (int) tris.size() - 1; i >= 0; i--)
+    {
+        const TileTriangle & tri = tris[i];
+        float ha = heights[tri.a], hb = heights[tri.b];
+        float err = std::fabs(0.5f * (ha + hb) - heights[tri.m]);
+        if(std::isnan(err + heights[tri.c]))
+            err = FLT_MAX;
+
+        float & e = errors[tri.m];
+        e = std::max(e, err);
+        if(i < numParents)
+            e = std::max(e, std::max(errors[tri.left], errors[tri.right]));
+    }
+}
+
+/// Emit the triangle (a, b, c), with right angle at c, or its descendants where the error bound requires
+void tileEmit(const Tile & t, const std::vector<float> & errors, float maxError,
+              int ax, int ay, int bx, int by, int cx, int cy, std::vector<uint32_t> & tris)
+{
+    if(t.ox + std::min(ax, std::min(bx, cx)) > t.gx-1 || t.oy + std::min(ay, std::min(by, cy)) > t.gy-1)
+        return;
+
+    int mx = (ax + bx) >> 1, my = (ay + by) >> 1;
+    if(std::abs(ax - cx) + std::abs(ay - cy) > 1 && errors[my * tileSize + mx] > maxError)
+    {
+        tileEmit(t, errors, maxError, cx, cy, ax, ay, mx, my, tris);
+        tileEmit(t, errors, maxError, bx, by, cx, cy, mx, my, tris);
+        return;
+    }
+
+    // only unit triangles can remain that reach beyond the grid
+    if(!t.inside(ax, ay) || !t.inside(bx, by) || !t.inside(cx, cy))
+        return;
+    if((bx - ax) * (cy - ay) - (by - ay) * (cx - ax) < 0)
+    {
+        std::swap(bx, cx); std::swap(by, cy);
+    }
+    tris.push_back((uint32_t) ((t.oy + ay) * (int64_t) t.gx + t.ox + ax));
+    tris.push_back((uint32_t) ((t.oy + by) * (int64_t) t.gx + t.ox + bx));
+    tris.push_back((uint32_t) ((t.oy + cy) * (int64_t) t.gx + t.ox + cx));
+}
+
+} // namespace
+
+bool writeMeshOBJ(const std::string & filename, const MeshSource & mesh)
+{
+    std::ofstream outfile(filename, std::ios_base::out | std::ios_base::binary);
+
+    if(!outfile.is_open())
+    {
+        std::cerr << "Error writeMeshOBJ: unable to open file " << filename << std::endl;
+        return false;
+    }
+
+    // each vertex writes its v, vn and vt lines together, which keeps their indices aligned
+    bool ok = writeChunked(outfile, mesh.vertexCount(), [&mesh](int64_t first, int count, std::vector<char> & buf)
+    {
+        std::vector<float> pos(3 * count), nrm(3 * count), uv(2 * count);
+        mesh.getVertices(first, count, pos.data(), nrm.data(), uv.data());
+        buf.resize((size_t) count * 192);
+        char * p = buf.data();
+        for(int i = 0; i < count; i++)
+        {
+            *p++ = 'v';
+            for(int k = 0; k < 3; k++)
+                p = putFloat(p, pos[3*i+k]);
+            *p++ = '\n'; *p++ = 'v'; *p++ = 'n';
+            for(int k = 0; k < 3; k++)
+                p = putFloat(p, nrm[3*i+k]);
+            *p++ = '\n'; *p++ = 'v'; *p++ = 't';
+            for(int k = 0; k < 2; k++)
+                p = putFloat(p, uv[2*i+k]);
+            *p++ = '\n';
+        }
+        buf.resize(p - buf.data());
+    });
+
+    ok = ok && writeChunked(outfile, mesh.faceCount(), [&mesh](int64_t first, int count, std::vector<char> & buf)
+    {
+        std::vector<uint32_t> idx(3 * count);
+        mesh.getFaces(first, count, idx.data());
+        buf.resize((size_t) count * 112);
+        char * p = buf.data();
+        for(int i = 0; i < count; i++)
+        {
+            *p++ = 'f';
+            for(int k = 0; k < 3; k++)
+                p = putCorner(p, idx[3*i+k] + 1);
+            *p++ = '\n';
+        }
+        buf.resize(p - buf.data());
+    });
+
+    if(!ok)
+        std::cerr << "Error writeMeshOBJ: failed writing " << filename << std::endl;
+    return ok;
+}
+
+bool writeMeshPLY(const std::string & filename, const MeshSource & mesh)
+{
+    std::ofstream outfile(filename, std::ios_base::out | std::ios_base::binary);
+
+    if(!outfile.is_open())
+    {
+        std::cerr << "Error writeMeshPLY: unable to open file " << filename << std::endl;
+        return false;
+    }
+
+    const uint16_t probe = 1;
+    bool little = (*(const uint8_t *) &probe == 1);
+    outfile << "ply\nformat " << (little ? "binary_little_endian" : "binary_big_endian") << " 1.0\n";
+    outfile << "element vertex " << mesh.vertexCount() << "\n";
+    outfile << "property float x\nproperty float y\nproperty float z\n";
+    outfile << "property float nx\nproperty float ny\nproperty float nz\n";
+    outfile << "property float u\nproperty float v\n";
+    outfile << "element face " << mesh.faceCount() << "\n";
+    outfile << "property list uchar uint vertex_indices\nend_header\n";
+
+    bool ok = writeChunked(outfile, mesh.vertexCount(), [&mesh](int64_t first, int count, std::vector<char> & buf)
+    {
+        std::vector<float> pos(3 * count), nrm(3 * count), uv(2 * count);
+        mesh.getVertices(first, count, pos.data(), nrm.data(), uv.data());
+        buf.resize((size_t) count * 8 * sizeof(float));
+        char * p = buf.data();
+        for(int i = 0; i < count; i++)
+        {
+            std::memcpy(p, &pos[3*i], 3 * sizeof(float)); p += 3 * sizeof(float);
+            std::memcpy(p, &nrm[3*i], 3 * sizeof(float)); p += 3 * sizeof(float);
+            std::memcpy(p, &uv[2*i], 2 * sizeof(float)); p += 2 * sizeof(float);
+        }
+    });
+
+    ok = ok && writeChunked(outfile, mesh.faceCount(), [&mesh](int64_t first, int count, std::vector<char> & buf)
+    {
+        std::vector<uint32_t> idx(3 * count);
+        mesh.getFaces(first, count, idx.data());
+        buf.resize((size_t) count * (1 + 3 * sizeof(uint32_t)));
+        char * p = buf.data();
+        for(int i = 0; i < count; i++)
+        {
+            *p++ = 3;
+            std::memcpy(p, &idx[3*i], 3 * sizeof(uint32_t)); p += 3 * sizeof(uint32_t);
+        }
+    });
+
+    if(!ok)
+        std::cerr << "Error writeMeshPLY: failed writing " << filename << std::endl;
+    return ok;
+}
+
+bool writeMesh(const std::string & filename, const MeshSource & mesh)
+{
+    std::string ext = filename.substr(filename.find_last_of('.') == std::string::npos ? filename.size() : filename.find_last_of('.'));
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return (char) std::tolower(c); });
+    if(ext == ".ply")
+        return writeMeshPLY(filename, mesh);
+    return writeMeshOBJ(filename, mesh);
+}
+
+void triangulateGrid(const float * data, int gx, int gy, long xstride, long ystride, float maxError,
+                     std::vector<uint32_t> & verts, std::vector<uint32_t> & tris)
+{
+    verts.clear();
+    tris.clear();
+    if(gx < 2 || gy < 2)
+        return;
+
+    const int ntx = (gx - 2) / tileCells + 1, nty = (gy - 2) / tileCells + 1, ntiles = ntx * nty;
+    auto makeTile = [&](int i) { return Tile{data, gx, gy, xstride, ystride, (i % ntx) * tileCells, (i / ntx) * tileCells}; };
+
+    // first pass: the errors each tile finds along its own left, right, bottom and top edges
+    std::vector<float> edges((size_t) ntiles * 4 * tileSize);
+    #pragma omp parallel
+    {
+        std::vector<float> heights(tileSize * tileSize), errors(tileSize * tileSize);
+        #pragma omp for schedule(dynamic, 1)
+        for(int i = 0; i < ntiles; i++)
+        {
+            std::fill(errors.begin(), errors.end(), 0.0f);
+            tileErrors(makeTile(i), heights, errors);
+            float * e = &edges[(size_t) i * 4 * tileSize];
+            for(int k = 0; k < tileSize; k++)
+            {
+                e[k] = errors[k * tileSize];
+                e[tileSize + k] = errors[k * tileSize + tileCells];
+                e[2 * tileSize + k] = errors[k];
+                e[3 * tileSize + k] = errors[tileCells * tileSize + k];
+            }
+        }
+    }
+
+    // second pass: seed each tile with its neighbours' errors along shared edges, so both sides split alike, then emit
+    std::vector<std::vector<uint32_t>> tileTris(ntiles);
+    #pragma omp parallel
+    {
+        std::vector<float> heights(tileSize * tileSize), errors(tileSize * tileSize);
+        #pragma omp for schedule(dynamic, 1)
+        for(int i = 0; i < ntiles; i++)
+        {
+            int tx = i % ntx, ty = i / ntx;
+            std::fill(errors.begin(), errors.end(), 0.0f);
+            for(int k = 0; k < tileSize; k++)
+            {
+                if(tx > 0)
+                    errors[k * tileSize] = edges[(size_t) (i - 1) * 4 * tileSize + tileSize + k];
+                if(tx < ntx - 1)
+                    errors[k * tileSize + tileCells] = edges[(size_t) (i + 1) * 4 * tileSize + k];
+                if(ty > 0)
+                    errors[k] = std::max(errors[k], edges[(size_t) (i - ntx) * 4 * tileSize + 3 * tileSize + k]);
+                if(ty < nty - 1)
+                    errors[tileCells * tileSize + k] = std::max(errors[tileCells * tileSize + k], edges[(size_t) (i + ntx) * 4 * tileSize + 2 * tileSize + k]);
+            }
+            Tile t = makeTile(i);
+            tileErrors(t, heights, errors);
+            tileEmit(t, errors, maxError, 0, 0, tileCells, tileCells, tileCells, 0, tileTris[i]);
+            tileEmit(t, errors, maxError, tileCells, tileCells, 0, 0, 0, tileCells, tileTris[i]);
+        }
+    }
+
+    // number the vertices in use in grid order, and refer the triangles to them
+    std::vector<uint8_t> used((size_t) gx * gy, 0);
+    size_t ntris = 0;
+    for(auto & tt: tileTris)
+    {
+        for(uint32_t v: tt)
+            used[v] = 1;
+        ntris += tt.size();
+    }
+    for(size_t v = 0; v < used.size(); v++)
+        if(used[v])
+            verts.push_back((uint32_t) v);
+    tris.reserve(ntris);
+    for(auto & tt: tileTris)
+    {
+        tris.insert(tris.end(), tt.begin(), tt.end());
+        std::vector<uint32_t>().swap(tt);
+    }
+    #pragma omp parallel for
+    for(long i = 0; i < (long) tris.size(); i++)
+        tris[i] = (uint32_t) (std::lower_bound(verts.begin(), verts.end(), tris[i]) - verts.begin());
+}
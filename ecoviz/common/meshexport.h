@@ -0,0 +1,100 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+/**
+ * @file
+ *
+ * Streaming triangle mesh export to OBJ and binary PLY, and error-bounded triangulation of height grids.
+ */
+
+#ifndef UTS_COMMON_MESHEXPORT_H
+#define UTS_COMMON_MESHEXPORT_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+ * Triangle mesh supplied to the writers in consecutive batches, so that large meshes need not be held in memory.
+ * The batch functions are called concurrently from several threads and must be safe to do so.
+ */
+class MeshSource
+{
+public:
+    virtual ~MeshSource(){}
+
+    virtual int64_t vertexCount() const = 0;
+    virtual int64_t faceCount() const = 0;
+
+    /**
+     * Fill attributes of vertices [first, first + count)
+     * @param[out] pos  3 * count position coordinates
+     * @param[out] nrm  3 * count normal coordinates
+     * @param[out] uv   2 * count texture coordinates
+     */
+    virtual void getVertices(int64_t first, int count, float * pos, float * nrm, float * uv) const = 0;
+
+    /**
+     * Fill the corners of triangles [first, first + count)
+     * @param[out] idx  3 * count zero-based vertex indices
+     */
+    virtual void getFaces(int64_t first, int count, uint32_t * idx) const = 0;
+};
+
+/**
+ * Write a mesh as Wavefront OBJ, with every vertex carrying a position, normal and texture coordinate under the same
+ * index. Lines are formatted into per-chunk buffers in parallel and written in order.
+ * @param filename  file to write
+ * @param mesh      mesh to write
+ * @retval @c true if the file was written
+ */
+bool writeMeshOBJ(const std::string & filename, const MeshSource & mesh);
+
+/**
+ * Write a mesh as binary PLY in the byte order of the host, with vertex properties x, y, z, nx, ny, nz, u, v and
+ * triangles as vertex_indices lists. Records are packed into per-chunk buffers in parallel and written in order.
+ * @param filename  file to write
+ * @param mesh      mesh to write
+ * @retval @c true if the file was written
+ */
+bool writeMeshPLY(const std::string & filename, const MeshSource & mesh);
+
+/// Write binary PLY if @a filename ends in .ply, otherwise OBJ
+bool writeMesh(const std::string & filename, const MeshSource & mesh);
+
+/**
+ * Triangulate a height grid with right-angled triangles of varying size (RTIN). A triangle is split while the height
+ * at the midpoint of its hypotenuse, or of any hypotenuse within it, is further than @a maxError from the mean of
+ * that hypotenuse's ends. This bounds the error level by level rather than against the final surface, so heights
+ * can deviate a little more than @a maxError, typically by up to a third more. The grid is processed in tiles in
+ * parallel, with errors on shared tile edges made to agree so that the mesh has no cracks. Edges along the grid
+ * border are kept at full resolution, so the mesh meets skirts or neighbouring exports built from the border heights.
+ *
+ * @param data      grid heights, with the height at (x, y) held in data[x * xstride + y * ystride]
+ * @param gx, gy    grid dimensions
+ * @param xstride, ystride  distance between neighbouring heights in x and in y
+ * @param maxError  vertical deviation allowed at hypotenuse midpoints
+ * @param[out] verts    grid vertices used, as y * gx + x in increasing order
+ * @param[out] tris     triangles as index triples into @a verts, anticlockwise in (x, y)
+ */
+void triangulateGrid(const float * data, int gx, int gy, long xstride, long ystride, float maxError,
+                     std::vector<uint32_t> & verts, std::vector<uint32_t> & tris);
+
+#endif
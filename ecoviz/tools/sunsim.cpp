@@ -0,0 +1,446 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+/*
+Headless solar irradiance simulator, producing the monthly sun maps read by abiotic_maps_package.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "common/horizon.h"
+#include "data_importer/data_importer.h"
+
+using namespace std;
+
+// For each month the sun is traced across the 15th from sunrise to sunset. Each sun position takes the nearest of
+// a fixed set of horizon directions, and every direction is swept over the grid once, so the cost is one horizon
+// sweep per direction plus a vectorisable pass per direction and month. Irradiance follows a clear-sky model:
+// beam from Meinel's attenuation with Kasten-Young air mass and isotropic diffuse at a tenth of the beam, scaled
+// by a clearness factor. With a canopy height model, light that clears the terrain but not the canopy is
+// attenuated by the canopy transmittance rather than blocked, as is all light reaching a cell under a crown.
+//
+// Switches:
+// -l <float>      --- latitude in degrees, positive north (required)
+// -c <string>     --- canopy height model (width height step, then heights), enables canopy shading
+// -t <float>      --- canopy transmittance (default 0.1)
+// -a <float>      --- compass bearing of the grid +y axis in degrees (default 0, +y is north and +x east)
+// -n <int>        --- number of horizon directions (default 32)
+// -r <float>      --- horizon search radius in metres (default unlimited)
+// -s <float>      --- sun path sampling interval in minutes (default 15)
+// -k <float>      --- clearness factor applied to beam and diffuse irradiance (default 1)
+// -u <string>     --- also write monthly mean hours of unobstructed direct sun per day
+// Output is the mean daily irradiation for each month in kWh/m^2, as a text (.txt) or binary (.bin) monthly map.
+
+struct SunParams
+{
+    float latitude = 0.0f;
+    bool haveLatitude = false;
+    float transmittance = 0.1f;
+    float bearing = 0.0f;
+    int ndirs = 32;
+    float radius = 0.0f;
+    float interval = 15.0f;
+    float clearness = 1.0f;
+    string chmfile, hoursfile;
+};
+
+/// One sun position, with its irradiance weighted by the time it represents
+struct SunSample
+{
+    int month;
+    float sx, sy, sz;   //< unit vector towards the sun in grid coordinates, z up
+    float tanElev;      //< tangent of the sun elevation
+    float beam;         //< beam normal irradiation in Wh/m^2
+    float hours;        //< time represented
+};
+
+// ** helper functions
+void printUsage(void);
+void printError(const string & s);
+bool loadElevation(const string & fname, int & gx, int & gy, float & step, vector<float> & hght);
+bool loadCanopy(const string & fname, int gx, int gy, vector<float> & chm);
+void sunPath(const SunParams & par, vector<SunSample> & samples, float diffuse[12]);
+void simulate(const SunParams & par, int gx, int gy, float step, const vector<float> & hght, const vector<float> & chm,
+              vector<ValueGridMap<float>> & irradiance, vector<ValueGridMap<float>> & hours);
+void writeMonthly(const string & fname, const vector<ValueGridMap<float>> & months);
+
+
+int main(int argc, char *argv[])
+{
+    SunParams par;
+    vector<string> args;
+
+    for(int a = 1; a < argc; a++)
+    {
+        string opt = argv[a];
+        if(opt.size() == 2 && opt[0] == '-' && a+1 < argc)
+        {
+            string val = argv[++a];
+            switch(opt[1])
+            {
+                case 'l': par.latitude = stof(val); par.haveLatitude = true; break;
+                case 'c': par.chmfile = val; break;
+                case 't': par.transmittance = stof(val); break;
+                case 'a': par.bearing = stof(val); break;
+                case 'n': par.ndirs = stoi(val); break;
+                case 'r': par.radius = stof(val); break;
+                case 's': par.interval = stof(val); break;
+                case 'k': par.clearness = stof(val); break;
+                case 'u': par.hoursfile = val; break;
+                default: printUsage(); return 1;
+            }
+        }
+        else
+            args.push_back(opt);
+    }
+
+    if(!par.haveLatitude || par.ndirs < 4 || par.interval <= 0.0f || (args.size() != 1 && args.size() != 2))
+    {
+        printUsage();
+        return 1;
+    }
+
+    // a single argument is a data directory, from which the DEM, CHM and output names follow
+    string demfile, outfile, treefile;
+    if(args.size() == 1)
+    {
+        data_importer::data_dir ddir(args[0], 0);
+        demfile = ddir.dem_fname;
+        if(ifstream(demfile + "b").is_open())
+            demfile += "b";
+        outfile = ddir.dirname + "/" + ddir.dataset_name + "_sun_landscape.bin";
+        if(par.chmfile.empty() && ifstream(ddir.chm_fname).is_open())
+            par.chmfile = ddir.chm_fname;
+        if(!par.chmfile.empty())
+            treefile = ddir.dirname + "/" + ddir.dataset_name + "_sun.bin";
+    }
+    else
+    {
+        demfile = args[0];
+        outfile = args[1];
+    }
+
+    int gx, gy;
+    float step;
+    vector<float> hght, chm;
+    if(!loadElevation(demfile, gx, gy, step, hght))
+        return 1;
+    if(!par.chmfile.empty() && !loadCanopy(par.chmfile, gx, gy, chm))
+        return 1;
+    cerr << "sunsim: " << gx << " x " << gy << " grid, " << step << " m cells" << (chm.empty() ? "" : ", with canopy") << endl;
+
+    vector<ValueGridMap<float>> irradiance, hours;
+    try
+    {
+        if(!treefile.empty())
+        {
+            // the landscape map ignores the canopy, the tree map includes it
+            vector<float> nocanopy;
+            simulate(par, gx, gy, step, hght, nocanopy, irradiance, hours);
+            writeMonthly(outfile, irradiance);
+            simulate(par, gx, gy, step, hght, chm, irradiance, hours);
+            writeMonthly(treefile, irradiance);
+        }
+        else
+        {
+            simulate(par, gx, gy, step, hght, chm, irradiance, hours);
+            writeMonthly(outfile, irradiance);
+        }
+        if(!par.hoursfile.empty())
+            writeMonthly(par.hoursfile, hours);
+    }
+    catch(std::exception & e)
+    {
+        printError(e.what());
+        return 1;
+    }
+    return 0;
+}
+
+void printUsage(void)
+{
+    cerr << "Usage: sunsim -l <latitude> [options] <elevation file> <output monthly map>" << endl;
+    cerr << "       sunsim -l <latitude> [options] <data directory>" << endl;
+    cerr << "The elevation file is .elv (text) or .elvb (binary). The output is .txt or .bin, holding the mean daily" << endl;
+    cerr << "irradiation in kWh/m^2 for each month. Given a data directory, <name>_sun_landscape.bin is written and," << endl;
+    cerr << "if <name>.chm exists or -c is given, <name>_sun.bin with canopy shading." << endl;
+    cerr << "Options:" << endl;
+    cerr << "  -c <file>   canopy height model (width height step, then heights)" << endl;
+    cerr << "  -t <frac>   canopy transmittance (default 0.1)" << endl;
+    cerr << "  -a <deg>    compass bearing of the grid +y axis (default 0)" << endl;
+    cerr << "  -n <int>    number of horizon directions (default 32)" << endl;
+    cerr << "  -r <m>      horizon search radius (default unlimited)" << endl;
+    cerr << "  -s <min>    sun path sampling interval (default 15)" << endl;
+    cerr << "  -k <frac>   clearness factor (default 1)" << endl;
+    cerr << "  -u <file>   also write monthly mean hours of unobstructed direct sun per day" << endl;
+}
+
+void printError(const string & s)
+{
+    cerr << "sunsim: " << s << endl;
+}
+
+bool loadElevation(const string & fname, int & gx, int & gy, float & step, vector<float> & hght)
+{
+    long locx, locy;
+    bool binary = (fname.size() > 5 && fname.substr(fname.size()-5) == ".elvb");
+    ifstream infile(fname, binary ? ios::binary : ios::in);
+
+    if(!infile.is_open())
+    {
+        printError("unable to open elevation file " + fname);
+        return false;
+    }
+
+    // both formats list heights with x varying slowest, see Terrain::loadElv
+    vector<float> raw;
+    if(binary)
+    {
+        infile.read(reinterpret_cast<char*>(&gx), sizeof(int));
+        infile.read(reinterpret_cast<char*>(&gy), sizeof(int));
+        infile.read(reinterpret_cast<char*>(&step), sizeof(float));
+        infile.read(reinterpret_cast<char*>(&locx), sizeof(long));
+        infile.read(reinterpret_cast<char*>(&locy), sizeof(long));
+        raw.resize((size_t) gx * gy);
+        infile.read(reinterpret_cast<char*>(raw.data()), raw.size() * sizeof(float));
+    }
+    else
+    {
+        infile >> gx >> gy >> step >> locx >> locy;
+        raw.resize((size_t) gx * gy);
+        for(auto & v: raw)
+            infile >> v;
+    }
+    if(!infile || gx < 2 || gy < 2 || step <= 0.0f)
+    {
+        printError("malformed elevation file " + fname);
+        return false;
+    }
+
+    hght.resize(raw.size());
+    size_t ct = 0;
+    for(int x = 0; x < gx; x++)
+        for(int y = 0; y < gy; y++)
+            hght[(size_t) y * gx + x] = raw[ct++];
+    return true;
+}
+
+bool loadCanopy(const string & fname, int gx, int gy, vector<float> & chm)
+{
+    ValueGridMap<float> cmap;
+    int cx, cy;
+
+    try
+    {
+        cmap = data_importer::load_txt<ValueGridMap<float>>(fname);
+    }
+    catch(std::exception & e)
+    {
+        printError(e.what());
+        return false;
+    }
+
+    // resample to the elevation grid by nearest cell if the resolutions differ
+    cmap.getDim(cx, cy);
+    if(cx < 1 || cy < 1)
+    {
+        printError("empty canopy height model " + fname);
+        return false;
+    }
+    chm.resize((size_t) gx * gy);
+    for(int y = 0; y < gy; y++)
+        for(int x = 0; x < gx; x++)
+        {
+            int sx = std::min(cx-1, (int) ((long) x * cx / gx)), sy = std::min(cy-1, (int) ((long) y * cy / gy));
+            chm[(size_t) y * gx + x] = std::max(0.0f, cmap.get(sx, sy));
+        }
+    return true;
+}
+
+void sunPath(const SunParams & par, vector<SunSample> & samples, float diffuse[12])
+{
+    const int monthStart[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+    const float deg2rad = (float) M_PI / 180.0f;
+    float lat = par.latitude * deg2rad, bear = par.bearing * deg2rad;
+    float dt = par.interval / 60.0f;
+
+    samples.clear();
+    for(int m = 0; m < 12; m++)
+    {
+        diffuse[m] = 0.0f;
+        int day = monthStart[m] + 15;
+        float decl = 23.44f * deg2rad * sinf(2.0f * (float) M_PI * (284.0f + (float) day) / 365.0f);
+
+        // hour angle runs from -12h to 12h, stepping through the middle of each interval
+        for(float hour = -12.0f + 0.5f * dt; hour < 12.0f; hour += dt)
+        {
+            float omega = hour * 15.0f * deg2rad;
+            float up = sinf(lat) * sinf(decl) + cosf(lat) * cosf(decl) * cosf(omega);
+            if(up <= 0.0f)
+                continue;
+            float east = -cosf(decl) * sinf(omega);
+            float north = sinf(decl) * cosf(lat) - cosf(decl) * cosf(omega) * sinf(lat);
+
+            float elev = asinf(up) / deg2rad;
+            float airmass = 1.0f / (up + 0.50572f * powf(elev + 6.07995f, -1.6364f));
+            float dni = par.clearness * 1353.0f * powf(0.7f, powf(airmass, 0.678f));
+
+            SunSample s;
+            s.month = m;
+            s.sx = east * cosf(bear) - north * sinf(bear);
+            s.sy = east * sinf(bear) + north * cosf(bear);
+            s.sz = up;
+            s.tanElev = up / std::max(1e-6f, sqrtf(s.sx * s.sx + s.sy * s.sy));
+            s.beam = dni * dt;
+            s.hours = dt;
+            samples.push_back(s);
+            diffuse[m] += 0.1f * dni * up * dt;
+        }
+    }
+}
+
+void simulate(const SunParams & par, int gx, int gy, float step, const vector<float> & hght, const vector<float> & chm,
+              vector<ValueGridMap<float>> & irradiance, vector<ValueGridMap<float>> & hours)
+{
+    vector<SunSample> samples;
+    float diffuse[12];
+    long ncells = (long) gx * gy;
+    bool canopy = !chm.empty();
+    float tau = par.transmittance;
+
+    sunPath(par, samples, diffuse);
+
+    irradiance.assign(12, ValueGridMap<float>());
+    hours.assign(12, ValueGridMap<float>());
+    for(int m = 0; m < 12; m++)
+    {
+        irradiance[m].setDim(gx, gy);
+        irradiance[m].setDimReal(gx * step, gy * step);
+        irradiance[m].fill(0.0f);
+        hours[m].setDim(gx, gy);
+        hours[m].setDimReal(gx * step, gy * step);
+        hours[m].fill(0.0f);
+    }
+
+    // unit normals from central differences, one sided on the border
+    vector<float> nx(ncells), ny(ncells), nz(ncells);
+    #pragma omp parallel for
+    for(int y = 0; y < gy; y++)
+        for(int x = 0; x < gx; x++)
+        {
+            int xm = std::max(x-1, 0), xp = std::min(x+1, gx-1), ym = std::max(y-1, 0), yp = std::min(y+1, gy-1);
+            float dhdx = (hght[(size_t) y*gx+xp] - hght[(size_t) y*gx+xm]) / (step * (float) (xp-xm));
+            float dhdy = (hght[(size_t) yp*gx+x] - hght[(size_t) ym*gx+x]) / (step * (float) (yp-ym));
+            float len = 1.0f / sqrtf(1.0f + dhdx * dhdx + dhdy * dhdy);
+            size_t i = (size_t) y*gx+x;
+            nx[i] = -dhdx * len; ny[i] = -dhdy * len; nz[i] = len;
+        }
+
+    vector<float> top;
+    if(canopy)
+    {
+        top.resize(ncells);
+        for(long i = 0; i < ncells; i++)
+            top[i] = hght[i] + chm[i];
+    }
+
+    // bin the sun positions by the horizon direction nearest their azimuth
+    vector<vector<int>> bins(par.ndirs);
+    for(int s = 0; s < (int) samples.size(); s++)
+    {
+        float psi = atan2f(samples[s].sy, samples[s].sx);
+        int k = (int) lroundf(psi / (2.0f * (float) M_PI) * (float) par.ndirs);
+        bins[((k % par.ndirs) + par.ndirs) % par.ndirs].push_back(s);
+    }
+
+    vector<float> tanGround(ncells), tanCanopy(canopy ? ncells : 0);
+    vector<float> visGround(ncells, 0.0f), visCanopy(canopy ? ncells : 0, 0.0f);
+
+    for(int k = 0; k < par.ndirs; k++)
+    {
+        float phi = 2.0f * (float) M_PI * (float) k / (float) par.ndirs;
+
+        // sweeping away from the sun gives the horizon seen looking towards it
+        sweepHorizon(hght.data(), nullptr, gx, gy, step, -cosf(phi), -sinf(phi), par.radius, tanGround.data());
+        if(canopy)
+            sweepHorizon(top.data(), hght.data(), gx, gy, step, -cosf(phi), -sinf(phi), par.radius, tanCanopy.data());
+
+        #pragma omp parallel for
+        for(long i = 0; i < ncells; i++)
+        {
+            visGround[i] += 1.0f / (1.0f + tanGround[i] * tanGround[i]);
+            if(canopy)
+                visCanopy[i] += 1.0f / (1.0f + tanCanopy[i] * tanCanopy[i]);
+        }
+
+        for(int s: bins[k])
+        {
+            const SunSample & sun = samples[s];
+            float * irr = irradiance[sun.month].data();
+            float * hrs = hours[sun.month].data();
+
+            #pragma omp parallel for
+            for(long i = 0; i < ncells; i++)
+            {
+                float cosi = std::max(0.0f, nx[i] * sun.sx + ny[i] * sun.sy + nz[i] * sun.sz);
+                bool clearGround = sun.tanElev > tanGround[i];
+                bool clearCanopy = !canopy || (sun.tanElev > tanCanopy[i] && chm[i] <= 0.0f);
+                float through = (clearCanopy ? 1.0f : (clearGround ? tau : 0.0f));
+                irr[i] += sun.beam * cosi * through;
+                hrs[i] += (clearGround && clearCanopy ? sun.hours : 0.0f);
+            }
+        }
+    }
+
+    // isotropic diffuse light scaled by the cosine weighted sky visibility, then Wh to kWh
+    float norm = 1.0f / (float) par.ndirs;
+    for(int m = 0; m < 12; m++)
+    {
+        float * irr = irradiance[m].data();
+        #pragma omp parallel for
+        for(long i = 0; i < ncells; i++)
+        {
+            float vis = visGround[i] * norm;
+            if(canopy)
+            {
+                vis = visCanopy[i] * norm + tau * (vis - visCanopy[i] * norm);
+                if(chm[i] > 0.0f)
+                    vis *= tau;
+            }
+            irr[i] = (irr[i] + diffuse[m] * vis) * 0.001f;
+        }
+    }
+}
+
+void writeMonthly(const string & fname, const vector<ValueGridMap<float>> & months)
+{
+    if(data_importer::data_dir::is_binary(fname))
+        data_importer::write_monthly_map_binary(fname, months);
+    else
+        data_importer::write_monthly_map(fname, months);
+    cerr << "sunsim: wrote " << fname << endl;
+}
@@ -94,6 +94,89 @@ void ChartWindow::paintEvent(QPaintEvent * ev)
     style()->drawPrimitive(QStyle::PE_Widget, &opt, &p, this);
 }
 
+QAreaSeries * ChartWindow::addSpeciesArea(int species, QLineSeries * upper, QLineSeries * lower)
+{
+    // get species colour
+    float r = scene->getBiome()->getPFType(species)->basecol[0];
+    float g = scene->getBiome()->getPFType(species)->basecol[1];
+    float b = scene->getBiome()->getPFType(species)->basecol[2];
+
+    QColor spccol((int) (r*255.0f), (int) (g*255.0f), (int) (b*255.0f));
+    QAreaSeries * series = new QAreaSeries(upper, lower);
+    QPen pen(spccol);
+    pen.setWidth(0.5);
+    series->setPen(pen);
+
+    QLinearGradient gradient(QPointF(0,0), QPointF(0, 1));
+    gradient.setColorAt(0.0, spccol);
+    gradient.setColorAt(1.0, spccol);
+    gradient.setCoordinateMode(QGradient::ObjectBoundingMode);
+    series->setBrush(gradient);
+
+    chart->addSeries(series);
+    return series;
+}
+
+void ChartWindow::setDistributionData(TimelineGraph * gdata)
+{
+    int nbins = gdata->getNumBins();
+    int tidx = std::min(std::max(gdata->getTimeLine()->getCurrentIdx(), 0), gdata->getHoriScale()-1);
+    std::vector<float> cumulate(nbins, 0.0f); // accumulation of previous series for stacking
+    std::vector<QAreaSeries *> areas;
+
+    // the axes left by a previous graph are replaced rather than reused
+    for(auto axis: chart->axes())
+    {
+        chart->removeAxis(axis);
+        delete axis;
+    }
+
+    // each class is drawn as a flat step, stacked by species, at the current time
+    for(int a = 0; a < gdata->getNumSeries() && tidx >= 0; a++)
+    {
+        float tot = 0.0f;
+        for(int bin = 0; bin < nbins; bin++)
+            tot += gdata->getBinData(a, tidx, bin);
+
+        if(tot > 0.0f) // ignore empty series
+        {
+            QLineSeries * curr = new QLineSeries();
+            QLineSeries * prev = new QLineSeries();
+
+            for(int bin = 0; bin < nbins; bin++)
+            {
+                *prev << QPointF((float) bin, cumulate[bin]) << QPointF((float) (bin+1), cumulate[bin]);
+                cumulate[bin] += gdata->getBinData(a, tidx, bin);
+                *curr << QPointF((float) bin, cumulate[bin]) << QPointF((float) (bin+1), cumulate[bin]);
+            }
+            areas.push_back(addSpeciesArea(a, curr, prev));
+        }
+    }
+
+    // classes are labelled by their lower bound in cm, the last being open-ended
+    QCategoryAxis *axisX = new QCategoryAxis;
+    axisX->setMin(0.0f);
+    axisX->setMax((float) nbins);
+    axisX->setStartValue(0.0f);
+    axisX->setLabelsPosition(QCategoryAxis::AxisLabelsPositionOnValue);
+    for(int bin = 2; bin < nbins; bin += 2)
+        axisX->append(QString::number((int) (bin * TimelineStats::dbhBinWidth)), (float) bin);
+    axisX->setTitleText(QString("DBH (cm) in %1").arg(gdata->getTimeLine()->getNow()));
+    chart->addAxis(axisX, Qt::AlignBottom);
+
+    QValueAxis *axisY = new QValueAxis;
+    axisY->setRange(0.0f, gdata->getVertScale());
+    axisY->setTitleText(QString::fromStdString(gdata->getTitle()));
+    axisY->setLabelFormat("%d");
+    chart->addAxis(axisY, Qt::AlignLeft);
+
+    for(auto area: areas)
+    {
+        area->attachAxis(axisX);
+        area->attachAxis(axisY);
+    }
+}
+
 void ChartWindow::setData(TimelineGraph * gdata)
 {
     QLineSeries * prev;
@@ -104,6 +187,13 @@ void ChartWindow::setData(TimelineGraph * gdata)
     // clear previous series
     chart->removeAllSeries();
 
+    // a distribution is drawn over its classes at the current time, rather than over the timeline
+    if(gdata->getNumBins() > 1)
+    {
+        setDistributionData(gdata);
+        return;
+    }
+
     // create new series
     cumulate.resize(gdata->getHoriScale(), 0); // accumulation of previous series for stacking
     for(int a = 0; a < gdata->getNumSeries(); a++)
@@ -127,24 +217,7 @@ void ChartWindow::setData(TimelineGraph * gdata)
                 idx++;
             }
 
-            // get species colour
-            float r = scene->getBiome()->getPFType(a)->basecol[0];
-            float g = scene->getBiome()->getPFType(a)->basecol[1];
-            float b = scene->getBiome()->getPFType(a)->basecol[2];
-
-            QColor spccol((int) (r*255.0f), (int) (g*255.0f), (int) (b*255.0f));
-            QAreaSeries * series = new QAreaSeries(curr, prev);
-            QPen pen(spccol);
-            pen.setWidth(0.5);
-            series->setPen(pen);
-
-            QLinearGradient gradient(QPointF(0,0), QPointF(0, 1));
-            gradient.setColorAt(0.0, spccol);
-            gradient.setColorAt(1.0, spccol);
-            gradient.setCoordinateMode(QGradient::ObjectBoundingMode);
-            series->setBrush(gradient);
-
-            chart->addSeries(series);
+            addSpeciesArea(a, curr, prev);
         }
     }
 
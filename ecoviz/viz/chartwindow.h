@@ -28,6 +28,7 @@
 #include <QLabel>
 #include <QtCharts/QChart>
 #include <QtCharts/QAreaSeries>
+#include <QtCharts/QLineSeries>
 
 #include "scene.h"
 
@@ -46,6 +47,12 @@ private:
     std::vector<int> xlabels;   //< labelling for timeline
     QStringList chart_desc;
     QLabel *chart_help_label;
+
+    /// add a stacked area for a species between two outlines, in the species colour
+    QAreaSeries * addSpeciesArea(int species, QLineSeries * upper, QLineSeries * lower);
+
+    /// draw a distribution graph over its classes at the timeline's current time
+    void setDistributionData(TimelineGraph * gdata);
 signals:
     void signalRepaintAllGL();
 
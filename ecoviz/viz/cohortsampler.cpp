@@ -298,6 +298,7 @@ std::vector<basic_tree> cohortsampler::sample(const ValueGridMap< std::vector<co
 
                 basic_tree tree(x, y, crt.height * 0.5f, crt.height, crt.dbh);			// REPLACEME: radius = crts.at(specidx).height * 0.5f is temporary
                 tree.species = crt.specidx % specmodulo;
+                tree.id = sampled_tree_id(cidx, crt.specidx, pointidx);
                 trees.push_back(tree);
                 if (allcells_trees)
                     celltrees.push_back(tree);
@@ -48,6 +48,20 @@ public:
         std::vector<basic_tree> sample(const ValueGridMap<std::vector<data_importer::ilanddata::cohort> > &cohortmap, std::vector<std::vector<basic_tree> > *allcells_trees);
         void fix_cohortmaps(std::vector<ValueMap<std::vector<data_importer::ilanddata::cohort> > > &cohortmaps);
         void set_spectoidx_map(std::unique_ptr<ValueGridMap<std::vector<int> > > spectoidx_map_ptr);
+
+        /**
+         * @brief sampled_tree_id Identity of a sampled plant. Sample positions are a deterministic function of
+         *                        the cohort cell and the point index in its tile, so the key is stable across
+         *                        timesteps for as long as the cohort occupies the same slot.
+         * @param cidx      linear index of the cohort cell
+         * @param specidx   cohort species index
+         * @param pointidx  point index within the cell tile (cohort startidx + plant number)
+         * @return          identifier disjoint from mature tree ids (bit 62 is set)
+         */
+        static long long sampled_tree_id(int cidx, int specidx, int pointidx)
+        {
+            return (1LL << 62) | ((long long) cidx << 24) | ((long long) (specidx & 0xFF) << 16) | (long long) (pointidx & 0xFFFF);
+        }
 private:
         std::vector<basic_tree> sample_one_soft(data_importer::ilanddata::cohort chrt, std::default_random_engine &gen);
         std::vector<basic_tree> sample_one_hard(data_importer::ilanddata::cohort chrt, std::default_random_engine &gen);
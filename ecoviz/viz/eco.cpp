@@ -24,6 +24,7 @@
 // date: 27 February 2016
 
 #include "eco.h"
+#include "plantindex.h"
 // #include "interp.h"
 #include <stdlib.h>
 #include <math.h>
@@ -31,6 +32,15 @@
 #include <QDir>
 #include <QElapsedTimer>
 
+const int instanceRunGap = 64;      //< changed instances at most this far apart are uploaded as a single run
+#ifdef HIGHRES
+const int plantSlices = 20;         //< canopy subdivisions for plants drawn at full detail
+#endif
+#ifdef LOWRES
+const int plantSlices = 6;          //< canopy subdivisions for plants drawn at full detail
+#endif
+const int lowPlantSlices = 4;       //< canopy subdivisions for plants drawn at low detail
+
 class ElapsedTimer
 {
 public:
@@ -90,6 +100,133 @@ float NoiseField::getNoise(vpPoint p, float tx, float ty)
 
 /// PlantGrid
 
+// global source of revision stamps, so that a freshly built grid never repeats the stamp of an older one
+static long plantRevisionCounter = 0;
+
+void PlantGrid::touchCell(int f)
+{
+    cellRev[f] = revision = ++plantRevisionCounter;
+}
+
+void PlantGrid::insertPlant(int f, int species, const Plant &plant)
+{
+    std::vector<Plant> &plnts = pgrid[f].pop[species];
+
+    if(plant.id >= 0)
+    {
+        auto it = idIndex.find(plant.id);
+        if(it != idIndex.end()) // already present, so replace rather than duplicate
+            erasePlant(it->second.f, it->second.s, it->second.p);
+        idIndex[plant.id] = {f, species, (int) plnts.size(), (int) tracked.size()};
+        tracked.push_back(plant.id);
+        trackedGen.push_back(generation);
+        numClaimed++;
+    }
+    else
+        numUntracked++;
+    plnts.push_back(plant);
+    touchCell(f);
+}
+
+void PlantGrid::untrack(long long id)
+{
+    auto it = idIndex.find(id);
+    int t = it->second.t;
+    int last = (int) tracked.size() - 1;
+
+    if(trackedGen[t] == generation)
+        numClaimed--;
+    if(t != last)
+    {
+        tracked[t] = tracked[last];
+        trackedGen[t] = trackedGen[last];
+        idIndex[tracked[t]].t = t;
+    }
+    tracked.pop_back();
+    trackedGen.pop_back();
+    idIndex.erase(it);
+}
+
+void PlantGrid::erasePlant(int f, int species, int p)
+{
+    std::vector<Plant> &plnts = pgrid[f].pop[species];
+
+    if(plnts[p].id >= 0)
+        untrack(plnts[p].id);
+    else
+        numUntracked--;
+
+    // order within a cell is irrelevant, so fill the hole with the last plant
+    int last = (int) plnts.size() - 1;
+    if(p != last)
+    {
+        plnts[p] = plnts[last];
+        if(plnts[p].id >= 0)
+            idIndex[plnts[p].id].p = p;
+    }
+    plnts.pop_back();
+    touchCell(f);
+}
+
+Plant * PlantGrid::findPlant(long long id, int &species)
+{
+    auto it = idIndex.find(id);
+    if(it == idIndex.end())
+        return nullptr;
+    species = it->second.s;
+    return &pgrid[it->second.f].pop[it->second.s][it->second.p];
+}
+
+bool PlantGrid::updatePlant(long long id, float height, float canopy)
+{
+    auto it = idIndex.find(id);
+    if(it == idIndex.end())
+        return false;
+
+    Plant &plnt = pgrid[it->second.f].pop[it->second.s][it->second.p];
+    plnt.height = height;
+    plnt.canopy = canopy;
+    touchCell(it->second.f);
+    return true;
+}
+
+bool PlantGrid::removePlant(long long id)
+{
+    auto it = idIndex.find(id);
+    if(it == idIndex.end())
+        return false;
+    erasePlant(it->second.f, it->second.s, it->second.p);
+    return true;
+}
+
+Plant * PlantGrid::claimPlant(long long id, int &species)
+{
+    auto it = idIndex.find(id);
+    if(it == idIndex.end())
+        return nullptr;
+    if(trackedGen[it->second.t] != generation)
+    {
+        trackedGen[it->second.t] = generation;
+        numClaimed++;
+    }
+    species = it->second.s;
+    return &pgrid[it->second.f].pop[it->second.s][it->second.p];
+}
+
+int PlantGrid::removeUnclaimed()
+{
+    std::vector<long long> dead;
+
+    if(numClaimed == (int) tracked.size())
+        return 0;
+    for(int t = 0; t < (int) tracked.size(); t++)
+        if(trackedGen[t] != generation)
+            dead.push_back(tracked[t]);
+    for(auto id: dead)
+        removePlant(id);
+    return (int) dead.size();
+}
+
 void PlantGrid::initSpeciesTable()
 {
     speciesTable.clear();
@@ -106,6 +243,12 @@ void PlantGrid::delGrid()
     for(i = 0; i < (int) pgrid.size(); i++)
         pgrid[i].pop.clear();
     pgrid.clear();
+    idIndex.clear();
+    tracked.clear();
+    trackedGen.clear();
+    generation = 0;
+    numClaimed = 0;
+    numUntracked = 0;
 }
 
 void PlantGrid::initGrid()
@@ -126,6 +269,10 @@ void PlantGrid::initGrid()
             }
             pgrid.push_back(ppop);
         }
+
+    // a fresh stamp for every cell, so that nothing bound from an earlier grid is mistaken for current
+    revision = ++plantRevisionCounter;
+    cellRev.assign(gx * gy, revision);
 }
 
 bool PlantGrid::isEmpty()
@@ -168,7 +315,19 @@ void PlantGrid::clearCell(int x, int y)
     int f = flatten(x, y);
 
     for(int s = 0; s < (int) pgrid[f].pop.size(); s++)
+    {
+        if(pgrid[f].pop[s].empty())
+            continue;
+        for(auto &plnt: pgrid[f].pop[s])
+        {
+            if(plnt.id >= 0)
+                untrack(plnt.id);
+            else
+                numUntracked--;
+        }
         pgrid[f].pop[s].clear();
+        touchCell(f);
+    }
 }
 
 void PlantGrid::placePlant(Terrain * ter, int species, Plant plant)
@@ -181,14 +340,14 @@ void PlantGrid::placePlant(Terrain * ter, int species, Plant plant)
     // cerr << "loc in " << cx << ", " << cy << " species " << species << endl;
 
     // add plant to relevant population
-    pgrid[flatten(cx, cy)].pop[species].push_back(plant);
+    insertPlant(flatten(cx, cy), species, plant);
 }
 
 
 
 void PlantGrid::placePlantExactly(Terrain * ter, int species, Plant plant, int x, int y)
 {
-     pgrid[flatten(x, y)].pop[species].push_back(plant);
+    insertPlant(flatten(x, y), species, plant);
 }
 
 void PlantGrid::clearRegion(Terrain * ter, Region region)
@@ -294,7 +453,12 @@ void PlantGrid::reportNumPlants()
 
 void PlantGrid::setPopulation(int x, int y, PlantPopulation & pop)
 {
-    pgrid[flatten(x, y)] = pop;
+    int f = flatten(x, y);
+
+    clearCell(x, y);
+    for(int s = 0; s < (int) pop.pop.size() && s < (int) pgrid[f].pop.size(); s++)
+        for(auto &plnt: pop.pop[s])
+            insertPlant(f, s, plnt);
 }
 
 PlantPopulation * PlantGrid::getPopulation(int x, int y)
@@ -313,7 +477,7 @@ void PlantGrid::getRegionIndices(Terrain * ter, Region region, int &sx, int &sy,
 
 /// PlantShape
 
-void ShapeGrid::genSpherePlant(float trunkheight, float trunkradius, Shape &shape)
+void ShapeGrid::genSpherePlant(float trunkheight, float trunkradius, int slices, Shape &shape)
 {
     glm::mat4 idt, tfm;
     glm::vec3 trs, rotx;
@@ -335,12 +499,7 @@ void ShapeGrid::genSpherePlant(float trunkheight, float trunkradius, Shape &shap
     tfm = glm::scale(tfm, glm::vec3(1.0, canopyheight, 1.0f)); // make sure tree fills 1.0f on a side bounding box
     tfm = glm::rotate(tfm, glm::radians(-90.0f), rotx);
 
-#ifdef HIGHRES
-    shape.genSphere(0.5f, 20, 20, tfm);
-#endif
-#ifdef LOWRES
-    shape.genSphere(0.5f, 6, 6, tfm);
-#endif
+    shape.genSphere(0.5f, slices, slices, tfm);
 }
 
 void ShapeGrid::genBoxPlant(float trunkheight, float trunkradius, float taper, float scale, Shape &shape)
@@ -366,7 +525,7 @@ void ShapeGrid::genBoxPlant(float trunkheight, float trunkradius, float taper, f
     shape.genPyramid(1.0f*scale, taper*scale, canopyheight*scale, tfm);
 }
 
-void ShapeGrid::genConePlant(float trunkheight, float trunkradius, Shape &shape)
+void ShapeGrid::genConePlant(float trunkheight, float trunkradius, int slices, Shape &shape)
 {
     glm::mat4 idt, tfm;
     glm::vec3 trs, rotx;
@@ -386,16 +545,10 @@ void ShapeGrid::genConePlant(float trunkheight, float trunkradius, Shape &shape)
     trs = glm::vec3(0.0f, trunkheight, 0.0f);
     tfm = glm::translate(idt, trs);
     tfm = glm::rotate(tfm, glm::radians(-90.0f), rotx);
-#ifdef HIGHRES
-    shape.genCappedCone(0.5f, canopyheight, 20, 1, tfm, false);
-#endif
-#ifdef LOWRES
-    shape.genCappedCone(0.5f, canopyheight, 6, 1, tfm, false);
-#endif
-
+    shape.genCappedCone(0.5f, canopyheight, slices, 1, tfm, false);
 }
 
-void ShapeGrid::genInvConePlant(float trunkheight, float trunkradius, Shape &shape)
+void ShapeGrid::genInvConePlant(float trunkheight, float trunkradius, int slices, Shape &shape)
 {
     glm::mat4 idt, tfm;
     glm::vec3 trs, rotx;
@@ -416,16 +569,10 @@ void ShapeGrid::genInvConePlant(float trunkheight, float trunkradius, Shape &sha
     tfm = glm::translate(idt, trs);
     tfm = glm::rotate(tfm, glm::radians(-270.0f), rotx);
     //tfm = glm::translate(tfm, glm::vec3(0.0f, 0.0f, -canopyheight));
-#ifdef HIGHRES
-    shape.genCappedCone(0.5f, canopyheight, 20, 1, tfm, false);
-#endif
-#ifdef LOWRES
-    shape.genCappedCone(0.5f, canopyheight, 6, 1, tfm, false);
-#endif
-
+    shape.genCappedCone(0.5f, canopyheight, slices, 1, tfm, false);
 }
 
-void ShapeGrid::genUmbrellaPlant(float trunkheight, float trunkradius, Shape &shape)
+void ShapeGrid::genUmbrellaPlant(float trunkheight, float trunkradius, int slices, Shape &shape)
 {
     glm::mat4 idt, tfm;
     glm::vec3 trs, rotx;
@@ -445,16 +592,10 @@ void ShapeGrid::genUmbrellaPlant(float trunkheight, float trunkradius, Shape &sh
     trs = glm::vec3(0.0f, 1.0f, 0.0f);
     tfm = glm::translate(idt, trs);
     tfm = glm::rotate(tfm, glm::radians(90.0f), rotx);
-#ifdef HIGHRES
-    shape.genCappedCone(0.5f, canopyheight, 20, 1, tfm, false);
-#endif
-#ifdef LOWRES
-    shape.genCappedCone(0.5f, canopyheight, 6, 1, tfm, false);
-#endif
-
+    shape.genCappedCone(0.5f, canopyheight, slices, 1, tfm, false);
 }
 
-void ShapeGrid::genHemispherePlant(float trunkheight, float trunkradius, Shape &shape)
+void ShapeGrid::genHemispherePlant(float trunkheight, float trunkradius, int slices, Shape &shape)
 {
     glm::mat4 idt, tfm;
     glm::vec3 trs, rotx;
@@ -476,16 +617,11 @@ void ShapeGrid::genHemispherePlant(float trunkheight, float trunkradius, Shape &
     tfm = glm::scale(tfm, glm::vec3(1.0, canopyheight*2.0f, 1.0f)); // make sure tree fills 1.0f on a side bounding box
     tfm = glm::rotate(tfm, glm::radians(90.0f), rotx);
 
-#ifdef HIGHRES
-    shape.genHemisphere(0.5f, 20, 20, tfm);
-#endif
-#ifdef LOWRES
-    shape.genHemisphere(0.5f, 6, 6, tfm);
-#endif
+    shape.genHemisphere(0.5f, slices, slices, tfm);
 
 }
 
-void ShapeGrid::genCylinderPlant(float trunkheight, float trunkradius, Shape &shape)
+void ShapeGrid::genCylinderPlant(float trunkheight, float trunkradius, int slices, Shape &shape)
 {
     glm::mat4 idt, tfm;
     glm::vec3 trs, rotx;
@@ -506,44 +642,57 @@ void ShapeGrid::genCylinderPlant(float trunkheight, float trunkradius, Shape &sh
     tfm = glm::translate(idt, trs);
     tfm = glm::rotate(tfm, glm::radians(-90.0f), rotx);
 
-#ifdef HIGHRES
-    shape.genCappedCylinder(0.5f, 0.5f, canopyheight, 20, 1, tfm, false);
-#endif
-#ifdef LOWRES
-   shape.genCappedCylinder(0.5f, 0.5f, canopyheight, 6, 1, tfm, false);
-#endif
+    shape.genCappedCylinder(0.5f, 0.5f, canopyheight, slices, 1, tfm, false);
 }
 
-void ShapeGrid::delGrid()
+void ShapeGrid::genCrudePlant(float trunkheight, Shape &shape)
 {
-    int i, j;
+    glm::mat4 idt, tfm;
+    glm::vec3 trs, rotx;
 
-    // clear out elements of the vector hierarchy
-    for(i = 0; i < (int) shapes.size(); i++)
-        for(j = 0; j < (int) shapes[i].size(); j++)
-            shapes[i][j].clear();
-    for(i = 0; i < (int) shapes.size(); i++)
-        shapes[i].clear();
+    rotx = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    // canopy only - tapered box starting halfway up the trunk so that the plant does not appear to float
+    idt = glm::mat4(1.0f);
+    trs = glm::vec3(0.0f, trunkheight*0.5f, 0.0f);
+    tfm = glm::translate(idt, trs);
+    tfm = glm::rotate(tfm, glm::radians(-90.0f), rotx);
+    shape.genPyramid(1.0f, 0.5f, 1.0f - trunkheight*0.5f, tfm);
+}
+
+void ShapeGrid::delGrid()
+{
+    for(int v = 0; v < (int) PlantView::PVEND; v++)
+        releaseView((PlantView) v);
+    for(int s = 0; s < (int) shapes.size(); s++)
+        shapes[s].clear();
     shapes.clear();
 }
 
+void ShapeGrid::releaseView(PlantView view)
+{
+    ViewBinding &vb = views[(int) view];
+
+    for(auto &inst: vb.instances)
+        inst.release();
+    vb.reset();
+}
+
 void ShapeGrid::initGrid(bool buildGeom)
 {
-    int i, j, s;
+    // instance buffers are kept for reuse, but must be rebound against the new geometry
+    for(int v = 0; v < (int) PlantView::PVEND; v++)
+    {
+        views[v].reset();
+        for(auto &inst: views[v].instances)
+            inst.removeAllInstances();
+    }
 
-    // setup empty elements of the vector hierarchy according to the grid dimensions
-    for(i = 0; i < gx; i++)
-        for(j = 0; j < gy; j++)
-        {
-            std::vector<Shape> shapevec;
-            for(s = 0; s < maxSpecies; s++)
-            {
-                Shape shape;
-                shapevec.push_back(shape);
-            }
-            shapes.push_back(shapevec);
-        }
-    if (buildGeom) genPlants();
+    // shapes are emptied rather than destroyed so that their mesh buffers, shared by all views, are refilled in place
+    for(auto &shp: shapes)
+        shp.clear();
+    shapes.resize((int) PlantLOD::LODEND * maxSpecies);
+    if (buildGeom && biome != nullptr) genPlants();
 }
 
 void ShapeGrid:: genPlants()
@@ -553,311 +702,477 @@ void ShapeGrid:: genPlants()
 
     for(s = 0; s < biome->numPFTypes(); s++)
     {
-        Shape currshape;
         PFType * pft = biome->getPFType(s);
-        currshape.setColour(pft->basecol);
         trunkheight = pft->draw_hght; trunkradius = pft->draw_radius;
-        //genSpherePlant(trunkheight, trunkradius, currshape);		// XXX: just for debugging. Remove later and uncomment below switch statement
-        switch(pft->shapetype)
+
+        // full and low detail differ only in the tessellation of the canopy
+        for(int lod = 0; lod < (int) PlantLOD::CRUDE; lod++)
         {
-        case TreeShapeType::SPHR:
-            genSpherePlant(trunkheight, trunkradius, currshape);
-            break;
-        case TreeShapeType::BOX:
-            genBoxPlant(trunkheight, trunkradius, pft->draw_box1, pft->draw_box2, currshape);
-            break;
-        case TreeShapeType::CONE:
-            genConePlant(trunkheight, trunkradius, currshape);
-            break;
-        case TreeShapeType::INVCONE:
-            genInvConePlant(trunkheight, trunkradius, currshape);
-            break;
-        case TreeShapeType::HEMISPHR:
-            genHemispherePlant(trunkheight, trunkradius, currshape);
-            break;
-        case TreeShapeType::CYL:
-            genCylinderPlant(trunkheight, trunkradius, currshape);
-            break;
-        default:
-            break;
+            Shape currshape;
+            int slices = (lod == (int) PlantLOD::FULL) ? plantSlices : lowPlantSlices;
+            currshape.setColour(pft->basecol);
+            //genSpherePlant(trunkheight, trunkradius, slices, currshape);		// XXX: just for debugging. Remove later and uncomment below switch statement
+            switch(pft->shapetype)
+            {
+            case TreeShapeType::SPHR:
+                genSpherePlant(trunkheight, trunkradius, slices, currshape);
+                break;
+            case TreeShapeType::BOX:
+                genBoxPlant(trunkheight, trunkradius, pft->draw_box1, pft->draw_box2, currshape);
+                break;
+            case TreeShapeType::CONE:
+                genConePlant(trunkheight, trunkradius, slices, currshape);
+                break;
+            case TreeShapeType::INVCONE:
+                genInvConePlant(trunkheight, trunkradius, slices, currshape);
+                break;
+            case TreeShapeType::HEMISPHR:
+                genHemispherePlant(trunkheight, trunkradius, slices, currshape);
+                break;
+            case TreeShapeType::CYL:
+                genCylinderPlant(trunkheight, trunkradius, slices, currshape);
+                break;
+            default:
+                break;
+            }
+            shapes[lodIndex((PlantLOD) lod, s)] = currshape;
         }
-        shapes[0][s] = currshape;
+
+        Shape crudeshape;
+        crudeshape.setColour(pft->basecol);
+        genCrudePlant(trunkheight, crudeshape);
+        shapes[lodIndex(PlantLOD::CRUDE, s)] = crudeshape;
     }
 }
 
 
-void ShapeGrid::bindPlantsSimplified(Terrain * ter,  PlantGrid *esys, std::vector<bool> * plantvis, std::vector<Plane> cullPlanes)
+ShapeGrid::CellSlots * ShapeGrid::findSlots(CellBinding &cb, int b)
+{
+    for(auto &cs: cb.slots)
+        if(cs.b == b)
+            return &cs;
+    return nullptr;
+}
+
+void ShapeGrid::removeSlot(ViewBinding &vb, int b, int slot)
 {
-    int x, y, s, p, sx, sy, ex, ey, f;
-    PlantPopulation * plnts;
-    int bndplants = 0, culledplants = 0;
+    InstancePool &pool = vb.pools[b];
+    int last = (int) pool.trans.size() - 1;
+
+    // order within a pool is irrelevant, so fill the hole with the last instance and tell its cell where it went.
+    // The slot is marked even if it was the last, so that the shorter count reaches the instance buffer.
+    if(slot != last)
+    {
+        pool.trans[slot] = pool.trans[last];
+        pool.scale[slot] = pool.scale[last];
+        pool.col[slot] = pool.col[last];
+        pool.owner[slot] = pool.owner[last];
+        pool.ownerPos[slot] = pool.ownerPos[last];
+        findSlots(vb.cells[pool.owner[slot]], b)->slots[pool.ownerPos[slot]] = slot;
+    }
+    pool.dirty.push_back(slot);
+    pool.trans.pop_back();
+    pool.scale.pop_back();
+    pool.col.pop_back();
+    pool.owner.pop_back();
+    pool.ownerPos.pop_back();
+}
+
+int ShapeGrid::uploadPools(ViewBinding &vb)
+{
+    std::vector<std::pair<int, int>> runs;
+    int uploaded = 0;
+
+    for(int b = 0; b < (int) vb.pools.size(); b++)
+    {
+        InstancePool &pool = vb.pools[b];
+        int count = (int) pool.trans.size();
+
+        if(!pool.stale && pool.dirty.empty())
+            continue;
+
+        if(count == 0) // an empty list would otherwise be bound as a single instance at the origin
+            vb.instances[b].removeAllInstances();
+        else if(pool.stale)
+        {
+            shapes[b].bindInstances(vb.instances[b], &pool.trans, &pool.scale, &pool.col);
+            uploaded += count;
+        }
+        else
+        {
+            // changes separated by fewer than instanceRunGap instances travel as one run, trading a little
+            // redundant copying for fewer calls. Slots beyond the end were vacated after being changed.
+            std::sort(pool.dirty.begin(), pool.dirty.end());
+            runs.clear();
+            for(int slot: pool.dirty)
+            {
+                if(slot >= count)
+                    break;
+                if(!runs.empty() && slot <= runs.back().second + instanceRunGap)
+                    runs.back().second = std::max(runs.back().second, slot + 1);
+                else
+                    runs.push_back({slot, slot + 1});
+            }
+            for(auto &r: runs)
+                uploaded += r.second - r.first;
+            shapes[b].updateInstances(vb.instances[b], &pool.trans, &pool.scale, &pool.col, runs);
+        }
+        pool.dirty.clear();
+        pool.stale = false;
+    }
+    return uploaded;
+}
+
+void ShapeGrid::bindPlantsSimplified(Terrain * ter,  PlantGrid *esys, std::vector<bool> * plantvis,
+                                     std::vector<Plane> cullPlanes, PlantView view, const PlantFrustum * frustum)
+{
+    int s;
+    const int numLOD = (int) PlantLOD::LODEND;
+    ViewBinding &vb = views[(int) view];
+    int culledplants = 0, cellsoutside = 0;
     int gwidth, gheight;
+    QElapsedTimer bindTimer;
+
+    bindTimer.start();
 
     ter->getGridDim(gwidth, gheight);
-    Region wholeRegion = Region(0, 0, gwidth - 1, gheight - 1);
-    esys->getRegionIndices(ter, wholeRegion, sx, sy, ex, ey);
     Region parentRegion;
     float parentX0, parentY0, parentX1, parentY1, parentDimx, parentDimy;
 
     bool parentRegionAvailable = ter->getSourceRegion(parentRegion, parentX0, parentY0,
                                                       parentX1, parentY1, parentDimx, parentDimy);
-    // std::cout << " +++++ Parent origin = " << (parentRegionAvailable ? "[DEFINED]" : "[NULL]")
-    //          << " = (" << parentX0 << "," << parentY0 << ")\n";
 
-    // std::vector<std::vector<glm::mat4> > xforms; // transformation to be applied to each instance
-    std::vector<std::vector<glm::vec3> > xformsTrans; // transformation to be applied to each instance - tranalte (x,y,z)
-    std::vector<std::vector<glm::vec2> > xformsScale; // transformation to be applied to each instance - scale (base, height)
-    std::vector<std::vector<float> > colvars; // colour variation to be applied to each instance (scale value multiplied in shader)
-
-    vpPoint loc;
-    float rad;
-    for(x = sx; x <= ex; x++)
-        for(y = sy; y <= ey; y++)
-        {
-            plnts = esys->getPopulation(x, y);
+    // everything bound so far is discarded if the terrain, its region, the culling or the plant grid layout changes.
+    // The camera is deliberately not part of this: a move only rebinds cells whose visibility or level of detail it alters.
+    std::vector<float> key = {(float) gwidth, (float) gheight, (float) esys->gx, (float) esys->gy, (parentRegionAvailable ? 1.0f : 0.0f)};
+    if(parentRegionAvailable)
+        key.insert(key.end(), {parentX0, parentY0, parentX1, parentY1});
+    for(auto &pln: cullPlanes)
+        key.insert(key.end(), {pln.n.i, pln.n.j, pln.n.k, pln.d});
+    if(ter->getId() != vb.boundTerrain || key != vb.boundKey || (int) vb.cells.size() != esys->gx * esys->gy)
+    {
+        vb.reset();
+        vb.cells.resize(esys->gx * esys->gy);
+    }
 
-            for(s = 0; s < (int) plnts->pop.size(); s++) // iterate over plant types
-            {
-                //std::vector<glm::mat4> xform; // transformation to be applied to each instance
-                std::vector<glm::vec3> xformTrans;
-                std::vector<glm::vec2> xformScale;
-
-                std::vector<float> colvar; // colour variation to be applied to each instance
-
-                //if((int) plnts->pop[s].size() > 0)
-                //    cerr << "Species " << s << " Present" << endl;
-                if((* plantvis)[s])
-                    {
-                    //glm::vec4 species_base_color = biome->getSpeciesColourV4(s);
-
-                    for(p = 0; p < (int) plnts->pop[s].size(); p++) // iterate over plant specimens
-                    {
-                        rad = plnts->pop[s][p].canopy/2.0; // radius = 0.5 canopy_width
-                        loc = plnts->pop[s][p].pos;
-
-                        bool regionExclude = false;
-                        if (parentRegionAvailable)
-                        {
-                            loc.x -= parentY0; // PCM: this x/y flip is very confusing...
-                            loc.z -= parentX0;
-
-                            if ( (loc.x-rad) < 0.0 || (loc.z-rad) < 0.0 ||
-                                (loc.x+rad) > (parentY1-parentY0) || (loc.z+rad) > (parentX1 - parentX0))
-                                regionExclude = true;
-                        }
-
-                         // ***** PCM 2023 - cull plant cylinder against planes if cullPlanes available
-                        bool cull = false;
-                        if (cullPlanes.size() > 0 && !regionExclude)
-                        {
-                            //rad = plnts->pop[s][p].canopy/2.0; // radius = 0.5 canopy_width
-                            //loc = plnts->pop[s][p].pos;
-                            for (std::size_t planes = 0; planes < cullPlanes.size(); ++planes)
-                            {
-                                // if candidate cyl is beyond plane or overlaps with plane, fails test (small tolerance)
-                                if (cullPlanes[planes].side(loc) == true || cullPlanes[planes].dist(loc) < rad + 0.01)
-                                {
-                                    cull = true;
-                                    break;
-                                }
-                            }
-
-                        }
-
-                        // *****************************************
-
-                        // only display reasonably sized plants
-                        if(plnts->pop[s][p].height > 0.01f && !regionExclude &&
-                               (cullPlanes.size() == 0 || (cullPlanes.size() > 0 && cull == false) ) )
-                        {
-                            // setup transformation for individual plant, including scaling and translation
-                            //glm::mat4 idt, tfm;
-                            //glm::vec3 trs, sc; // rotate_axis = glm::vec3(0.0f, 1.0f, 0.0f);
-                            // loc = plnts->pop[s][p].pos;
-                            // GLfloat rotate_rad;
-
-                            /*
-                            if (plnts->pop[s+a][p].iscanopy)	// we use a different generator depending on whether we have a canopy or undergrowth plant - keeps rotations the same whether we render undergrowth plants or not
-                            {
-                                rotate_rad = rand_unif(generator_canopy) * glm::pi<GLfloat>() * 2.0f;
-                            }
-                            else
-                            {
-                                rotate_rad = rand_unif(generator_under) * glm::pi<GLfloat>() * 2.0f;
-                            }*/
-
-                            /*
-                            idt = glm::mat4(1.0f);
-                            trs = glm::vec3(loc.x, loc.y, loc.z);
-                            tfm = glm::translate(idt, trs);
-                            sc = glm::vec3(plnts->pop[s][p].canopy, plnts->pop[s][p].height, plnts->pop[s][p].canopy);		// XXX: use this for actual tree models
-                            tfm = glm::scale(tfm, sc);
-                            */
-                            // tfm = glm::rotate(tfm, rotate_rad, rotate_axis);
-                            xformTrans.push_back(glm::vec3(loc.x, loc.y, loc.z));
-                            xformScale.push_back(glm::vec2(plnts->pop[s][p].canopy, plnts->pop[s][p].height));
-                            //xform.push_back(tfm);
-
-                            colvar.push_back(plnts->pop[s][p].col); // colour variation
-                            bndplants++;
-                        }
-                        else
-                        {
-                            culledplants++;
-                        }
-                    }
+    // species whose visibility has changed force every cell holding them to be gathered again
+    std::vector<int> visChanged;
+    for(s = 0; s < maxSpecies; s++)
+        if((int) vb.boundVis.size() != maxSpecies || vb.boundVis[s] != (bool) (* plantvis)[s])
+            visChanged.push_back(s);
 
-                }
+    // the frustum is relative to the parent region origin, whereas cell bounds are in terrain coordinates
+    PlantFrustum cellFrustum;
+    if(frustum != nullptr)
+    {
+        cellFrustum = (* frustum);
+        if (parentRegionAvailable)
+            cellFrustum.translate(parentY0, parentX0);
+    }
 
-                if (xformsScale.size() < s + 1)
-                {
-                    xformsScale.resize(s  + 1);
-                }
-                if (xformsTrans.size() < s + 1)
-                {
-                    xformsTrans.resize(s  + 1);
-                }
-                if (colvars.size() < s + 1)
+    // a cell whose bounds lie wholly beyond or against a cull plane can keep none of its plants (see keepPlant below),
+    // so a transect skips every cell outside its slab without visiting the plants
+    auto cellBeyondPlanes = [&](const glm::vec3 &bmin, const glm::vec3 &bmax)
+    {
+        glm::vec3 offset(0.0f);
+        if (parentRegionAvailable)
+            offset = glm::vec3(parentY0, 0.0f, parentX0);
+        for (auto &pln: cullPlanes)
+        {
+            // corner of the box least far along the plane normal
+            vpPoint p((pln.n.i >= 0.0f ? bmin.x : bmax.x) - offset.x,
+                      (pln.n.j >= 0.0f ? bmin.y : bmax.y) - offset.y,
+                      (pln.n.k >= 0.0f ? bmin.z : bmax.z) - offset.z);
+            if (p.x * pln.n.i + p.y * pln.n.j + p.z * pln.n.k + pln.d > -0.01f)
+                return true;
+        }
+        return false;
+    };
+
+    // Each cell is drawn at a single level of detail, chosen by the distance to the nearest point of its bounds and its
+    // tallest plant, or not at all if it lies outside the frustum or beyond a cull plane. A cell is gathered again only
+    // if that band, its plants or the visibility of its species have changed.
+    int numCells = (int) vb.cells.size();
+    std::vector<int> band(numCells);
+    std::vector<char> dirty(numCells);
+
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:cellsoutside)
+    for(int f = 0; f < numCells; f++)
+    {
+        int x = f / esys->gy, y = f % esys->gy;
+        CellBinding &cb = vb.cells[f];
+        PlantPopulation * cpop = esys->getPopulation(x, y);
+        long rev = esys->getCellRevision(x, y);
+        int numSpecies = std::min((int) cpop->pop.size(), maxSpecies);
+
+        // bounds are only needed again once the plants in the cell change
+        if(cb.boundsRev != rev)
+        {
+            cb.bmin = glm::vec3(1.0e10f); cb.bmax = glm::vec3(-1.0e10f);
+            cb.tallest = 0.0f;
+            for(int sp = 0; sp < numSpecies; sp++)
+                for(auto &plnt: cpop->pop[sp])
                 {
-                    colvars.resize(s + 1);
+                    float rad = plnt.canopy / 2.0f;
+                    cb.bmin = glm::min(cb.bmin, glm::vec3(plnt.pos.x - rad, plnt.pos.y, plnt.pos.z - rad));
+                    cb.bmax = glm::max(cb.bmax, glm::vec3(plnt.pos.x + rad, plnt.pos.y + plnt.height, plnt.pos.z + rad));
+                    cb.tallest = std::max(cb.tallest, plnt.height);
                 }
-                xformsTrans[s].insert(xformsTrans[s].end(), xformTrans.begin(), xformTrans.end());
-                xformsScale[s].insert(xformsScale[s].end(), xformScale.begin(), xformScale.end());
-
-                colvars[s].insert(colvars[s].end(), colvar.begin(), colvar.end());
+            cb.boundsRev = rev;
+        }
 
-                f = flatten(x, y);
-                shapes[f][s].removeAllInstances();
+        band[f] = (int) PlantLOD::FULL;
+        if(!cullPlanes.empty() && cb.bmin.x <= cb.bmax.x && cellBeyondPlanes(cb.bmin, cb.bmax))
+        {
+            band[f] = -1;
+            cellsoutside++;
+        }
+        else if(frustum != nullptr && cb.bmin.x <= cb.bmax.x)
+        {
+            if(cellFrustum.boxOutside(cb.bmin, cb.bmax))
+            {
+                band[f] = -1;
+                cellsoutside++;
             }
+            else
+                band[f] = (int) lodPolicy.select(cellFrustum.boxDistance(cb.bmin, cb.bmax), cb.tallest);
         }
 
-    assert(xformsTrans.size() == xformsScale.size());
+        bool changed = (cb.rev != rev || cb.band != band[f]);
+        for(int i = 0; i < (int) visChanged.size() && !changed; i++)
+            changed = (visChanged[i] < numSpecies && !cpop->pop[visChanged[i]].empty());
+        dirty[f] = changed;
+    }
+
+    std::vector<int> dirtyCells;
+    for(int f = 0; f < numCells; f++)
+        if(dirty[f])
+            dirtyCells.push_back(f);
 
-    for (std::size_t i = 0; i < xformsTrans.size(); i++)
+    // plants must fit within the parent region, avoid the cull planes and be reasonably sized.
+    // On success loc holds the plant position relative to the parent region.
+    auto keepPlant = [&](const Plant &plnt, vpPoint &loc)
     {
-        shapes[0][i].removeAllInstances();
-        shapes[0][i].bindInstances(&xformsTrans[i], &xformsScale[i], &colvars[i]);
-        //shapes[0][i].bindInstances(&xforms[i], &colvars[i]);
-    }
-    // DEBUG:
-    // std::cerr << "bindPlantsSimplified - bound: " << bndplants << "; culled: " << culledplants << std::endl;
-}
+        float rad = plnt.canopy/2.0; // radius = 0.5 canopy_width
+        loc = plnt.pos;
 
-void ShapeGrid::bindPlants(View * view, Terrain * ter, std::vector<bool> * plantvis, PlantGrid * esys, Region region)
-{
-    int x, y, s, p, sx, sy, ex, ey, f;
-    PlantPopulation * plnts;
-    int bndplants = 0, culledplants = 0;
-    int gwidth, gheight;
+        if (parentRegionAvailable)
+        {
+            loc.x -= parentY0; // PCM: this x/y flip is very confusing...
+            loc.z -= parentX0;
 
-    ter->getGridDim(gwidth, gheight);
-    Region wholeRegion = Region(0, 0, gwidth - 1, gheight - 1);
-    esys->getRegionIndices(ter, wholeRegion, sx, sy, ex, ey);
+            if ( (loc.x-rad) < 0.0 || (loc.z-rad) < 0.0 ||
+                (loc.x+rad) > (parentY1-parentY0) || (loc.z+rad) > (parentX1 - parentX0))
+                return false;
+        }
 
-    //std::vector<std::vector<glm::mat4> > xforms; // transformation to be applied to each instance
-    std::vector<std::vector<glm::vec3> > xformsTrans; // transformation to be applied to each instance - tranalte (x,y,z)
-    std::vector<std::vector<glm::vec2> > xformsScale; // transformation to be applied to each instance - scale (base, height)
+        // ***** PCM 2023 - cull plant cylinder against planes if cullPlanes available
+        for (std::size_t planes = 0; planes < cullPlanes.size(); ++planes)
+        {
+            // if candidate cyl is beyond plane or overlaps with plane, fails test (small tolerance)
+            if (cullPlanes[planes].side(loc) == true || cullPlanes[planes].dist(loc) < rad + 0.01)
+                return false;
+        }
 
-    std::vector<std::vector<float> > colvars; // colour variation to be applied to each instance (in shader - scalar needed)
+        // only display reasonably sized plants
+        return plnt.height > 0.01f;
+    };
 
-    for(x = sx; x <= ex; x++)
-        for(y = sy; y <= ey; y++)
+    // Two pass build over the cells to be gathered again. The first pass counts the plants each cell keeps per species.
+    // Slots are then released or reserved so that each cell holds exactly that many in the instance buffers of its band,
+    // with new slots appended to each pool at offsets from a prefix sum. The second pass fills the slots in parallel,
+    // since no two cells share a slot.
+    int numDirty = (int) dirtyCells.size();
+    std::vector<int> counts(numDirty * maxSpecies, 0);
+
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+:culledplants)
+    for(int d = 0; d < numDirty; d++)
+    {
+        int f = dirtyCells[d];
+        if(band[f] < 0)
+            continue;
+
+        PlantPopulation * cpop = esys->getPopulation(f / esys->gy, f % esys->gy);
+        int numSpecies = std::min((int) cpop->pop.size(), maxSpecies);
+        vpPoint loc;
+        for(int sp = 0; sp < numSpecies; sp++)
         {
-            plnts = esys->getPopulation(x, y);
+            if(!(* plantvis)[sp])
+                continue;
+            for(auto &plnt: cpop->pop[sp])
+            {
+                if(keepPlant(plnt, loc))
+                    counts[d * maxSpecies + sp]++;
+                else
+                    culledplants++;
+            }
+        }
+    }
 
-            for(s = 0; s < (int) plnts->pop.size(); s+=3) // iterate over plant types
+    // surplus slots are released before any are reserved, since filling the holes they leave moves instances of other cells
+    for(int d = 0; d < numDirty; d++)
+    {
+        CellBinding &cb = vb.cells[dirtyCells[d]];
+        int cband = band[dirtyCells[d]];
+        for(int i = (int) cb.slots.size() - 1; i >= 0; i--)
+        {
+            int b = cb.slots[i].b;
+            int keep = (b / maxSpecies == cband ? counts[d * maxSpecies + b % maxSpecies] : 0);
+            while((int) cb.slots[i].slots.size() > keep)
             {
-                //std::vector<glm::mat4> xform; // transformation to be applied to each instance
-                std::vector<glm::vec3> xformTrans;
-                std::vector<glm::vec2> xformScale;
-                std::vector<float> colvar; // colour variation to be applied to each instance
+                int slot = cb.slots[i].slots.back();
+                cb.slots[i].slots.pop_back();
+                removeSlot(vb, b, slot);
+            }
+            if(keep == 0)
+                cb.slots.erase(cb.slots.begin() + i);
+        }
+    }
 
-                for(int a = 0; a < 3; a++)
-                {
-                    for(p = 0; p < (int) plnts->pop[s+a].size(); p++) // iterate over plant specimens
-                    {
-                        if(plnts->pop[s+a][p].height > 0.01f) // only display reasonably sized plants
-                        {
-                            // setup transformation for individual plant, including scaling and translation
-                            //glm::mat4 idt, tfm;
-                            //glm::vec3 trs, sc; // rotate_axis = glm::vec3(0.0f, 1.0f, 0.0f);
-                            vpPoint loc = plnts->pop[s+a][p].pos;
-                            // GLfloat rotate_rad;
-
-                            /*
-                            if (plnts->pop[s+a][p].iscanopy)	// we use a different generator depending on whether we have a canopy or undergrowth plant - keeps rotations the same whether we render undergrowth plants or not
-                            {
-                                rotate_rad = rand_unif(generator_canopy) * glm::pi<GLfloat>() * 2.0f;
-                            }
-                            else
-                            {
-                                rotate_rad = rand_unif(generator_under) * glm::pi<GLfloat>() * 2.0f;
-                            }*/
-
-                            /*
-                            idt = glm::mat4(1.0f);
-                            trs = glm::vec3(loc.x, loc.y, loc.z);
-                            tfm = glm::translate(idt, trs);
-                            sc = glm::vec3(plnts->pop[s+a][p].height, plnts->pop[s+a][p].height, plnts->pop[s+a][p].height);		// XXX: use this for actual tree models
-                            tfm = glm::scale(tfm, sc);
-                            */
-                            xformTrans.push_back(glm::vec3(loc.x, loc.y, loc.z));
-                            xformScale.push_back(glm::vec2(plnts->pop[s+a][p].height, plnts->pop[s+a][p].height) );
-
-                            // xform.push_back(tfm);
-
-                            colvar.push_back(plnts->pop[s+a][p].col); // colour variation
-                            bndplants++;
-                        }
-                        else
-                        {
-                            culledplants++;
-                        }
-                    }
+    // prefix sums give each cell and species its first new slot in the pool and its first change flag
+    std::vector<int> firstNew(numDirty * maxSpecies, 0), firstFlag(numDirty * maxSpecies, 0);
+    std::vector<int> poolEnd(vb.pools.size());
+    int numKept = 0;
+    for(int b = 0; b < (int) vb.pools.size(); b++)
+        poolEnd[b] = (int) vb.pools[b].trans.size();
+    for(int d = 0; d < numDirty; d++)
+    {
+        int f = dirtyCells[d];
+        for(int sp = 0; sp < maxSpecies && band[f] >= 0; sp++)
+        {
+            int count = counts[d * maxSpecies + sp];
+            if(count == 0)
+                continue;
+            int b = lodIndex((PlantLOD) band[f], sp);
+            CellSlots * cs = findSlots(vb.cells[f], b);
+            firstNew[d * maxSpecies + sp] = poolEnd[b];
+            poolEnd[b] += count - (cs != nullptr ? (int) cs->slots.size() : 0);
+            firstFlag[d * maxSpecies + sp] = numKept;
+            numKept += count;
+        }
+    }
+    for(int b = 0; b < (int) vb.pools.size(); b++)
+    {
+        InstancePool &pool = vb.pools[b];
+        if(poolEnd[b] == (int) pool.trans.size())
+            continue;
+        pool.trans.resize(poolEnd[b]);
+        pool.scale.resize(poolEnd[b]);
+        pool.col.resize(poolEnd[b]);
+        pool.owner.resize(poolEnd[b]);
+        pool.ownerPos.resize(poolEnd[b]);
+    }
 
-                }
-                if (xformsScale.size() < s / 3 + 1)
-                {
-                    xformsScale.resize(s / 3 + 1);
-                }
-                if (xformsTrans.size() < s / 3 + 1)
+    // Within a cell instances keep the order of the plants, so a cell whose plants are unchanged rewrites nothing.
+    // Only instances that actually differ, or occupy new slots, are flagged for upload.
+    std::vector<char> changed(numKept, 0);
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int d = 0; d < numDirty; d++)
+    {
+        int f = dirtyCells[d];
+        if(band[f] < 0)
+            continue;
+
+        CellBinding &cb = vb.cells[f];
+        PlantPopulation * cpop = esys->getPopulation(f / esys->gy, f % esys->gy);
+        vpPoint loc;
+        for(int sp = 0; sp < maxSpecies; sp++)
+        {
+            if(counts[d * maxSpecies + sp] == 0)
+                continue;
+
+            int b = lodIndex((PlantLOD) band[f], sp);
+            InstancePool &pool = vb.pools[b];
+            CellSlots * cs = findSlots(cb, b);
+            if(cs == nullptr)
+            {
+                cb.slots.push_back({b, {}});
+                cs = &cb.slots.back();
+            }
+            int held = (int) cs->slots.size(), i = 0;
+            char * flags = &changed[firstFlag[d * maxSpecies + sp]];
+
+            for(auto &plnt: cpop->pop[sp])
+            {
+                if(!keepPlant(plnt, loc))
+                    continue;
+
+                // setup transformation for individual plant, including scaling and translation
+                glm::vec3 trans(loc.x, loc.y, loc.z);
+                glm::vec2 scale(plnt.canopy, plnt.height);
+                int slot;
+                if(i < held)
+                    slot = cs->slots[i];
+                else
                 {
-                    xformsTrans.resize(s / 3 + 1);
+                    slot = firstNew[d * maxSpecies + sp] + (i - held);
+                    cs->slots.push_back(slot);
+                    pool.owner[slot] = f;
+                    pool.ownerPos[slot] = i;
                 }
-                if (colvars.size() < s / 3 + 1)
+                if(i >= held || pool.trans[slot] != trans || pool.scale[slot] != scale || pool.col[slot] != plnt.col)
                 {
-                    colvars.resize(s / 3 + 1);
+                    pool.trans[slot] = trans;
+                    pool.scale[slot] = scale;
+                    pool.col[slot] = plnt.col; // colour variation
+                    flags[i] = 1;
                 }
-                xformsTrans[s / 3].insert(xformsTrans[s / 3].end(), xformTrans.begin(), xformTrans.end());
-                xformsScale[s / 3].insert(xformsScale[s / 3].end(), xformScale.begin(), xformScale.end());
-                colvars[s / 3].insert(colvars[s / 3].end(), colvar.begin(), colvar.end());
-
-                f = flatten(x, y);
-                shapes[f][s / 3].removeAllInstances();
+                i++;
             }
         }
+    }
 
-    assert(xformsTrans.size() == xformsScale.size());
+    for(int d = 0; d < numDirty; d++)
+    {
+        int f = dirtyCells[d];
+        CellBinding &cb = vb.cells[f];
+        for(auto &cs: cb.slots)
+        {
+            const char * flags = &changed[firstFlag[d * maxSpecies + cs.b % maxSpecies]];
+            for(int i = 0; i < (int) cs.slots.size(); i++)
+                if(flags[i])
+                    vb.pools[cs.b].dirty.push_back(cs.slots[i]);
+        }
+        cb.rev = esys->getCellRevision(f / esys->gy, f % esys->gy);
+        cb.band = band[f];
+    }
+    int uploaded = uploadPools(vb);
 
-    for (std::size_t i = 0; i < xformsTrans.size(); i++)
+    vb.boundTerrain = ter->getId();
+    vb.boundKey = key;
+    vb.boundVis.resize(maxSpecies);
+    for(s = 0; s < maxSpecies; s++)
+        vb.boundVis[s] = (* plantvis)[s];
+
+    vb.stats.bindTime = (float) bindTimer.nsecsElapsed() / 1.0e6f;
+    vb.stats.bound = 0;
+    for(int lod = 0; lod < numLOD; lod++)
     {
-        cerr << i << endl;
-        shapes[0][i].removeAllInstances();
-        //shapes[0][i].bindInstances(&xforms[i], &colvars[i]);
-        shapes[0][i].bindInstances(&xformsTrans[i], &xformsScale[i], &colvars[i]);
+        vb.stats.lodCount[lod] = 0;
+        for(s = 0; s < maxSpecies; s++)
+            vb.stats.lodCount[lod] += (int) vb.pools[lodIndex((PlantLOD) lod, s)].trans.size();
+        vb.stats.bound += vb.stats.lodCount[lod];
     }
-    cerr << "num bound plants = " << bndplants << endl;
-    cerr << "num culled plants = " << culledplants << endl;
+    vb.stats.culled = culledplants;
+    vb.stats.cellsOutside = cellsoutside;
+    vb.stats.cellsRebound = numDirty;
+    vb.stats.uploaded = uploaded;
+    if(bindHook)
+        bindHook(view, vb.stats);
 }
 
-void ShapeGrid::drawPlants(std::vector<ShapeDrawData> &drawParams)
+void ShapeGrid::drawPlants(std::vector<ShapeDrawData> &drawParams, PlantView view)
 {
-    int s; // x, y, f;
+    int s;
     ShapeDrawData sdd;
+    ViewBinding &vb = views[(int) view];
 
-    for(s = 0; s < (int) shapes[0].size(); s++) // iterate over plant types
+    for(s = 0; s < (int) shapes.size(); s++) // iterate over plant types
     {
-        sdd = shapes[0][s].getDrawParameters();
+        if(vb.instances[s].getNumInstances() == 0)
+            continue;
+        sdd = shapes[s].getDrawParameters(vb.instances[s]);
         sdd.current = false;
         drawParams.push_back(sdd);
     }
@@ -869,12 +1184,14 @@ void ShapeGrid::drawPlants(std::vector<ShapeDrawData> &drawParams)
 EcoSystem::EcoSystem()
 {
     biome = new Biome();
+    pindex = new PlantIndex();
     init();
 }
 
 EcoSystem::EcoSystem(Biome * ecobiome)
 {
     biome = ecobiome;
+    pindex = new PlantIndex();
     init();
 }
 
@@ -882,7 +1199,7 @@ EcoSystem::~EcoSystem()
 {
     esys.delGrid();
     eshapes.delGrid();
-    transectShapes.delGrid();
+    delete pindex;
 
     for(int i = 0; i < (int) niches.size(); i++)
     {
@@ -894,10 +1211,8 @@ EcoSystem::~EcoSystem()
 void EcoSystem::init()
 {
     esys = PlantGrid(pgdim, pgdim);
-    eshapes = ShapeGrid(pgdim, pgdim, biome);
-
-    // add in copy for transect plants...geometry generated by ShapeGrid constructor call above *once*
-    transectShapes = eshapes;
+    // plant geometry is generated once per species and shared by the main and transect views
+    eshapes.attachBiome(biome);
 
     // cmap = ConditionsMap();
 
@@ -921,6 +1236,13 @@ void EcoSystem::clear()
     }
 }
 
+PlantIndex * EcoSystem::getPlantIndex()
+{
+    if(!pindex->isCurrent(&esys))
+        pindex->build(&esys);
+    return pindex;
+}
+
 void EcoSystem::pickPlants(Terrain * ter, TypeMap * clusters)
 {
     Region reg = clusters->getRegion();
@@ -946,29 +1268,33 @@ void EcoSystem::pickAllPlants(Terrain * ter, bool canopyOn, bool underStoreyOn)
 }
 
 void EcoSystem::bindPlantsSimplified(Terrain * ter, std::vector<ShapeDrawData> &drawParams, std::vector<bool> * plantvis,
-                                    bool rebind, std::vector<Plane> cullPlanes)
+                                    bool rebind, std::vector<Plane> cullPlanes, const PlantFrustum * frustum)
 {
-    bool applyToTransect = false; // is this bind call for main window or transect window?
-
     // we assume if cullPlanes are defined, its for the transect window (this hold currently)
+    PlantView view = (cullPlanes.size() > 0 ? PlantView::TRANSECT : PlantView::MAIN);
 
-    applyToTransect = (cullPlanes.size() > 0 ? true : false);
+    // plant positions have been updated since the last bindPlants, or the viewpoint may have moved,
+    // in which case the shape grid only does work if the frustum has actually changed
+    if(rebind || frustum != nullptr)
+        eshapes.bindPlantsSimplified(ter, &esys, plantvis, cullPlanes, view, frustum);
 
-    if(rebind) {
-        // plant positions have been updated since the last bindPlants
-        if (applyToTransect == false)
-            eshapes.bindPlantsSimplified(ter, &esys, plantvis, cullPlanes);
-        else
-            transectShapes.bindPlantsSimplified(ter, &esys, plantvis, cullPlanes);
-    }
-
-    if (applyToTransect == false)
-        eshapes.drawPlants(drawParams);
-    else
-        transectShapes.drawPlants(drawParams);
+    eshapes.drawPlants(drawParams, view);
 }
 
 void EcoSystem::placePlant(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const basic_tree &tree)
+{
+    float tx, ty, offx, offy;
+    long terlocx, terlocy, ecolocx, ecolocy;
+
+    ter->getTerrainDim(tx, ty);
+    ter->getTerrainLoc(terlocx, terlocy);
+    cohortmaps->getCohortLoc(ecolocx, ecolocy);
+    offx = (float) (ecolocx-terlocx);
+    offy = (float) (ecolocy-terlocy) * -1.0f;
+    placePlant(ter, nfield, cohortmaps, tree, ter->getHeightFromReal(tx - tree.y+offy, tree.x+offx));
+}
+
+void EcoSystem::placePlant(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const basic_tree &tree, float h)
 {
     float tx, ty;
     int gx, gy;
@@ -992,7 +1318,6 @@ void EcoSystem::placePlant(Terrain *ter, NoiseField * nfield, std::shared_ptr<Co
     // calculate offset of ecosystem corner from terrain corner in global reference
     offx = (float) (ecolocx-terlocx);
     offy = (float) (ecolocy-terlocy) * -1.0f;
-    float h = ter->getHeightFromReal(tx - tree.y+offy, tree.x+offx);
     vpPoint pos(tree.x+offx, h, tx - tree.y+offy);
     // cerr << "h = " << h << endl;
 
@@ -1016,15 +1341,91 @@ void EcoSystem::placePlant(Terrain *ter, NoiseField * nfield, std::shared_ptr<Co
     */
 
     //Plant plnt = {pos, tree.height, tree.radius, coldata};	//XXX: not sure if I should multiply radius by 2 here - according to scaling info in the renderer, 'radius' is actually the diameter, as far as I can see (and visual results also imply this)
-    Plant plnt = {pos, tree.height, tree.radius, rndoff};
+    Plant plnt = {pos, tree.height, tree.radius, rndoff, tree.id};
     esys.placePlant(ter, spc, plnt);
 }
 
 void EcoSystem::placeManyPlants(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const std::vector<basic_tree> &trees)
 {
-    for (int i = 0; i < int(trees.size()); i++)
+    int n = int(trees.size());
+    float tx, ty, offx, offy;
+    long terlocx, terlocy, ecolocx, ecolocy;
+    std::vector<float> wx(n), wz(n), h(n);
+
+    // find the terrain heights under every plant in one query, with the positioning of placePlant
+    ter->getTerrainDim(tx, ty);
+    ter->getTerrainLoc(terlocx, terlocy);
+    cohortmaps->getCohortLoc(ecolocx, ecolocy);
+    offx = (float) (ecolocx-terlocx);
+    offy = (float) (ecolocy-terlocy) * -1.0f;
+    for (int i = 0; i < n; i++)
+    {
+        wx[i] = trees[i].x+offx;
+        wz[i] = tx - trees[i].y+offy;
+    }
+    ter->drapeHeights(n, wx.data(), wz.data(), h.data());
+
+    for (int i = 0; i < n; i++)
     {
         // std::cerr << i << std::endl;
-        placePlant(ter, nfield, cohortmaps, trees[i]);
+        placePlant(ter, nfield, cohortmaps, trees[i], h[i]);
     }
 }
+
+bool EcoSystem::updatePlants(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const std::vector<basic_tree> &trees,
+                             int &births, int &deaths, int &updates)
+{
+    births = deaths = updates = 0;
+
+    // plants without an identity cannot be matched between timesteps, so fall back on a complete rebuild
+    bool identified = (esys.getNumUntracked() == 0);
+    for(int i = 0; i < int(trees.size()) && identified; i++)
+        if(trees[i].id < 0)
+            identified = false;
+
+    if(!identified)
+    {
+        clear();
+        placeManyPlants(ter, nfield, cohortmaps, trees);
+        births = (int) trees.size();
+        return false;
+    }
+
+    // same positioning as placePlant, used to check whether a surviving plant has moved
+    float tx, ty, offx, offy;
+    long terlocx, terlocy, ecolocx, ecolocy;
+
+    ter->getTerrainDim(tx, ty);
+    ter->getTerrainLoc(terlocx, terlocy);
+    cohortmaps->getCohortLoc(ecolocx, ecolocy);
+    offx = (float) (ecolocx-terlocx);
+    offy = (float) (ecolocy-terlocy) * -1.0f;
+
+    // every plant listed for the timestep is claimed, and those left unclaimed at the end have died
+    esys.beginGeneration();
+    for(auto &tree: trees)
+    {
+        int spc;
+        Plant * plnt = esys.claimPlant(tree.id, spc);
+        if(plnt == nullptr)
+        {
+            placePlant(ter, nfield, cohortmaps, tree);
+            births++;
+        }
+        else if(spc != tree.species || plnt->pos.x != tree.x+offx || plnt->pos.z != tx - tree.y+offy)
+        {
+            // species or location change is treated as a replacement
+            esys.removePlant(tree.id);
+            placePlant(ter, nfield, cohortmaps, tree);
+            updates++;
+        }
+        else if(plnt->height != tree.height || plnt->canopy != tree.radius)
+        {
+            esys.updatePlant(tree.id, tree.height, tree.radius);
+            updates++;
+        }
+    }
+
+    deaths = esys.removeUnclaimed();
+    return true;
+}
@@ -31,19 +31,25 @@
 #include "dice_roller.h"
 #include "cohortmaps.h"
 #include "common/basic_types.h"
+#include "plantcull.h"
 #include "unordered_map"
+#include <algorithm>
+#include <functional>
 #include "boost/functional/hash.hpp"
 
 const int maxNiches = 10;  //< maximum number of initial terrain niches from HL system
 const int maxSpecies = 96; // multiplier is for three age categories
 const int pgdim = 50;
 
+class PlantIndex;
+
 struct Plant
 {
     vpPoint pos;    //< position on terrain in world units
     float height;   //< plant height in metres
     float canopy;   //< canopy radius (width?) in metres
     float col;      //< colour variation randomly assigned to plant - scalar applied in shader to plant colour
+    long long id = -1;  //< identity of the source tree across timesteps, -1 if untracked
 };
 
 struct SubSpecies
@@ -90,8 +96,37 @@ public:
 class PlantGrid
 {
 private:
+    /// location of an identified plant within the grid
+    struct PlantRef
+    {
+        int f;  //< flattened cell index
+        int s;  //< species
+        int p;  //< position in the species population of the cell
+        int t;  //< position in the list of tracked plants
+    };
+
     std::vector<PlantPopulation> pgrid; //< flattened grid holding plant populations
     std::vector<std::vector<SubSpecies>> speciesTable; //< name and probabilities for subspecies assignment
+    std::unordered_map<long long, PlantRef> idIndex; //< where each plant with a valid id is stored
+    std::vector<long long> tracked;     //< ids of all plants with a valid id, in no particular order
+    std::vector<long> trackedGen;       //< generation in which each tracked plant was last claimed
+    long generation;                    //< current generation for claiming surviving plants
+    int numClaimed;                     //< tracked plants claimed in the current generation
+    int numUntracked;                   //< number of plants without an id
+    std::vector<long> cellRev;          //< revision stamp per cell, changes whenever any population in the cell is modified
+    long revision;                      //< most recent revision stamp of any cell
+
+    /// record that the populations of a cell have changed
+    void touchCell(int f);
+
+    /// add a plant to a cell and keep the id index up to date
+    void insertPlant(int f, int species, const Plant &plant);
+
+    /// drop a plant from the id index and the list of tracked plants
+    void untrack(long long id);
+
+    /// remove the plant at a given slot by swapping in the last plant of the population
+    void erasePlant(int f, int species, int p);
 
     /// return the row-major linearized value of a grid position
     inline int flatten(int dx, int dy){ return dx * gy + dy; }
@@ -139,6 +174,58 @@ public:
     /// Check whether the grid contains any plants
     bool isEmpty();
 
+    /// Number of plants that were placed without an identity and so cannot be updated incrementally
+    int getNumUntracked(){ return numUntracked; }
+
+    /// Revision stamp for the populations of a cell. Any change to the cell yields a different value.
+    long getCellRevision(int x, int y){ return cellRev[flatten(x, y)]; }
+
+    /// Revision stamp for the grid as a whole, which changes whenever any population is modified
+    long getRevision(){ return revision; }
+
+    /**
+     * @brief findPlant Look up a plant by the identity of its source tree
+     * @param id        tree identity
+     * @param species   species of the plant, if found
+     * @return          pointer to the plant in the grid, nullptr if not present
+     */
+    Plant * findPlant(long long id, int &species);
+
+    /**
+     * @brief updatePlant Change the size of an existing plant without moving it
+     * @param id        tree identity
+     * @param height    new plant height
+     * @param canopy    new canopy width
+     * @retval true if the plant was found
+     */
+    bool updatePlant(long long id, float height, float canopy);
+
+    /**
+     * @brief removePlant Remove a plant by the identity of its source tree
+     * @param id    tree identity
+     * @retval true if the plant was found and removed
+     */
+    bool removePlant(long long id);
+
+    /// Start a new generation, in which no tracked plant has yet been claimed
+    void beginGeneration(){ generation++; numClaimed = 0; }
+
+    /**
+     * @brief claimPlant Look up a plant by the identity of its source tree, marking it as surviving into the
+     *                  current generation. Plants inserted during the generation count as claimed.
+     * @param id        tree identity
+     * @param species   species of the plant, if found
+     * @return          pointer to the plant in the grid, nullptr if not present
+     */
+    Plant * claimPlant(long long id, int &species);
+
+    /**
+     * @brief removeUnclaimed Remove all identified plants not claimed in the current generation. Nothing is
+     *                  scanned when every tracked plant has been claimed.
+     * @return      number of plants removed
+     */
+    int removeUnclaimed();
+
     /**
      * @brief initRnd Set up the underlying noise field
      * @param ter   Corresponding terrain
@@ -244,26 +331,121 @@ public:
 };
 
 /// Plant Rendering
+/// Views that hold their own plant instance buffers
+enum class PlantView
+{
+    MAIN,       //< perspective view
+    TRANSECT,   //< transect view, with plants culled against the transect planes
+    PVEND
+};
+
+/// Summary of the most recent plant bind for a view
+struct PlantBindStats
+{
+    float bindTime = 0.0f;      //< wall clock time taken by the bind in milliseconds
+    int bound = 0;              //< instances held by the view after the bind
+    int culled = 0;             //< plants in rebound cells rejected by the region, plane or size tests
+    int cellsOutside = 0;       //< plant grid cells skipped because they lie outside the view frustum or beyond a cull plane
+    int lodCount[(int) PlantLOD::LODEND] = {0, 0, 0}; //< instances held at each level of detail
+    int cellsRebound = 0;       //< plant grid cells whose instances were gathered afresh
+    int uploaded = 0;           //< instances copied to the instance buffers
+};
+
+/// Callback invoked after every plant bind
+typedef std::function<void(PlantView, const PlantBindStats &)> PlantBindHook;
+
 class ShapeGrid
 {
 private:
-    std::vector<std::vector<Shape>> shapes; //< shape templates for each grid cell and each species
+
+    /// Copy of the contents of an instance buffer, recording which plant grid cell placed each instance and
+    /// which instances have changed since the last upload
+    struct InstancePool
+    {
+        std::vector<glm::vec3> trans;   //< translation of each instance
+        std::vector<glm::vec2> scale;   //< scale (base, height) of each instance
+        std::vector<float> col;         //< colour variation of each instance
+        std::vector<int> owner;         //< plant grid cell that placed each instance
+        std::vector<int> ownerPos;      //< position of each instance in its cell's slot list
+        std::vector<int> dirty;         //< instances changed since the last upload, possibly repeated
+        bool stale = true;              //< if true the whole buffer must be uploaded
+    };
+
+    /// Instances placed by a plant grid cell in one instance buffer
+    struct CellSlots
+    {
+        int b;                  //< lodIndex of the instance buffer
+        std::vector<int> slots; //< positions of the instances in the buffer
+    };
+
+    /// What a view has bound for one plant grid cell
+    struct CellBinding
+    {
+        long rev = -1;                  //< cell revision at the last bind, -1 if never bound
+        int band = -1;                  //< level of detail of the bound instances, -1 if outside the view frustum
+        long boundsRev = -1;            //< cell revision for which the bounds were found
+        glm::vec3 bmin, bmax;           //< bounds of all plants in the cell, in terrain coordinates
+        float tallest = 0.0f;           //< height of the tallest plant in the cell
+        std::vector<CellSlots> slots;   //< instances placed by the cell
+    };
+
+    /// Per-view instance buffers together with the state of the most recent bind, so that only plant grid cells
+    /// whose plants, visibility or level of detail have changed are gathered again and only the instances they
+    /// place are uploaded
+    struct ViewBinding
+    {
+        std::vector<ShapeInstances> instances;  //< instance buffers for each level of detail and species
+        std::vector<InstancePool> pools;        //< contents of each instance buffer
+        std::vector<CellBinding> cells;         //< bound state of each plant grid cell
+        long boundTerrain;                      //< identity of the terrain used for the last bind, -1 if none
+        std::vector<float> boundKey;            //< grid dimensions, region and cull planes used for the last bind
+        std::vector<bool> boundVis;             //< species visibility at the last bind
+        PlantBindStats stats;                   //< cost and outcome of the last bind
+
+        ViewBinding(){ instances.resize((int) PlantLOD::LODEND * maxSpecies); reset(); }
+
+        /// forget the last bind, forcing every cell to be gathered and every buffer to be uploaded afresh
+        void reset()
+        {
+            pools.assign((int) PlantLOD::LODEND * maxSpecies, InstancePool());
+            cells.clear(); boundTerrain = -1; boundKey.clear(); boundVis.clear();
+        }
+    };
+
+    std::vector<Shape> shapes;              //< shape template for each level of detail and species, shared by all views
     Biome * biome;                          //< biome determines shape and colour of trees
-    int gx, gy;                             //< grid dimensions to match a plant grid
+    ViewBinding views[(int) PlantView::PVEND]; //< instance buffers for each view
+    PlantBindHook bindHook;                 //< optional report on each bind
+    PlantLODPolicy lodPolicy;               //< distance thresholds for level of detail selection
 
-    /// return the row-major linearized value of a grid position
-    inline int flatten(int dx, int dy){ return dx * gy + dy; }
+    /// index into per level of detail and species arrays
+    inline int lodIndex(PlantLOD lod, int species){ return (int) lod * maxSpecies + species; }
 
-    /// reset grid to empty state
+    /// slot list of a cell in a given instance buffer, nullptr if the cell places nothing there
+    CellSlots * findSlots(CellBinding &cb, int b);
+
+    /// remove the instance at a slot by moving the last instance of the pool into it, once the slot's cell has let go of it
+    void removeSlot(ViewBinding &vb, int b, int slot);
+
+    /**
+     * @brief uploadPools   Copy the changed instances of every pool into the matching instance buffers,
+     *                      coalescing nearby changes into runs
+     * @param vb            view binding to upload
+     * @retval number of instances copied
+     */
+    int uploadPools(ViewBinding &vb);
+
+    /// reset to an empty state, with every view requiring a fresh bind
     void initGrid(bool assignGeom = true);
 
     /**
       * Create geometry for PFT with sphere top
       * @param trunkheight  proportion of height devoted to bare trunk
       * @param trunkradius  radius of main trunk
+      * @param slices       number of subdivisions around the canopy
       * @param shape        geometry for PFT
       */
-    void genSpherePlant(float trunkheight, float trunkradius, Shape &shape);
+    void genSpherePlant(float trunkheight, float trunkradius, int slices, Shape &shape);
 
     /**
       * Create geometry for PFT with tapered box top
@@ -275,85 +457,84 @@ private:
       */
     void genBoxPlant(float trunkheight, float trunkradius, float taper, float scale, Shape &shape);
 
+    /**
+      * Create a minimal tapered box, without trunk, as a stand-in for any PFT when seen from afar
+      * @param trunkheight  proportion of height devoted to bare trunk
+      * @param shape        geometry for PFT
+      */
+    void genCrudePlant(float trunkheight, Shape &shape);
+
     /**
       * Create geometry for PFT with cone top
       * @param trunkheight  proportion of height devoted to bare trunk
       * @param trunkradius  radius of main trunk
+      * @param slices       number of subdivisions around the canopy
       * @param shape        geometry for PFT
       */
-    void genConePlant(float trunkheight, float trunkradius, Shape &shape);
+    void genConePlant(float trunkheight, float trunkradius, int slices, Shape &shape);
 
     /**
       * Create geometry for PFT with inverted cone top
       * @param trunkheight  proportion of height devoted to bare trunk
       * @param trunkradius  radius of main trunk
+      * @param slices       number of subdivisions around the canopy
       * @param shape        geometry for PFT
       */
-    void genInvConePlant(float trunkheight, float trunkradius, Shape &shape);
+    void genInvConePlant(float trunkheight, float trunkradius, int slices, Shape &shape);
 
     /**
       * Create geometry for PFT with inversted cone top
       * @param trunkheight  proportion of height devoted to bare trunk
       * @param trunkradius  radius of main trunk
+      * @param slices       number of subdivisions around the canopy
       * @param shape        geometry for PFT
       */
-    void genUmbrellaPlant(float trunkheight, float trunkradius, Shape &shape);
+    void genUmbrellaPlant(float trunkheight, float trunkradius, int slices, Shape &shape);
 
     /**
       * Create geometry for PFT with hemisphere top
       * @param trunkheight  proportion of height devoted to bare trunk
       * @param trunkradius  radius of main trunk
+      * @param slices       number of subdivisions around the canopy
       * @param shape        geometry for PFT
       */
-    void genHemispherePlant(float trunkheight, float trunkradius, Shape &shape);
+    void genHemispherePlant(float trunkheight, float trunkradius, int slices, Shape &shape);
 
     /**
       * Create geometry for PFT with cylindrical top
       * @param trunkheight  proportion of height devoted to bare trunk
       * @param trunkradius  radius of main trunk
+      * @param slices       number of subdivisions around the canopy
       * @param shape        geometry for PFT
       */
-    void genCylinderPlant(float trunkheight, float trunkradius, Shape &shape);
+    void genCylinderPlant(float trunkheight, float trunkradius, int slices, Shape &shape);
 
 public:
 
-    ShapeGrid(){ gx = 0; gy = 0; }
-
-    ShapeGrid(int dx, int dy, Biome * shpbiome){ gx = dx; gy = dy; biome = shpbiome; initGrid(); }
-
-    // copy assignment ... assumes that geometry for source shapegrid is present (hacky I know)
-    ShapeGrid& operator=(const ShapeGrid& old)
-    {
-        if (this != &old)
-        {
-            biome = old.biome; gx = old.gx; gy = old.gy;
-
-            delGrid();
-            initGrid(false); // init empty grid only  - geom created ONCE - then copied below
-
-            std::cerr << "ShapeGrid - copy: rows " << shapes.size() << "; Col = " << shapes[0].size() << std::endl;
-
-            // copy grid geom data...
-            for(std::size_t i = 0; i < shapes.size(); i++)
-                for(std::size_t j = 0; j < shapes[i].size(); j++)
-                    shapes[i][j] = old.shapes[i][j];
-
-        }
+    ShapeGrid(){ biome = nullptr; shapes.resize((int) PlantLOD::LODEND * maxSpecies); }
 
-        return *this;
-    }
+    ShapeGrid(Biome * shpbiome){ biome = shpbiome; initGrid(); }
 
+    // shapes own GL buffers which cannot be meaningfully copied
+    ShapeGrid(const ShapeGrid&) = delete;
+    ShapeGrid& operator=(const ShapeGrid&) = delete;
 
     ~ShapeGrid(){ delGrid(); }
 
-    /// completely delete grid
+    /// completely delete grid, freeing GL buffers as far as the current context allows (see Shape::release)
     void delGrid();
 
     /// clear the contents of the grid to empty
     void clear(){ initGrid(); }
 
     /**
-     * Create geometry to represent each of the Functional Plant Types over a grid
+     * @brief releaseView   Delete the instance buffers of a view, so that its next bind starts afresh
+     * @param view          view whose buffers are deleted, requires that view's context to be current
+     */
+    void releaseView(PlantView view);
+
+    /**
+     * Create geometry at each level of detail to represent each of the Functional Plant Types, shared by all views
      */
     void genPlants();
 
@@ -361,24 +542,42 @@ public:
      * @brief attachBiome Call when a new biome is loaded
      * @param shpbiome  Biome to be attached to the ShapeGrid
      */
-    void attachBiome(Biome * shpbiome){ biome = shpbiome; genPlants(); }
+    void attachBiome(Biome * shpbiome){ biome = shpbiome; initGrid(); }
 
     /**
-     * @brief bindPlants    Update positioning information for plants within certain location bounds
-     * @param view          The current viewpoint
+     * @brief bindPlantsSimplified  Update the instance buffers of a view with the positions of all plants on the terrain.
+     *                              Only cells of the plant grid whose plants, visible species, frustum visibility or
+     *                              level of detail have changed since the last bind are gathered again, and only the
+     *                              instances they place are uploaded, so a camera move costs in proportion to the cells
+     *                              that cross a frustum or level of detail boundary.
      * @param ter           Terrain onto which plants will be bound
-     * @param plantvis      Flags for which plant species are visible
      * @param esys          The ecosystem grid
-     * @param region        A bound on the region to be updated
+     * @param plantvis      Flags for which plant species are visible
+     * @param cullPlanes    Plants that straddle or lie beyond any of these planes are not bound, and cells wholly
+     *                      beyond one are skipped without visiting their plants
+     * @param view          View whose instance buffers are updated, requires that view's context to be current
+     * @param frustum       If provided, cells outside this view frustum are not bound and the rest are drawn at a
+     *                      level of detail chosen by their distance. Coordinates are relative to the parent region.
      */
-    void bindPlants(View * view, Terrain * ter, std::vector<bool> * plantvis, PlantGrid * esys, Region region);
-    void bindPlantsSimplified(Terrain * ter, PlantGrid *esys, std::vector<bool> * plantvis, std::vector<Plane> cullPlanes = {});
+    void bindPlantsSimplified(Terrain * ter, PlantGrid *esys, std::vector<bool> * plantvis,
+                              std::vector<Plane> cullPlanes = {}, PlantView view = PlantView::MAIN,
+                              const PlantFrustum * frustum = nullptr);
 
     /**
      * @brief drawPlants    Bundle rendering parameters for instancing lists
      * @param drawParams    Rendering parameters for the different plant species
+     * @param view          View whose instance buffers are to be drawn
      */
-    void drawPlants(std::vector<ShapeDrawData> &drawParams);
+    void drawPlants(std::vector<ShapeDrawData> &drawParams, PlantView view = PlantView::MAIN);
+
+    /// Install a callback that receives the timing of every bind, for example to log per-frame bind cost
+    void setBindHook(PlantBindHook hook){ bindHook = hook; }
+
+    /// Change the level of detail thresholds, taking effect at the next bind
+    void setLODPolicy(const PlantLODPolicy &policy){ lodPolicy = policy; }
+
+    /// Current level of detail thresholds
+    const PlantLODPolicy & getLODPolicy(){ return lodPolicy; }
 };
 
 
@@ -406,15 +605,14 @@ class EcoSystem
 {
 private:
 
-    ShapeGrid eshapes;                //< graphical representation of ecosystem
-    ShapeGrid transectShapes;         //< copy of graphical data for transect view (only subset will be bound, depending
-                                      // on culling planes)
+    ShapeGrid eshapes;                //< graphical representation of ecosystem, with instances for main and transect views
     std::vector<PlantGrid> niches;    //< individual ecosystems for each niche
                                       //< the purpose of niches is to allow a coarse form of selection and rendering
                                       //< by default only the first niche is used
     float maxtreehght;                      //< largest tree height among all loaded species
     PlantGrid esys;                   //< combined output ecosystem
     Biome * biome;                      //< biome matching ecosystem
+    PlantIndex * pindex;                //< spatial index over esys, rebuilt on demand after changes
 
 public:
 
@@ -436,10 +634,25 @@ public:
     /// getPlants: return a pointer to the actual plants in the ecosystem. Assumes pickAllPlants has been called previously.
     PlantGrid * getPlants(){ return &esys; }
 
+    /// getPlantIndex: return a spatial index over the plants in the ecosystem, rebuilding it if plants have changed since the last call
+    PlantIndex * getPlantIndex();
+
+    /// setBindHook: install a callback that reports every plant bind
+    void setBindHook(PlantBindHook hook){ eshapes.setBindHook(hook); }
+
+    /// releaseView: delete the plant instance buffers of a view, requires that view's context to be current
+    void releaseView(PlantView view){ eshapes.releaseView(view); }
+
+    /// setLODPolicy: change the distance thresholds used to select plant level of detail
+    void setLODPolicy(const PlantLODPolicy &policy){ eshapes.setLODPolicy(policy); }
+
+    /// getLODPolicy: distance thresholds currently used to select plant level of detail
+    const PlantLODPolicy & getLODPolicy(){ return eshapes.getLODPolicy(); }
+
     /// getNiche: return a pointer to a particular ecosystem niche (n)
     PlantGrid * getNiche(int n){ return &niches[n]; }
 
-    void setBiome(Biome * ecobiome){ biome = ecobiome; clear(); eshapes.attachBiome(ecobiome); transectShapes = eshapes; }
+    void setBiome(Biome * ecobiome){ biome = ecobiome; clear(); eshapes.attachBiome(ecobiome); }
 
     /**
        * Write plant positions to a PDB format text file
@@ -473,10 +686,31 @@ public:
      * @param plantvis      boolean array of which plant species are to be rendered and which not
      * @param drawParams    parameters for drawing plant species, appended to the current drawing parameters
      * @param bind          whether or not the plants need to be recreated after a change
+     * @param frustum       optional view frustum, relative to the parent region, for culling and level of detail
      */
-    void bindPlantsSimplified(Terrain * ter, std::vector<ShapeDrawData> &drawParams, std::vector<bool> * plantvis, bool bind=false, std::vector<Plane> cullPlanes = {});
+    void bindPlantsSimplified(Terrain * ter, std::vector<ShapeDrawData> &drawParams, std::vector<bool> * plantvis, bool bind=false,
+                              std::vector<Plane> cullPlanes = {}, const PlantFrustum * frustum = nullptr);
     void placePlant(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const basic_tree &tree);
+
+    /// As above, but with the terrain height at the plant already known, as found by placeManyPlants in one batch
+    void placePlant(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const basic_tree &tree, float h);
     void placeManyPlants(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const std::vector<basic_tree> &trees);
+
+    /**
+     * Bring the ecosystem in line with a new set of trees (typically the next or previous timestep) by applying only
+     * births, deaths and attribute changes. Trees are matched on basic_tree::id. If any tree or placed plant lacks an
+     * identity the ecosystem is rebuilt from scratch instead.
+     * @param ter           terrain onto which plants will be placed
+     * @param nfield        noise field for colour variation
+     * @param cohortmaps    cohort data, providing the ecosystem location
+     * @param trees         complete set of trees for the new timestep
+     * @param births        number of plants added
+     * @param deaths        number of plants removed
+     * @param updates       number of plants whose size changed
+     * @retval true if the update was incremental, false if a full rebuild was needed
+     */
+    bool updatePlants(Terrain *ter, NoiseField * nfield, std::shared_ptr<CohortMaps> cohortmaps, const std::vector<basic_tree> &trees,
+                      int &births, int &deaths, int &updates);
 };
 
 #endif
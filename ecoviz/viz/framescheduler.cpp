@@ -0,0 +1,145 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "framescheduler.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+static const int reportInterval = 60; ///< frames between reports when reporting is on
+static const char * reasonNames[] = {"camera", "plants", "overlay", "transect", "other"};
+
+FrameScheduler::FrameScheduler(QObject * parent) : QObject(parent)
+{
+    reporting = false;
+    requests = paints = suppressed = frames = 0;
+    for(int r = 0; r < 5; r++)
+        reasonCount[r] = 0;
+    binds = bindCells = bindInstances = 0;
+    bindTime = 0.0;
+    steps = births = deaths = updates = 0;
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(flush()));
+    clock.start();
+}
+
+int FrameScheduler::frameInterval()
+{
+    QScreen * screen = QGuiApplication::primaryScreen();
+    qreal rate = (screen != nullptr ? screen->refreshRate() : 60.0);
+    if(rate < 1.0)
+        rate = 60.0;
+    return std::max(1, (int) std::floor(1000.0 / rate));
+}
+
+void FrameScheduler::request(QWidget * view, unsigned reasons)
+{
+    if(view == nullptr)
+        return;
+
+    requests++;
+    for(int r = 0; r < 5; r++)
+        if(reasons & (1u << r))
+            reasonCount[r]++;
+
+    // merge into an existing entry so that the view is only painted once
+    for(auto &p: pending)
+        if(p.view == view)
+        {
+            p.reasons |= reasons;
+            suppressed++;
+            return;
+        }
+    pending.push_back({QPointer<QWidget>(view), reasons});
+
+    // wait out the remainder of the current frame, so requests arriving in a burst share one flush
+    if(!timer.isActive())
+    {
+        int wait = frameInterval() - (int) clock.elapsed();
+        timer.start(std::max(0, wait));
+    }
+}
+
+void FrameScheduler::countBind(float ms, int cells, int instances)
+{
+    binds++;
+    bindCells += cells;
+    bindInstances += instances;
+    bindTime += ms;
+}
+
+void FrameScheduler::countStep(int born, int died, int updated)
+{
+    steps++;
+    births += born;
+    deaths += died;
+    updates += updated;
+}
+
+void FrameScheduler::flush()
+{
+    std::vector<Pending> current;
+
+    // requests made while preparing views belong to the next frame
+    current.swap(pending);
+    clock.restart();
+
+    for(auto &p: current)
+    {
+        if(p.view.isNull())
+            continue;
+        ScheduledView * sview = dynamic_cast<ScheduledView *>(p.view.data());
+        if(sview != nullptr)
+            sview->prepareFrame(p.reasons);
+        p.view->update();
+        paints++;
+    }
+
+    frames++;
+    if(reporting && frames >= reportInterval)
+        report();
+}
+
+void FrameScheduler::report()
+{
+    cerr << "frame scheduler: " << frames << " frames, " << requests << " requests, " << paints << " paints, "
+         << suppressed << " redundant paints suppressed (";
+    for(int r = 0; r < 5; r++)
+        cerr << reasonNames[r] << " " << reasonCount[r] << (r < 4 ? ", " : ")");
+    cerr << endl;
+    if(binds > 0)
+        cerr << "frame scheduler: " << binds << " plant binds taking " << bindTime << " ms, " << bindCells << " cells rebound, "
+             << bindInstances << " instances uploaded" << endl;
+    if(steps > 0)
+        cerr << "frame scheduler: " << steps << " timestep changes with " << births << " births, " << deaths << " deaths, "
+             << updates << " updates" << endl;
+
+    requests = paints = suppressed = frames = 0;
+    for(int r = 0; r < 5; r++)
+        reasonCount[r] = 0;
+    binds = bindCells = bindInstances = 0;
+    bindTime = 0.0;
+    steps = births = deaths = updates = 0;
+}
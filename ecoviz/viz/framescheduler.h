@@ -0,0 +1,135 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+// framescheduler.h: coalesces repaint requests from linked views into at most one paint per view per display refresh
+
+#ifndef _framescheduler_h
+#define _framescheduler_h
+
+#include <QObject>
+#include <QWidget>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+
+/**
+ * A view that can do expensive per-frame preparation, such as rebinding plant instances,
+ * before it is repainted, so that the work happens once per frame and outside paintGL.
+ */
+class ScheduledView
+{
+public:
+    virtual ~ScheduledView(){}
+
+    /**
+     * @brief prepareFrame  Called by the scheduler just before the view is asked to repaint
+     * @param reasons       bitwise or of FrameScheduler::Reason values accumulated since the last frame
+     */
+    virtual void prepareFrame(unsigned reasons) = 0;
+};
+
+/**
+ * Collects repaint requests from all views. Each request marks a view dirty with a reason, and dirty views are
+ * flushed together at most once per display refresh, so that a burst of requests from linked views (camera moves
+ * mirrored across both perspective views, timeline steps that rebind plants in every view) results in a single
+ * paint per view rather than one per request.
+ */
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /// reasons a view needs repainting, combined as a bit mask
+    enum Reason
+    {
+        CAMERA = 1 << 0,    ///< viewpoint or zoom changed
+        PLANTS = 1 << 1,    ///< plant set or visibility changed and instances must be rebound
+        OVERLAY = 1 << 2,   ///< texture overlay or rendering parameters changed
+        TRANSECT = 1 << 3,  ///< transect position or thickness changed
+        OTHER = 1 << 4,     ///< anything else
+        ALL = 0x1f
+    };
+
+    FrameScheduler(QObject * parent = nullptr);
+
+    /**
+     * @brief request   Mark a view as needing a repaint on the next frame
+     * @param view      view to repaint, ignored if nullptr
+     * @param reasons   bitwise or of Reason values
+     */
+    void request(QWidget * view, unsigned reasons);
+
+    /// Turn periodic reporting of request and paint counts to cerr on or off
+    void setReporting(bool on){ reporting = on; }
+    bool getReporting(){ return reporting; }
+
+    /// Print request, paint and suppression counts since the last report to cerr, then reset them
+    void report();
+
+    /**
+     * @brief countBind Count a plant instance bind towards the next report
+     * @param ms        wall clock time taken by the bind in milliseconds
+     * @param cells     plant grid cells gathered afresh
+     * @param instances instances copied to the instance buffers
+     */
+    void countBind(float ms, int cells, int instances);
+
+    /**
+     * @brief countStep Count a timestep change of the ecosystem towards the next report
+     * @param born      plants added
+     * @param died      plants removed
+     * @param updated   plants whose size or placement changed
+     */
+    void countStep(int born, int died, int updated);
+
+    /// Number of requests absorbed by a view that was already waiting to be painted, since the last report
+    long getSuppressed(){ return suppressed; }
+
+private slots:
+
+    /// prepare and repaint every dirty view
+    void flush();
+
+private:
+
+    struct Pending
+    {
+        QPointer<QWidget> view; //< view to repaint, cleared automatically if the widget is deleted
+        unsigned reasons;       //< accumulated reasons since the last frame
+    };
+
+    std::vector<Pending> pending;   //< views waiting for the next frame, in request order
+    QTimer timer;                   //< single shot timer for the next flush
+    QElapsedTimer clock;            //< time since the last flush
+    bool reporting;                 //< print counts every reportInterval frames
+    long requests, paints, suppressed, frames; //< counts since the last report
+    long reasonCount[5];            //< requests per reason since the last report
+    long binds, bindCells, bindInstances; //< plant binds, cells rebound and instances uploaded since the last report
+    double bindTime;                //< milliseconds spent in plant binds since the last report
+    long steps, births, deaths, updates; //< ecosystem timestep changes and their plant counts since the last report
+
+    /// milliseconds between display refreshes
+    int frameInterval();
+};
+
+#endif
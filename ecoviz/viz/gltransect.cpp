@@ -126,12 +126,12 @@ GLTransect::GLTransect(const QSurfaceFormat& format, Window * wp, Scene * scn, T
 void GLTransect::switchTransectScene(Scene *newScene, Transect *newTransect)
 {
     trx = newTransect;
-    viewlock = false;
     timeron = false;
     rebindplants = true;
     scf = 10000.0f;
 
     setScene(newScene);
+    viewlock = false;
 
     focuschange = true;
     forceRebindPlants = true;
@@ -139,6 +139,12 @@ void GLTransect::switchTransectScene(Scene *newScene, Transect *newTransect)
 
 GLTransect::~GLTransect()
 {
+    // the context outlives this destructor, so release now rather than on its signal
+    if(context() != nullptr)
+    {
+        disconnect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &GLTransect::cleanupGL);
+        cleanupGL();
+    }
     if (renderer) delete renderer;
 }
 
@@ -196,6 +202,8 @@ void GLTransect::updateTransectView()
 void GLTransect::setScene(Scene * s)
 {
     scene = s;
+    if(view != nullptr && !viewlock) // a locked view belongs to the transect view it is locked to
+        delete view;
     view = new View();
 
     float tx, ty;
@@ -287,6 +295,10 @@ PMrender::TRenderer::terrainShadingModel sMod = PMrender::TRenderer::RADIANCE_SC
     // set terrain shading model
     renderer->setTerrShadeModel(sMod);
 
+    // supersampling costs four times the fill in this small panel, whereas multisampling only pays at the
+    // thin plant and transect edges that need it
+    renderer->setRenderQuality(PMrender::TRenderer::MSAA);
+
     // set up light
     Vector dl = Vector(0.6f, 1.0f, 0.6f);
     dl.normalize();
@@ -324,9 +336,22 @@ PMrender::TRenderer::terrainShadingModel sMod = PMrender::TRenderer::RADIANCE_SC
     glEnable(GL_MULTISAMPLE);
     glEnable(GL_TEXTURE_2D);
 
+    // Qt also replaces the context when the widget is reparented, so objects tied to it are released on its way out
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &GLTransect::cleanupGL);
+
     paintGL();
 }
 
+void GLTransect::cleanupGL()
+{
+    // plant vertex arrays belong to this context and cannot be reused in another, so the next bind starts afresh
+    makeCurrent();
+    scene->getEcoSys()->releaseView(PlantView::TRANSECT);
+    rebindplants = true;
+    forceRebindPlants = true;
+    doneCurrent();
+}
+
 void GLTransect::paintCyl(vpPoint p, GLfloat * col, std::vector<ShapeDrawData> &drawParams)
 {
     ShapeDrawData sdd;
@@ -664,4 +689,23 @@ void GLTransect::rebindPlants()
 {
     rebindplants = true;
     forceRebindPlants = true;
+    winparent->getScheduler()->request(this, FrameScheduler::PLANTS);
+}
+
+void GLTransect::prepareFrame(unsigned reasons)
+{
+    if(!active || !isValid() || !(focuschange || forceRebindPlants))
+        return;
+
+    if(rebindplants || (reasons & (FrameScheduler::PLANTS | FrameScheduler::TRANSECT)))
+    {
+        std::vector<ShapeDrawData> drawParams;
+
+        makeCurrent();
+        updateTransectView(); // the transect planes may have moved since the last paint
+        scene->getEcoSys()->bindPlantsSimplified(scene->getTerrain(), drawParams, &plantvis, rebindplants, transectPlanes);
+        rebindplants = false;
+        forceRebindPlants = false;
+        doneCurrent();
+    }
 }
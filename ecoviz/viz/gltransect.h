@@ -77,12 +77,13 @@
 #include "view.h"
 #include "timewindow.h"
 #include "progressbar_window.h"
+#include "framescheduler.h"
 
 //! [0]
 
 class Window;
 
-class GLTransect : public QOpenGLWidget, protected QOpenGLFunctions
+class GLTransect : public QOpenGLWidget, protected QOpenGLFunctions, public ScheduledView
 {
     Q_OBJECT
 
@@ -96,6 +97,12 @@ public:
 
     void setParent(Window * wp){ winparent = wp; }
 
+    /**
+     * @brief prepareFrame  Rebind plant instances within the transect ahead of a scheduled repaint
+     * @param reasons       bitwise or of FrameScheduler::Reason values
+     */
+    void prepareFrame(unsigned reasons) override;
+
     /// getters for currently active view, terrain, typemaps, renderer, ecosystem
     PMrender::TRenderer * getRenderer();
 
@@ -160,6 +167,9 @@ signals:
 public slots:
     void rebindPlants(); // set flag indicating that plants need to be re-bound
 
+private slots:
+    void cleanupGL(); // free GL objects held for this view before its context goes
+
 protected:
     void initializeGL();
     void paintGL();
@@ -61,6 +61,7 @@
 
 #include "glwidget.h"
 #include "eco.h"
+#include "plantindex.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -89,6 +90,7 @@ using namespace std;
 
 static int curr_cohortmap = 0;
 static int curr_tstep = 1;
+static const int frameReportInterval = 30; //< frames averaged for each frame time report
 
 GLWidget::GLWidget(const QSurfaceFormat& format, Window * wp, Scene * scn, Transect * trans, const std::string &widName, mapScene *mScene, QWidget *parent)
     : QOpenGLWidget(parent)
@@ -104,6 +106,9 @@ GLWidget::GLWidget(const QSurfaceFormat& format, Window * wp, Scene * scn, Trans
     rtimer = new QTimer(this);
     connect(rtimer, SIGNAL(timeout()), this, SLOT(rotateUpdate()));
 
+    itimer = new QTimer(this);
+    itimer->setSingleShot(true);
+    connect(itimer, SIGNAL(timeout()), this, SLOT(endInteraction()));
 
     setParent(wp);
 
@@ -123,6 +128,8 @@ GLWidget::GLWidget(const QSurfaceFormat& format, Window * wp, Scene * scn, Trans
     focuschange = false;
     focusviz = false;
     timeron = false;
+    frameTimeSum = 0.0f;
+    frameTimeCount = 0;
     active = false;
     persRotating = false;
     painted = false;
@@ -143,11 +150,22 @@ GLWidget::~GLWidget()
 {
     delete atimer;
     delete rtimer;
+    delete itimer;
     if(vizpopup) delete vizpopup;
 
+    // the context outlives this destructor, so release now rather than on its signal
+    if(context() != nullptr)
+    {
+        disconnect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &GLWidget::cleanupGL);
+        cleanupGL();
+    }
+
+    // renderers and the overview cache hold GL resources in this widget's context
+    makeCurrent();
     if (renderer) delete renderer;
 
     if (mapView) delete mapView;
+    doneCurrent();
 
     // PCM removed - this seems like it should not be here?
    // if (decalTexture != 0)	glDeleteTextures(1, &decalTexture);
@@ -213,6 +231,11 @@ void GLWidget::setScene(Scene * s)
     scf = scene->getTerrain()->getMaxExtent();
     scene->getTerrain()->setBufferToDirty();
 
+    // plant binds in any view of this ecosystem are included in the frame scheduler reports
+    FrameScheduler * sched = winparent->getScheduler();
+    scene->getEcoSys()->setBindHook([sched](PlantView, const PlantBindStats &stats)
+        { sched->countBind(stats.bindTime, stats.cellsRebound, stats.uploaded); });
+
     // transect setup
     float rw, rh;
     scene->getTerrain()->getTerrainDim(rw, rh);
@@ -246,6 +269,16 @@ void GLWidget::setScene(Scene * s)
      signalRepaintAllGL();
 }
 
+void GLWidget::switchPerspectiveScene(Scene * s)
+{
+    View preview = (* view);
+
+    trc->trxstate = -1; // a transect under construction belonged to the previous terrain
+    setScene(s);
+    (* view) = preview;
+    view->setForcedFocus(scene->getTerrain()->getFocus()); // otherwise focus change is not copied from terrain
+}
+
 void GLWidget::changeViewMode(ViewMode vm)
 {
     view->setViewMode(vm);
@@ -367,6 +400,9 @@ void GLWidget::initializeGL()
     // set terrain shading model
     renderer->setTerrShadeModel(sMod);
 
+    // the main view is large enough to warrant supersampling; 'Q' cycles through the alternatives
+    renderer->setRenderQuality(PMrender::TRenderer::SUPERSAMPLE_2X);
+
     // set up light
     Vector dl = Vector(0.6f, 1.0f, 0.6f);
     dl.normalize();
@@ -406,9 +442,22 @@ void GLWidget::initializeGL()
     glEnable(GL_DEPTH_CLAMP);
     glEnable(GL_TEXTURE_2D);
 
+    // Qt also replaces the context when the widget is reparented, so objects tied to it are released on its way out
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &GLWidget::cleanupGL);
+
     paintGL();
 }
 
+void GLWidget::cleanupGL()
+{
+    // plant vertex arrays belong to this context and cannot be reused in another, so the next bind starts afresh
+    makeCurrent();
+    scene->getEcoSys()->releaseView(PlantView::MAIN);
+    rebindplants = true;
+    if (mapView) mapView->releaseCache();
+    doneCurrent();
+}
+
 void GLWidget::paintCyl(vpPoint p, GLfloat * col, std::vector<ShapeDrawData> &drawParams)
 {
     ShapeDrawData sdd;
@@ -473,33 +522,24 @@ void GLWidget::paintSphere(vpPoint p, GLfloat * col, std::vector<ShapeDrawData>
 
 void GLWidget::createLine(vector<vpPoint> * line, vpPoint start, vpPoint end, float hghtoffset)
 {
-    vpPoint pnt;
-    Vector del;
     float tx, ty;
 
     scene->getTerrain()->getTerrainDim(tx, ty);
-    int steps = 200;
-    del.diff(start, end);
+    const int steps = 200;
+    std::vector<float> wx(steps+1), wz(steps+1), h(steps+1);
 
-    del.mult(1.0f / (float) steps);
-    pnt = start;
-    line->push_back(pnt);
-    for(int j = 0; j < steps; j++)
+    wx[0] = start.x; wz[0] = start.z;
+    for(int j = 1; j <= steps; j++)
     {
-        del.pntplusvec(pnt, &pnt);
-        if(pnt.x >= ty-tolzero) pnt.x = ty-tolzero;
-        if(pnt.x <= tolzero) pnt.x = tolzero;
-        pnt.y = 1.0f;
-        if(pnt.z >= tx-tolzero) pnt.z = tx-tolzero;
-        if(pnt.z <= tolzero) pnt.z = tolzero;
-        line->push_back(pnt);
+        float t = (float) j / (float) steps;
+        wx[j] = std::min(std::max(start.x + t * (end.x - start.x), tolzero), ty-tolzero);
+        wz[j] = std::min(std::max(start.z + t * (end.z - start.z), tolzero), tx-tolzero);
     }
 
-    drapeProject(line, line, scene->getTerrain());
-
-    // add height offset to all line positions
-    for(int j = 0; j < (int) line->size(); j++)
-        (* line)[j].y += hghtoffset;
+    // drape all positions at once and lift them by the height offset
+    scene->getTerrain()->drapeHeights(steps+1, wx.data(), wz.data(), h.data());
+    for(int j = 0; j <= steps; j++)
+        line->push_back(vpPoint(wx[j], h[j] + hghtoffset, wz[j]));
 }
 
 void GLWidget::createTransectShape(float hghtoffset)
@@ -593,7 +633,6 @@ void GLWidget::paintGL()
                 paintSphere(trc->trx->getClampedInnerEnd(), transectCol, drawParams);
                 paintTransect(transectCol, drawParams);
                 // paintCyl(trx->getCenter(), transectCol, drawParams);
-                signalRebindTransectPlants(); // PCM...see if this works
             }
             if(trc->trxstate == 1)
             {
@@ -622,7 +661,9 @@ void GLWidget::paintGL()
         // prepare plants for rendering
         if(focuschange)
         {
-            scene->getEcoSys()->bindPlantsSimplified(scene->getTerrain(), drawParams, &plantvis, rebindplants);
+            // plants outside the view are skipped and distant plants drawn with simpler geometry
+            PlantFrustum frustum(view->getProjMtx(), view->getViewMtx());
+            scene->getEcoSys()->bindPlantsSimplified(scene->getTerrain(), drawParams, &plantvis, rebindplants, {}, &frustum);
             rebindplants = false;
         }
 
@@ -630,7 +671,7 @@ void GLWidget::paintGL()
         renderer->setConstraintDrawParams(drawParams);
 
         // draw terrain and plants
-        renderer->forceTextureRebind();
+        renderer->bindTextures(); // the overview renderer shares this context and may have replaced our bindings
         //scene->getTerrain()->setBufferToDirty();
 
         if (drawParams.size() > 0) // DEBUG: PCM
@@ -644,6 +685,7 @@ void GLWidget::paintGL()
             renderer->updateTypeMapTexture(scene->getTypeMap(getOverlay())); // only necessary if the texture is changing dynamically
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer->setInteractive(view->isMoving());
         renderer->draw(view);
 
         // ** overview map draw : draw on resrtricted viewport:
@@ -661,6 +703,7 @@ void GLWidget::paintGL()
                 mapView->setWindowSize();
                 mapView->resetViewDims();
                 mapView->setTerrainReady(true);
+                mapView->invalidateCache();
             }
 
             // mapView->getWindowSize(wd,ht); // JG - viewport and window coordinates are different on Apple
@@ -694,10 +737,23 @@ void GLWidget::paintGL()
             // ** end overview map draw **
         }
 
+        if(timeron)
+            glFinish(); // include the GPU work in the measured time
         t.stop();
 
         if(timeron)
-            cerr << "rendering = " << t.peek() << " fps = " << 1.0f / t.peek() << endl;
+        {
+            // report a mean over several frames, since individual frame times are noisy
+            frameTimeSum += t.peek();
+            frameTimeCount++;
+            if(frameTimeCount == frameReportInterval)
+            {
+                float mean = frameTimeSum / (float) frameTimeCount;
+                cerr << "frame time = " << mean * 1000.0f << "ms fps = " << 1.0f / mean << endl;
+                frameTimeSum = 0.0f;
+                frameTimeCount = 0;
+            }
+        }
         /*
         if(!painted)
             cerr << "first paint" << endl;
@@ -756,7 +812,15 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
     {
         focusviz = !focusviz;
         winparent->rendercount++;
-        update();
+        winparent->getScheduler()->request(this, FrameScheduler::OTHER);
+    }
+    if(event->key() == Qt::Key_L) // 'L' to toggle plant level of detail, drawing every plant in full when off
+    {
+        PlantLODPolicy policy = scene->getEcoSys()->getLODPolicy();
+        policy.enabled = !policy.enabled;
+        scene->getEcoSys()->setLODPolicy(policy);
+        cerr << wname << " plant level of detail " << (policy.enabled ? "on" : "off") << endl;
+        rebindPlants();
     }
 
     if(event->key() == Qt::Key_N) // 'N' to save overview map selection
@@ -775,7 +839,7 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
     {
         overviewEnabled = ! overviewEnabled; // toggle ovewviewmap
         winparent->rendercount++;
-        update();
+        winparent->getScheduler()->request(this, FrameScheduler::OTHER);
     }
 
     /*
@@ -801,6 +865,19 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
     }
     */
 
+    if(event->key() == Qt::Key_Q) // 'Q' to cycle render quality of this view
+    {
+        const char * names[] = {"native", "2x supersampling", "multisampling", "FXAA"};
+        int q = ((int) renderer->getRenderQuality() + 1) % 4;
+        setRenderQuality((PMrender::TRenderer::renderQuality) q);
+        cerr << wname << " render quality: " << names[q] << endl;
+    }
+    if(event->key() == Qt::Key_R) // 'R' to toggle frame time reporting
+    {
+        timeron = !timeron;
+        frameTimeSum = 0.0f;
+        frameTimeCount = 0;
+    }
     if(event->key() == Qt::Key_S || event->key() == Qt::Key_Down) // 'S' fly backwards
     {
         view->incrFly(40.0f);
@@ -898,9 +975,8 @@ void GLWidget::setCanopyVis(bool vis)
     setAllPlantsVis();
     canopyvis = vis; // toggle canopy visibility
     scene->getEcoSys()->pickAllPlants(scene->getTerrain(), canopyvis, undervis);
-    rebindplants = true;
     winparent->rendercount++;
-    update();
+    rebindPlants();
 }
 
 void GLWidget::setUndergrowthVis(bool vis)
@@ -908,9 +984,8 @@ void GLWidget::setUndergrowthVis(bool vis)
     setAllPlantsVis();
     undervis = vis;
     scene->getEcoSys()->pickAllPlants(scene->getTerrain(), canopyvis, undervis);
-    rebindplants = true;
     winparent->rendercount++;
-    update();
+    rebindPlants();
 }
 
 void GLWidget::setAllSpecies(bool vis)
@@ -918,9 +993,8 @@ void GLWidget::setAllSpecies(bool vis)
     for(int i = 0; i < static_cast<int>(plantvis.size()); i++)
         plantvis[i] = vis;
     scene->getEcoSys()->pickAllPlants(scene->getTerrain(), canopyvis, undervis);
-    rebindplants = true;
     winparent->rendercount++;
-    update();
+    rebindPlants();
 }
 
 void GLWidget::setSinglePlantVis(int p)
@@ -931,9 +1005,8 @@ void GLWidget::setSinglePlantVis(int p)
             plantvis[i] = false;
         plantvis[p] = true;
         scene->getEcoSys()->pickAllPlants(scene->getTerrain(), canopyvis, undervis);
-        rebindplants = true;
         winparent->rendercount++;
-        update();
+        rebindPlants();
     }
     else
     {
@@ -947,9 +1020,8 @@ void GLWidget::toggleSpecies(int p, bool vis)
     {
         plantvis[p] = vis;
         scene->getEcoSys()->pickAllPlants(scene->getTerrain(), canopyvis, undervis);
-        rebindplants = true;
         winparent->rendercount++;
-        update();
+        rebindPlants();
     }
     else
     {
@@ -1001,7 +1073,7 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
             mapView->startRegionTranslate(ox, oy);
 
         if(mapView->getPickOnTerrain())
-            update();
+            winparent->getScheduler()->request(this, FrameScheduler::OTHER);
     }
     else
     {
@@ -1052,6 +1124,47 @@ void GLWidget::mouseDoubleClickEvent(QMouseEvent *event)
         }
         // ignores pick if terrain not intersected, should possibly provide error message to user
     }
+    else if(event->buttons() == Qt::LeftButton) // plain double click reports the tree under the cursor
+    {
+        if(!pickPlant(sx, sy))
+            cerr << "No plant under cursor" << endl;
+    }
+}
+
+bool GLWidget::pickPlant(int sx, int sy)
+{
+    vpPoint start;
+    Vector dirn;
+    const IndexedPlant * hit;
+    float tval;
+    Region parentRegion;
+    float parentX0, parentY0, parentX1, parentY1, parentDimx, parentDimy;
+
+    view->apply();
+    view->projectingRay(sx, sy, start, dirn);
+
+    // plants are indexed in the coordinates of the parent terrain, while the view is over the sub-terrain
+    if(scene->getTerrain()->getSourceRegion(parentRegion, parentX0, parentY0, parentX1, parentY1, parentDimx, parentDimy))
+    {
+        start.x += parentY0; // PCM: this x/y flip is very confusing...
+        start.z += parentX0;
+    }
+
+    PlantIndex * pindex = scene->getEcoSys()->getPlantIndex();
+    if(!pindex->queryRay(start, dirn, &plantvis, hit, tval))
+        return false;
+    const Plant &plnt = pindex->getPlant(* hit);
+
+    cerr << endl;
+    cerr << "*** PLANT INFO ***" << endl;
+    cerr << "Species: " << hit->species;
+    if(hit->species < scene->getBiome()->numPFTypes())
+        cerr << " (" << scene->getBiome()->getPFType(hit->species)->code << ")";
+    cerr << endl;
+    cerr << "Tree id: " << plnt.id << endl;
+    cerr << "Height (m): " << plnt.height << "; Canopy (m): " << plnt.canopy << endl;
+    cerr << "Position: " << plnt.pos.x << ", " << plnt.pos.y << ", " << plnt.pos.z << endl;
+    return true;
 }
 
 void GLWidget::pickInfo(int x, int y)
@@ -1171,7 +1284,7 @@ void GLWidget::mouseReleaseEvent(QMouseEvent *event)
                     pointPlaceTransect(true);
                     signalSyncPlace(true);
                     winparent->rendercount++;
-                    update();
+                    winparent->getScheduler()->request(this, FrameScheduler::TRANSECT);
                 }
                 break;
             case 1: // placement of final point
@@ -1222,7 +1335,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
             mapView->continueRegionTranslate(ox, oy);
 
         if(mapView->getPickOnTerrain())
-            update();
+            winparent->getScheduler()->request(this, FrameScheduler::OTHER);
     }
     else
     {
@@ -1232,6 +1345,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
             nx = (2.0f * (float) x - W) / W;
             ny = (H - 2.0f * (float) y) / H;
             view->arcRotate(nx, ny);
+            beginInteraction();
 
             refreshViews();
         }
@@ -1266,6 +1380,7 @@ void GLWidget::wheelEvent(QWheelEvent * wheel)
     else // otherwise adjust view zoom
     {
         view->incrZoom(del);
+        beginInteraction();
         if(trc->showtransect)
             trc->trx->setChangeFlag(); // render thickness of transects depends on zoom
     }
@@ -1275,32 +1390,74 @@ void GLWidget::wheelEvent(QWheelEvent * wheel)
 void GLWidget::animUpdate()
 {
     if(view->animate())
-         refreshViews();
+    {
+        beginInteraction();
+        refreshViews();
+    }
 }
 
 void GLWidget::rotateUpdate()
 {
     if(view->spin())
+    {
+        beginInteraction();
         refreshViews();
+    }
+}
+
+void GLWidget::beginInteraction()
+{
+    // ms of stillness before the camera is considered settled; long enough to span gaps between mouse events
+    const int settleTime = 250;
+
+    view->setMoving(true);
+    itimer->start(settleTime);
+}
+
+void GLWidget::endInteraction()
+{
+    view->setMoving(false);
+    refreshViews(); // a locked partner shares the view, so is refined as well
+}
+
+void GLWidget::setRenderQuality(PMrender::TRenderer::renderQuality q)
+{
+    renderer->setRenderQuality(q);
+    refreshViews();
 }
 
 void GLWidget::rebindPlants()
 {
     rebindplants = true;
+    winparent->getScheduler()->request(this, FrameScheduler::PLANTS);
 }
 
-void GLWidget::refreshViews()
+void GLWidget::prepareFrame(unsigned reasons)
 {
-    if(viewlock)
+    if(!active || !focuschange || !isValid())
+        return;
+
+    // the frustum changes with the camera, so the bind is repeated here rather than inside paintGL,
+    // whose own bind then finds the instances already current
+    if(rebindplants || (reasons & (FrameScheduler::CAMERA | FrameScheduler::PLANTS)))
     {
-        winparent->rendercount++;
-        signalRepaintAllGL();
+        std::vector<ShapeDrawData> drawParams;
+
+        makeCurrent();
+        PlantFrustum frustum(view->getProjMtx(), view->getViewMtx());
+        scene->getEcoSys()->bindPlantsSimplified(scene->getTerrain(), drawParams, &plantvis, rebindplants, {}, &frustum);
+        rebindplants = false;
+        doneCurrent();
     }
+}
+
+void GLWidget::refreshViews()
+{
+    winparent->rendercount++;
+    if(viewlock) // the partner view shares the camera, so must also treat this as a move
+        signalRepaintAllMoved();
     else
-    {
-        winparent->rendercount++;
-        update();
-    }
+        winparent->getScheduler()->request(this, FrameScheduler::CAMERA);
 }
 
 /// overviewmap methods: these methods refer to the part of the main viewport on which the map is overdrawn
@@ -1314,6 +1471,13 @@ overviewWindow::overviewWindow(mapScene * scn)
 
     ovw = 50; ovh = 50;
 
+    cacheFBO = cacheTexture = 0;
+    cacheWd = cacheHt = 0;
+    cacheValid = false;
+    cacheTerrain = nullptr;
+    cacheRevision = -1;
+    contourInterval = 0.0f;
+
     setScene(scn);
     active = true;
     timeron = false;
@@ -1329,6 +1493,8 @@ overviewWindow::overviewWindow(mapScene * scn)
 
 overviewWindow::~overviewWindow()
 {
+    // the owning widget makes its context current before deleting the overview
+    releaseCache();
     if (mrenderer) delete mrenderer;
     if (mview) delete mview;
 }
@@ -1359,6 +1525,7 @@ void overviewWindow::setWindowSize(void)
 void overviewWindow::setScene(mapScene * s)
 {
     scene = s;
+    cacheValid = false;
 
     if (mview != nullptr) delete mview;
 
@@ -1456,6 +1623,9 @@ void overviewWindow::initializeMapRenderer(void)
     // set terrain shading model
     mrenderer->setTerrShadeModel(sMod);
 
+    // the overview is a small inset, so render it at native resolution and smooth edges afterwards
+    mrenderer->setRenderQuality(PMrender::TRenderer::POST_AA);
+
     // set up light
     Vector dl = Vector(0.6f, 1.0f, 0.6f);
     dl.normalize();
@@ -1610,47 +1780,36 @@ void overviewWindow::paintSphere(vpPoint p, GLfloat * col, std::vector<ShapeDraw
 
 void overviewWindow::draw(void)
 {
-    vpPoint mo;
-    //glm::mat4 tfm, idt;
-    //glm::vec3 trs, rot;
-    std::vector<ShapeDrawData> drawParams; // to be passed to terrain renderer
-    Shape shape, planeshape;  // geometry for focus indicator
-    std::vector<glm::mat4> sinst;
-    std::vector<glm::vec4> cinst;
-
-    GLfloat blueish[] = {0.325f, 0.235f, 1.0f, 1.0f};
-    GLfloat purpleish[] = {0.6f, 0.2f, 0.8f, 1.0f};
+    GLfloat blueish[] = {0.325f, 0.235f, 1.0f, 0.4f};
+    GLfloat purpleish[] = {0.6f, 0.2f, 0.8f, 0.4f};
     //GLfloat pickCol[] = {1.0f, 0.2f, 0.2f, 1.0f};
 
     Timer t;
 
     if(active)
     {
-        drawParams.clear();
-        t.start();
-        // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // viewport is incorrect on creation, this will ensure current is used to match View
-        updateViewParams();
-
-        // build selection plane 'manipulator'
-        if(pickOnTerrain)
-            paintSelectionPlane(purpleish, drawParams);
-        else
-            paintSelectionPlane(blueish, drawParams);
+        GLint viewport[4];
+        QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+        QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
 
-        // pass in draw params for objects
-        mrenderer->setConstraintDrawParams(drawParams);
+        t.start();
+        f->glGetIntegerv(GL_VIEWPORT, viewport);
 
-        // draw terrain
+        if(!renderCache(viewport[2], viewport[3]))
+            return;
 
-        mrenderer->forceTextureRebind(); // because we have two renderers looking at this openGl context
-        //scene->getLowResTerrain()->setBufferToDirty();
-        // draw terrain  with selection plane
-        if (drawParams.size() > 0) // DEBUG: PCM
-            scene->getLowResTerrain()->updateBuffers(mrenderer);
+        // copy the cached terrain into the overview viewport
+        f->glBindFramebuffer(GL_READ_FRAMEBUFFER, cacheFBO);
+        f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
+        ef->glBlitFramebuffer(0, 0, cacheWd, cacheHt, viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        f->glBindFramebuffer(GL_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
 
-        mrenderer->draw(mview);
+        // selection region drawn over the terrain with the same blend as the previous in-scene selection plane
+        GLint rect[4];
+        GLfloat * col = (pickOnTerrain ? purpleish : blueish);
+        selectionRect(viewport, rect);
+        mrenderer->drawScreenRect(rect, glm::vec4(col[0], col[1], col[2], col[3]));
 
         t.stop();
 
@@ -1659,6 +1818,147 @@ void overviewWindow::draw(void)
     }
 }
 
+bool overviewWindow::renderCache(int wd, int ht)
+{
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    Terrain * ter = scene->getLowResTerrain();
+
+    if(wd <= 0 || ht <= 0)
+        return false;
+
+    // the terrain is the only scene content, so the cache stays valid until it changes
+    if(ter != cacheTerrain || ter->isBufferDirty() || ter->getHeightRevision() != cacheRevision)
+        cacheValid = false;
+    if(cacheValid && wd == cacheWd && ht == cacheHt)
+        return true;
+
+    if(cacheFBO == 0 || wd != cacheWd || ht != cacheHt)
+    {
+        releaseCache();
+        cacheWd = wd; cacheHt = ht;
+
+        // allocate on a texture unit the renderers do not reserve, so their bindings are left intact
+        f->glActiveTexture(GL_TEXTURE11);
+        f->glGenTextures(1, &cacheTexture);
+        f->glBindTexture(GL_TEXTURE_2D, cacheTexture);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheWd, cacheHt, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        f->glGenFramebuffers(1, &cacheFBO);
+        f->glBindFramebuffer(GL_FRAMEBUFFER, cacheFBO);
+        f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cacheTexture, 0);
+        if(f->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            cerr << "overviewWindow: cache FBO initialisation failed" << endl;
+            f->glBindFramebuffer(GL_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
+            releaseCache();
+            return false;
+        }
+    }
+
+    // viewport is incorrect on creation, this will ensure current is used to match View
+    updateViewParams();
+
+    // the selection is composited separately, so the cached image is the terrain alone
+    mrenderer->setConstraintDrawParams(std::vector<ShapeDrawData>());
+    mrenderer->bindTextures(); // because we have two renderers looking at this openGl context
+    ter->updateBuffers(mrenderer);
+
+    GLint viewport[4];
+    f->glGetIntegerv(GL_VIEWPORT, viewport);
+    f->glViewport(0, 0, cacheWd, cacheHt);
+    mrenderer->setOutputFramebuffer(cacheFBO);
+    mrenderer->draw(mview);
+    mrenderer->setOutputFramebuffer(0);
+    if(contourInterval > 0.0f)
+    {
+        // contours are baked into the cache, so they cost nothing on frames that reuse it
+        f->glBindFramebuffer(GL_FRAMEBUFFER, cacheFBO);
+        drawContours(ter);
+    }
+    f->glBindFramebuffer(GL_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
+    f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    cacheTerrain = ter;
+    cacheRevision = ter->getHeightRevision();
+    cacheValid = true;
+    return true;
+}
+
+void overviewWindow::drawContours(Terrain * ter)
+{
+    float minh, maxh;
+    std::vector<ContourLine> lines;
+    std::vector<float> ndc;
+
+    ter->getHeightBounds(minh, maxh);
+    ter->extractContours(contourLevels(minh, maxh, contourInterval), lines);
+
+    // each contour sits at its own height, so its points project directly
+    glm::mat4 mvp = mview->getMatrix();
+    for(auto & line: lines)
+    {
+        int np = (int) line.xy.size() / 2;
+        int nseg = (line.closed ? np : np - 1);
+        for(int s = 0; s < nseg; s++)
+            for(int k = 0; k < 2; k++)
+            {
+                int p = (s + k) % np;
+                glm::vec4 q = mvp * glm::vec4(line.xy[2*p], line.level, line.xy[2*p+1], 1.0f);
+                ndc.push_back(q.x / q.w);
+                ndc.push_back(q.y / q.w);
+            }
+    }
+    mrenderer->drawScreenLines(ndc, glm::vec4(0.25f, 0.15f, 0.05f, 0.6f));
+}
+
+void overviewWindow::releaseCache(void)
+{
+    if(QOpenGLContext::currentContext() != nullptr)
+    {
+        QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+        if(cacheFBO != 0) f->glDeleteFramebuffers(1, &cacheFBO);
+        if(cacheTexture != 0) f->glDeleteTextures(1, &cacheTexture);
+    }
+    cacheFBO = cacheTexture = 0;
+    cacheWd = cacheHt = 0;
+    cacheValid = false;
+}
+
+void overviewWindow::selectionRect(const GLint viewport[4], GLint rect[4])
+{
+    Region region = currRegion;
+    float minHt, maxHt;
+    scene->getHighResTerrain()->getHeightBounds(minHt, maxHt);
+    float pointStep = scene->getHighResTerrain()->getPointStep();
+
+    // corners of the selection plane as placed by paintSelectionPlane (grid x and y are flipped in world space)
+    float cx = (pointStep*region.y0 + pointStep*region.y1)/2.0f;
+    float cz = (pointStep*region.x0 + pointStep*region.x1)/2.0f;
+    float hx = pointStep*(region.y1 - region.y0 + 1)/2.0f;
+    float hz = pointStep*(region.x1 - region.x0 + 1)/2.0f;
+    float cy = 1.1f*maxHt + 11.0f;
+
+    glm::mat4 mvp = mview->getMatrix();
+    float minx = viewport[2], miny = viewport[3], maxx = 0.0f, maxy = 0.0f;
+    for(int c = 0; c < 4; c++)
+    {
+        glm::vec4 p = mvp * glm::vec4(cx + (c & 1 ? hx : -hx), cy, cz + (c & 2 ? hz : -hz), 1.0f);
+        float sx = (p.x / p.w * 0.5f + 0.5f) * viewport[2];
+        float sy = (p.y / p.w * 0.5f + 0.5f) * viewport[3];
+        minx = std::min(minx, sx); maxx = std::max(maxx, sx);
+        miny = std::min(miny, sy); maxy = std::max(maxy, sy);
+    }
+
+    minx = std::max(minx, 0.0f); miny = std::max(miny, 0.0f);
+    maxx = std::min(maxx, (float) viewport[2]); maxy = std::min(maxy, (float) viewport[3]);
+    rect[0] = viewport[0] + (GLint) std::floor(minx);
+    rect[1] = viewport[1] + (GLint) std::floor(miny);
+    rect[2] = std::max(0, (GLint) std::ceil(maxx) - (GLint) std::floor(minx));
+    rect[3] = std::max(0, (GLint) std::ceil(maxy) - (GLint) std::floor(miny));
+}
+
 void overviewWindow::mouseCoordTransform(int w, int h, int sx, int sy, int &ox, int &oy)
 {
     int ix, iy, ow, oh;
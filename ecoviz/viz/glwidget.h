@@ -79,6 +79,7 @@
 #include "timewindow.h"
 #include "progressbar_window.h"
 #include "gltransect.h"
+#include "framescheduler.h"
 
 //! [0]
 
@@ -97,7 +98,7 @@ const float mtoft = 3.28084f;
 class Window;
 class overviewWindow;
 
-class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions, public ScheduledView
 {
     Q_OBJECT
 
@@ -112,6 +113,13 @@ public:
 
     void setParent(Window * wp){ winparent = wp; }
 
+    /**
+     * @brief prepareFrame  Rebind plant instances for the current viewpoint ahead of a scheduled repaint,
+     *                      so that paintGL only has to draw them
+     * @param reasons       bitwise or of FrameScheduler::Reason values
+     */
+    void prepareFrame(unsigned reasons) override;
+
     /**
      * capture the framebuffer as an image
      * @param capImg    framebuffer is written to this image
@@ -122,6 +130,12 @@ public:
     /// getters for currently active view, terrain, typemaps, renderer, ecosystem
     PMrender::TRenderer * getRenderer();
 
+    /**
+     * @brief setRenderQuality  Choose the anti-aliasing used for this view once the camera is still
+     * @param q                 NATIVE, SUPERSAMPLE_2X, MSAA or POST_AA
+     */
+    void setRenderQuality(PMrender::TRenderer::renderQuality q);
+
     /// getter and setter for brush radii
     float getRadius();
     void setRadius(float rad);
@@ -149,6 +163,13 @@ public:
      */
     void setScene(Scene * s);
 
+    /**
+     * @brief switchPerspectiveScene Display a scene whose terrain has been replaced by a new sub-terrain, keeping the
+     *                               camera but re-centring it on the new terrain's focus
+     * @param s Scene to display
+     */
+    void switchPerspectiveScene(Scene * s);
+
     /// getter for scene attached to glwidget
     Scene * getScene(){ return scene; }
     View * getView(){ return view; }
@@ -274,6 +295,7 @@ public:
 
 signals:
     void signalRepaintAllGL();
+    void signalRepaintAllMoved();
     void signalShowTransectView();
     void signalSyncPlace(bool firstPoint);
     void signalRebindTransectPlants();
@@ -286,6 +308,10 @@ public slots:
     void animUpdate(); // animation step for change of focus
     void rotateUpdate(); // animation step for rotating around terrain center
     void rebindPlants(); // set flag indicating that plants need to be re-bound
+    void endInteraction(); // camera has settled, so repaint at full quality
+
+private slots:
+    void cleanupGL(); // free GL objects held for this view before its context goes
 
 protected:
     void initializeGL();
@@ -320,6 +346,8 @@ private:
     bool focuschange;
     bool focusviz;
     bool timeron;
+    float frameTimeSum; //< accumulated frame time since the last report, when timing is on
+    int frameTimeCount; //< number of frames accumulated since the last report
     bool active; //< scene only rendered if this is true
     bool painted; //< set after first successful paint
     bool persRotating; // if arcball rotation of main perspective view is active
@@ -337,6 +365,7 @@ private:
     QPoint lastPos;
     QColor qtWhite;
     QTimer * atimer, * rtimer; // timers to control different types of animation
+    QTimer * itimer; //< restarted by each camera move, fires once the camera has been still for a while
     QLabel * vizpopup;  //< for debug visualisation
 
     /**
@@ -384,16 +413,32 @@ private:
      */
     void pickInfo(int x, int y);
 
+    /**
+     * @brief pickPlant Write information about the closest visible plant under the cursor to the console
+     * @param sx        x-coord in screen space
+     * @param sy        y-coord in screen space
+     * @retval @c true if a plant was hit
+     */
+    bool pickPlant(int sx, int sy);
+
     /**
      * @brief refreshViews Signal update to either this view or all views depending on lock state
      */
     void refreshViews();
+
+    /**
+     * @brief beginInteraction Note a camera move, so that views sharing the camera render at reduced resolution
+     *                         until it has been still for a while
+     */
+    void beginInteraction();
 };
 
 class overviewWindow {
     public:
 
     overviewWindow(mapScene * scn);
+
+    /// also releases the cached overview, so the context in which it was drawn should be current
     ~overviewWindow();
 
     /// getters for currently active view, terrain, typemaps, renderer, ecosystem
@@ -520,11 +565,29 @@ class overviewWindow {
     void forceUpdate(void)
     {
         scene->getLowResTerrain()->setBufferToDirty();
+        invalidateCache();
     }
 
-    /// draw
+    /// re-render the overview terrain on the next draw, e.g., after a change of overlay or render settings
+    void invalidateCache(void){ cacheValid = false; }
+
+    /// draw height contours every @a interval metres over the overview terrain, or none if @a interval <= 0
+    void setContourInterval(float interval)
+    {
+        if(interval != contourInterval)
+        {
+            contourInterval = interval;
+            invalidateCache();
+        }
+    }
+
+    /// draw the cached overview terrain into the current viewport, re-rendering it first if it is out of date,
+    /// then composite the selection region on top
     void draw(void);
 
+    /// release GL resources held for the cached overview; needs the context in which it was drawn to be current
+    void releaseCache(void);
+
     /// set size based on aspect ratio of terrain
     void setWindowSize(void);
 
@@ -556,6 +619,15 @@ private:
     // render variables
     PMrender::TRenderer * mrenderer;
 
+    // cached rendering of the overview terrain, which only changes with the terrain, not with the selection
+    GLuint cacheFBO;        //< framebuffer holding the cached image
+    GLuint cacheTexture;    //< colour attachment of cacheFBO
+    int cacheWd, cacheHt;   //< dimensions of the cached image
+    bool cacheValid;        //< false if the cached image must be re-rendered before use
+    Terrain * cacheTerrain; //< low resolution terrain the cache was rendered from
+    long cacheRevision;     //< height revision of cacheTerrain when the cache was rendered
+    float contourInterval;  //< height separation of contours drawn into the cache, none if <= 0
+
     // gui variables
     bool maplock;
     bool active;
@@ -577,6 +649,28 @@ private:
     // paint on the overview selection window (size and position obtained from Terrain)
     void paintSelectionPlane(GLfloat *col, std::vector<ShapeDrawData> & drawparams);
 
+    /**
+     * @brief drawContours  Extract contours of the terrain at contourInterval and draw them as lines over the
+     *                      current framebuffer, projected with the overview view
+     * @param ter           terrain to contour
+     */
+    void drawContours(Terrain * ter);
+
+    /**
+     * @brief renderCache   Render the overview terrain into the cache, (re)allocating it if the size has changed
+     * @param wd            width of the overview viewport in pixels
+     * @param ht            height of the overview viewport in pixels
+     * @retval @c true if the cache holds a valid image
+     */
+    bool renderCache(int wd, int ht);
+
+    /**
+     * @brief selectionRect Window rectangle covered by the selection region
+     * @param viewport      overview viewport [x, y, width, height]
+     * @param rect          output rectangle [x, y, width, height], clipped to the viewport
+     */
+    void selectionRect(const GLint viewport[4], GLint rect[4]);
+
     void paintSphere(vpPoint p, GLfloat * col, std::vector<ShapeDrawData> &drawParams);
 
 
@@ -98,6 +98,8 @@ int main(int argc, char *argv[])
 
     try
     {
+        // all views share textures and buffers, so terrain and plant geometry are uploaded once per scene
+        QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
         QApplication app(argc, argv);
 
         // Register external resource file if needed
@@ -0,0 +1,97 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "plantcull.h"
+
+PlantLOD PlantLODPolicy::select(float dist, float height) const
+{
+    if(!enabled || dist < fullDistance)
+        return PlantLOD::FULL;
+    if(dist > crudeDistance && height < minCrudeRatio * dist)
+        return PlantLOD::CRUDE;
+    return PlantLOD::LOW;
+}
+
+PlantFrustum::PlantFrustum()
+{
+    // degenerate frustum that contains everything
+    for(int i = 0; i < 6; i++)
+        planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    eye = glm::vec3(0.0f);
+}
+
+PlantFrustum::PlantFrustum(const glm::mat4 &proj, const glm::mat4 &view)
+{
+    glm::mat4 m = proj * view;
+    glm::vec4 row[4];
+
+    // glm matrices are column major
+    for(int r = 0; r < 4; r++)
+        row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+    planes[0] = row[3] + row[0]; // left
+    planes[1] = row[3] - row[0]; // right
+    planes[2] = row[3] + row[1]; // bottom
+    planes[3] = row[3] - row[1]; // top
+    planes[4] = row[3] + row[2]; // near
+    planes[5] = row[3] - row[2]; // far
+
+    for(int i = 0; i < 6; i++)
+    {
+        float len = glm::length(glm::vec3(planes[i]));
+        if(len > 0.0f)
+            planes[i] /= len;
+    }
+
+    // viewpoint is the translation of the inverse view transformation
+    eye = glm::vec3(glm::inverse(view)[3]);
+}
+
+void PlantFrustum::translate(float dx, float dz)
+{
+    for(int i = 0; i < 6; i++)
+        planes[i].w -= planes[i].x * dx + planes[i].z * dz;
+    eye.x += dx; eye.z += dz;
+}
+
+bool PlantFrustum::boxOutside(const glm::vec3 &bmin, const glm::vec3 &bmax) const
+{
+    for(int i = 0; i < 6; i++)
+    {
+        // corner of the box furthest along the plane normal
+        glm::vec3 p((planes[i].x >= 0.0f ? bmax.x : bmin.x),
+                    (planes[i].y >= 0.0f ? bmax.y : bmin.y),
+                    (planes[i].z >= 0.0f ? bmax.z : bmin.z));
+        if(glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0.0f)
+            return true;
+    }
+    return false;
+}
+
+float PlantFrustum::distance(const glm::vec3 &p) const
+{
+    return glm::length(p - eye);
+}
+
+float PlantFrustum::boxDistance(const glm::vec3 &bmin, const glm::vec3 &bmax) const
+{
+    return glm::length(glm::clamp(eye, bmin, bmax) - eye);
+}
@@ -0,0 +1,98 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+// plantcull.h: view frustum culling and level of detail selection for plant instances.
+// Deliberately free of OpenGL and Qt so that it can be exercised without a rendering context.
+
+#ifndef _plantcull_h
+#define _plantcull_h
+
+#include <glm/glm.hpp>
+
+/// Levels of detail for plant geometry, from most to least detailed
+enum class PlantLOD
+{
+    FULL,       //< species mesh at full resolution
+    LOW,        //< species mesh with reduced tessellation
+    CRUDE,      //< single tapered box standing in for distant small plants
+    LODEND
+};
+
+/// Thresholds that determine the level of detail for a plant at a given distance from the viewer
+struct PlantLODPolicy
+{
+    bool enabled = true;            //< if false every plant is drawn at full detail
+    float fullDistance = 400.0f;    //< plants closer than this (in metres) use the full mesh
+    float crudeDistance = 2000.0f;  //< plants further than this may use the crude mesh ...
+    float minCrudeRatio = 0.015f;   //< ... if their height divided by distance is below this ratio
+
+    /**
+     * @brief select    Choose a level of detail
+     * @param dist      distance from the viewpoint to the plant
+     * @param height    height of the plant
+     */
+    PlantLOD select(float dist, float height) const;
+
+    bool operator==(const PlantLODPolicy &other) const
+    {
+        return enabled == other.enabled && fullDistance == other.fullDistance &&
+               crudeDistance == other.crudeDistance && minCrudeRatio == other.minCrudeRatio;
+    }
+};
+
+/// View frustum as six planes, with points inside the frustum at non-negative distance from every plane
+class PlantFrustum
+{
+private:
+    glm::vec4 planes[6];    //< left, right, bottom, top, near and far planes as (normal, offset)
+    glm::vec3 eye;          //< viewpoint
+
+public:
+
+    PlantFrustum();
+
+    /**
+     * @brief PlantFrustum  Extract the frustum from camera matrices
+     * @param proj          projection matrix
+     * @param view          viewing matrix
+     */
+    PlantFrustum(const glm::mat4 &proj, const glm::mat4 &view);
+
+    /**
+     * @brief translate Express the frustum in a coordinate frame whose origin lies at (-dx, 0, -dz) in the current frame,
+     *                  that is, a point p in the current frame is p + (dx, 0, dz) in the new frame
+     */
+    void translate(float dx, float dz);
+
+    /// true if an axis-aligned box lies completely outside the frustum
+    bool boxOutside(const glm::vec3 &bmin, const glm::vec3 &bmax) const;
+
+    /// distance from the viewpoint to a point
+    float distance(const glm::vec3 &p) const;
+
+    /// distance from the viewpoint to the nearest point of an axis-aligned box, 0 if the viewpoint is inside
+    float boxDistance(const glm::vec3 &bmin, const glm::vec3 &bmax) const;
+
+    /// plane coefficients, for detecting frustum changes
+    const glm::vec4 & getPlane(int i) const { return planes[i]; }
+};
+
+#endif
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+// plantcull_test.cpp: checks of frustum culling and level of detail selection, run by ctest.
+// Needs no rendering context. Exits with the number of failed checks.
+
+#include "plantcull.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool cond, const char * what)
+{
+    if(!cond)
+    {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+static bool approx(float a, float b, float tol = 1.0e-3f)
+{
+    return fabs(a - b) <= tol * std::max(1.0f, fabs(b));
+}
+
+static void testLODSelection()
+{
+    PlantLODPolicy policy;
+    policy.fullDistance = 100.0f;
+    policy.crudeDistance = 1000.0f;
+    policy.minCrudeRatio = 0.01f;
+
+    check(policy.select(50.0f, 5.0f) == PlantLOD::FULL, "close plants are drawn in full");
+    check(policy.select(500.0f, 5.0f) == PlantLOD::LOW, "plants between the thresholds are drawn at low detail");
+    check(policy.select(2000.0f, 5.0f) == PlantLOD::CRUDE, "distant small plants are drawn crudely");
+    check(policy.select(2000.0f, 50.0f) == PlantLOD::LOW, "distant tall plants keep their shape");
+
+    policy.enabled = false;
+    check(policy.select(2000.0f, 5.0f) == PlantLOD::FULL, "a disabled policy draws everything in full");
+}
+
+static void testFrustum()
+{
+    // camera at height 10 looking down the negative z axis
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.0f, 1.0f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 10.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    PlantFrustum frustum(proj, view);
+
+    check(!frustum.boxOutside(glm::vec3(-1.0f, 0.0f, -101.0f), glm::vec3(1.0f, 20.0f, -99.0f)), "box ahead is inside");
+    check(frustum.boxOutside(glm::vec3(-1.0f, 0.0f, 99.0f), glm::vec3(1.0f, 20.0f, 101.0f)), "box behind is outside");
+    check(frustum.boxOutside(glm::vec3(-1.0f, 0.0f, -2001.0f), glm::vec3(1.0f, 20.0f, -1999.0f)), "box beyond the far plane is outside");
+    check(frustum.boxOutside(glm::vec3(499.0f, 0.0f, -101.0f), glm::vec3(501.0f, 20.0f, -99.0f)), "box to the side is outside");
+    check(!frustum.boxOutside(glm::vec3(-500.0f, 0.0f, -101.0f), glm::vec3(500.0f, 20.0f, -99.0f)), "box straddling the view is inside");
+
+    check(approx(frustum.distance(glm::vec3(0.0f, 10.0f, -100.0f)), 100.0f), "distance to a point");
+    check(approx(frustum.boxDistance(glm::vec3(-1.0f, 0.0f, -101.0f), glm::vec3(1.0f, 20.0f, -99.0f)), 99.0f), "distance to the near face of a box");
+    check(frustum.boxDistance(glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 20.0f, 1.0f)) == 0.0f, "distance to a box around the viewpoint");
+
+    // the same box expressed in a frame whose origin lies 50 units further along x
+    frustum.translate(50.0f, 0.0f);
+    check(!frustum.boxOutside(glm::vec3(49.0f, 0.0f, -101.0f), glm::vec3(51.0f, 20.0f, -99.0f)), "translated box ahead is inside");
+    check(frustum.boxOutside(glm::vec3(-1.0f, 0.0f, -2001.0f), glm::vec3(1.0f, 20.0f, -1999.0f)), "translated box beyond the far plane is outside");
+    check(approx(frustum.distance(glm::vec3(50.0f, 10.0f, -100.0f)), 100.0f), "translated distance to a point");
+}
+
+int main(int argc, char * argv [])
+{
+    testLODSelection();
+    testFrustum();
+
+    if(failures == 0)
+        cerr << "plantcull: all checks passed" << endl;
+    return failures;
+}
@@ -0,0 +1,369 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "plantindex.h"
+#include <algorithm>
+#include <math.h>
+
+const int plantsPerCell = 16;   //< target average bucket occupancy
+const int maxCellDim = 512;     //< limit on the number of buckets along an axis
+
+void PlantIndex::cellLocate(float x, float z, int &cx, int &cz) const
+{
+    cx = (int) ((x - minx) / cellx);
+    cz = (int) ((z - minz) / cellz);
+    cx = std::max(0, std::min(dimx-1, cx));
+    cz = std::max(0, std::min(dimz-1, cz));
+}
+
+bool PlantIndex::speciesMatch(const Cell &c, const std::vector<bool> * speciesMask) const
+{
+    if(speciesMask == nullptr)
+        return true;
+    for(int s = 0; s < (int) speciesMask->size() && s < maxSpecies; s++)
+        if((* speciesMask)[s] && c.species.test(s))
+            return true;
+    return false;
+}
+
+bool PlantIndex::cellInSlab(const Cell &c, const std::vector<Plane> &planes) const
+{
+    for(auto &pln: planes)
+    {
+        // smallest signed distance over the cell bounds, found at the corner furthest against the normal
+        float px = (pln.n.i >= 0.0f ? c.x0 : c.x1);
+        float py = (pln.n.j >= 0.0f ? c.y0 : c.y1);
+        float pz = (pln.n.k >= 0.0f ? c.z0 : c.z1);
+        if(px * pln.n.i + py * pln.n.j + pz * pln.n.k + pln.d >= 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void PlantIndex::build(PlantGrid * esys)
+{
+    int x, y, s, p, n = 0;
+    float maxx, maxz;
+
+    grid = esys;
+    plants.clear();
+    cells.clear();
+
+    // extent of all plants
+    minx = minz = 1.0e10f; maxx = maxz = -1.0e10f; maxrad = 0.0f;
+    for(x = 0; x < esys->gx; x++)
+        for(y = 0; y < esys->gy; y++)
+        {
+            PlantPopulation * plnts = esys->getPopulation(x, y);
+            for(s = 0; s < (int) plnts->pop.size(); s++)
+                for(p = 0; p < (int) plnts->pop[s].size(); p++)
+                {
+                    const vpPoint &pos = plnts->pop[s][p].pos;
+                    minx = std::min(minx, pos.x); maxx = std::max(maxx, pos.x);
+                    minz = std::min(minz, pos.z); maxz = std::max(maxz, pos.z);
+                    maxrad = std::max(maxrad, plnts->pop[s][p].canopy / 2.0f);
+                    n++;
+                }
+        }
+
+    if(n == 0)
+    {
+        dimx = dimz = 0;
+        revision = esys->getRevision();
+        return;
+    }
+
+    // choose bucket counts in proportion to the extent so that buckets are roughly square
+    float wx = std::max(maxx - minx, 1.0f), wz = std::max(maxz - minz, 1.0f);
+    float numcells = std::max(1.0f, (float) n / (float) plantsPerCell);
+    dimx = std::max(1, std::min(maxCellDim, (int) ceil(sqrt(numcells * wx / wz))));
+    dimz = std::max(1, std::min(maxCellDim, (int) ceil(numcells / (float) dimx)));
+    cellx = wx / (float) dimx * 1.0001f; // slight padding so the maximum lands inside the last bucket
+    cellz = wz / (float) dimz * 1.0001f;
+
+    // counting sort of plants into buckets
+    std::vector<int> counts(dimx * dimz + 1, 0);
+    for(x = 0; x < esys->gx; x++)
+        for(y = 0; y < esys->gy; y++)
+        {
+            PlantPopulation * plnts = esys->getPopulation(x, y);
+            for(s = 0; s < (int) plnts->pop.size(); s++)
+                for(p = 0; p < (int) plnts->pop[s].size(); p++)
+                {
+                    int cx, cz;
+                    cellLocate(plnts->pop[s][p].pos.x, plnts->pop[s][p].pos.z, cx, cz);
+                    counts[cx * dimz + cz + 1]++;
+                }
+        }
+    for(int c = 0; c < dimx * dimz; c++)
+        counts[c+1] += counts[c];
+
+    cells.resize(dimx * dimz);
+    for(int c = 0; c < dimx * dimz; c++)
+    {
+        cells[c].start = cells[c].end = counts[c];
+        cells[c].x0 = cells[c].z0 = cells[c].y0 = 1.0e10f;
+        cells[c].x1 = cells[c].z1 = cells[c].y1 = -1.0e10f;
+    }
+
+    plants.resize(n);
+    for(x = 0; x < esys->gx; x++)
+        for(y = 0; y < esys->gy; y++)
+        {
+            PlantPopulation * plnts = esys->getPopulation(x, y);
+            for(s = 0; s < (int) plnts->pop.size(); s++)
+                for(p = 0; p < (int) plnts->pop[s].size(); p++)
+                {
+                    const Plant &plnt = plnts->pop[s][p];
+                    int cx, cz;
+                    cellLocate(plnt.pos.x, plnt.pos.z, cx, cz);
+                    Cell &c = cells[cx * dimz + cz];
+                    plants[c.end] = {x * esys->gy + y, s, p};
+                    c.end++;
+
+                    float rad = plnt.canopy / 2.0f;
+                    c.x0 = std::min(c.x0, plnt.pos.x - rad); c.x1 = std::max(c.x1, plnt.pos.x + rad);
+                    c.z0 = std::min(c.z0, plnt.pos.z - rad); c.z1 = std::max(c.z1, plnt.pos.z + rad);
+                    c.y0 = std::min(c.y0, plnt.pos.y); c.y1 = std::max(c.y1, plnt.pos.y + plnt.height);
+                    if(s < maxSpecies)
+                        c.species.set(s);
+                }
+        }
+
+    revision = esys->getRevision();
+}
+
+void PlantIndex::queryBox(float x0, float z0, float x1, float z1, const std::vector<bool> * speciesMask,
+                          std::vector<const IndexedPlant *> &found) const
+{
+    querySlab({}, speciesMask, found, x0, z0, x1, z1);
+}
+
+void PlantIndex::querySlab(const std::vector<Plane> &planes, const std::vector<bool> * speciesMask, std::vector<const IndexedPlant *> &found,
+                           float x0, float z0, float x1, float z1) const
+{
+    gather(planes, speciesMask, found, x0, z0, x1, z1);
+}
+
+void PlantIndex::gather(const std::vector<Plane> &planes, const std::vector<bool> * speciesMask,
+                        std::vector<const IndexedPlant *> &found, float x0, float z0, float x1, float z1) const
+{
+    int sx, sz, ex, ez;
+
+    if(dimx == 0 || x1 < x0 || z1 < z0)
+        return;
+
+    // bucket range covering the box, widened since canopies extend past the bucket holding their centre
+    cellLocate(x0 - maxrad, z0 - maxrad, sx, sz);
+    cellLocate(x1 + maxrad, z1 + maxrad, ex, ez);
+
+    for(int cx = sx; cx <= ex; cx++)
+        for(int cz = sz; cz <= ez; cz++)
+        {
+            const Cell &c = cells[cx * dimz + cz];
+            if(c.start == c.end || c.x1 < x0 || c.x0 > x1 || c.z1 < z0 || c.z0 > z1)
+                continue;
+            if(!speciesMatch(c, speciesMask) || (!planes.empty() && !cellInSlab(c, planes)))
+                continue;
+
+            for(int i = c.start; i < c.end; i++)
+            {
+                const IndexedPlant &ip = plants[i];
+                if(speciesMask != nullptr && (ip.species >= (int) speciesMask->size() || !(* speciesMask)[ip.species]))
+                    continue;
+                const Plant &plnt = getPlant(ip);
+                float rad = plnt.canopy / 2.0f;
+                if(plnt.pos.x + rad < x0 || plnt.pos.x - rad > x1 || plnt.pos.z + rad < z0 || plnt.pos.z - rad > z1)
+                    continue;
+                found.push_back(&ip);
+            }
+        }
+}
+
+/// ray parameter range [tmin, tmax] within an axis-aligned box, false if the box is missed
+static bool rayBox(const vpPoint &start, const Vector &dirn, const float bmin[3], const float bmax[3], float &tmin, float &tmax)
+{
+    float o[3] = {start.x, start.y, start.z};
+    float d[3] = {dirn.i, dirn.j, dirn.k};
+
+    tmin = 0.0f; tmax = 1.0e30f;
+    for(int a = 0; a < 3; a++)
+    {
+        if(fabs(d[a]) < 1.0e-8f)
+        {
+            if(o[a] < bmin[a] || o[a] > bmax[a])
+                return false;
+        }
+        else
+        {
+            float t0 = (bmin[a] - o[a]) / d[a], t1 = (bmax[a] - o[a]) / d[a];
+            if(t0 > t1)
+                std::swap(t0, t1);
+            tmin = std::max(tmin, t0); tmax = std::min(tmax, t1);
+            if(tmin > tmax)
+                return false;
+        }
+    }
+    return true;
+}
+
+/// ray parameter of entry into a vertical cylinder, false if the cylinder is missed
+static bool rayCylinder(const vpPoint &start, const Vector &dirn, const vpPoint &base, float rad, float hght, float &tval)
+{
+    float tmin = 0.0f, tmax = 1.0e30f;
+
+    // vertical extent
+    if(fabs(dirn.j) < 1.0e-8f)
+    {
+        if(start.y < base.y || start.y > base.y + hght)
+            return false;
+    }
+    else
+    {
+        float t0 = (base.y - start.y) / dirn.j, t1 = (base.y + hght - start.y) / dirn.j;
+        if(t0 > t1)
+            std::swap(t0, t1);
+        tmin = std::max(tmin, t0); tmax = std::min(tmax, t1);
+    }
+
+    // circular cross-section
+    float ox = start.x - base.x, oz = start.z - base.z;
+    float a = dirn.i * dirn.i + dirn.k * dirn.k;
+    float b = 2.0f * (ox * dirn.i + oz * dirn.k);
+    float c = ox * ox + oz * oz - rad * rad;
+    if(a < 1.0e-12f)
+    {
+        if(c > 0.0f)
+            return false;
+    }
+    else
+    {
+        float disc = b * b - 4.0f * a * c;
+        if(disc < 0.0f)
+            return false;
+        float sq = sqrt(disc);
+        tmin = std::max(tmin, (-b - sq) / (2.0f * a));
+        tmax = std::min(tmax, (-b + sq) / (2.0f * a));
+    }
+
+    if(tmin > tmax)
+        return false;
+    tval = tmin;
+    return true;
+}
+
+bool PlantIndex::queryRay(vpPoint start, Vector dirn, const std::vector<bool> * speciesMask, const IndexedPlant * &hit, float &tval) const
+{
+    bool found = false;
+
+    hit = nullptr;
+    tval = 1.0e30f;
+    if(dimx == 0)
+        return false;
+
+    // closest hit among the plants of one bucket, buckets off the grid are ignored
+    auto testCell = [&](int cx, int cz)
+    {
+        if(cx < 0 || cx >= dimx || cz < 0 || cz >= dimz)
+            return;
+        const Cell &c = cells[cx * dimz + cz];
+        float bmin[3] = {c.x0, c.y0, c.z0}, bmax[3] = {c.x1, c.y1, c.z1};
+        float tnear, tfar;
+
+        if(c.start == c.end || !speciesMatch(c, speciesMask))
+            return;
+        if(!rayBox(start, dirn, bmin, bmax, tnear, tfar) || tnear > tval)
+            return;
+
+        for(int i = c.start; i < c.end; i++)
+        {
+            const IndexedPlant &ip = plants[i];
+            float t;
+            if(speciesMask != nullptr && (ip.species >= (int) speciesMask->size() || !(* speciesMask)[ip.species]))
+                continue;
+            const Plant &plnt = getPlant(ip);
+            if(rayCylinder(start, dirn, plnt.pos, plnt.canopy / 2.0f, plnt.height, t) && t < tval)
+            {
+                hit = &ip; tval = t; found = true;
+            }
+        }
+    };
+
+    // A canopy reaches at most hx buckets along x (hz along z) beyond the bucket holding its centre, so a plant can
+    // only be struck where the ray passes within that halo of its bucket. The ray is walked bucket by bucket over the
+    // grid widened by the halo, testing the buckets that enter the halo window at each step.
+    int hx = (int) ceil(maxrad / cellx), hz = (int) ceil(maxrad / cellz);
+    float bmin[3] = {minx - (float) hx * cellx, -1.0e30f, minz - (float) hz * cellz};
+    float bmax[3] = {minx + (float) (dimx + hx) * cellx, 1.0e30f, minz + (float) (dimz + hz) * cellz};
+    float tenter, texit;
+    if(!rayBox(start, dirn, bmin, bmax, tenter, texit))
+        return false;
+
+    int ix = (int) floor((start.x + tenter * dirn.i - minx) / cellx);
+    int iz = (int) floor((start.z + tenter * dirn.k - minz) / cellz);
+    ix = std::max(-hx, std::min(dimx + hx - 1, ix));
+    iz = std::max(-hz, std::min(dimz + hz - 1, iz));
+    for(int cx = ix - hx; cx <= ix + hx; cx++)
+        for(int cz = iz - hz; cz <= iz + hz; cz++)
+            testCell(cx, cz);
+
+    // grid DDA in the x-z plane, with ray parameters at which the next bucket boundary along each axis is crossed
+    int stepx = (fabs(dirn.i) < 1.0e-8f ? 0 : (dirn.i > 0.0f ? 1 : -1));
+    int stepz = (fabs(dirn.k) < 1.0e-8f ? 0 : (dirn.k > 0.0f ? 1 : -1));
+    float tmaxx = 1.0e30f, tmaxz = 1.0e30f, tdeltax = 1.0e30f, tdeltaz = 1.0e30f;
+    if(stepx != 0)
+    {
+        tmaxx = (minx + (float) (ix + (stepx > 0 ? 1 : 0)) * cellx - start.x) / dirn.i;
+        tdeltax = cellx / fabs(dirn.i);
+    }
+    if(stepz != 0)
+    {
+        tmaxz = (minz + (float) (iz + (stepz > 0 ? 1 : 0)) * cellz - start.z) / dirn.k;
+        tdeltaz = cellz / fabs(dirn.k);
+    }
+
+    while(stepx != 0 || stepz != 0)
+    {
+        // every bucket whose plants could be struck before the ray leaves the current bucket has been tested
+        float tleave = std::min(tmaxx, tmaxz);
+        if((found && tval <= tleave) || tleave > texit)
+            break;
+
+        // the halo window slides one bucket, so only its leading row or column is new
+        if(tmaxx < tmaxz)
+        {
+            ix += stepx; tmaxx += tdeltax;
+            if(ix < -hx || ix >= dimx + hx)
+                break;
+            for(int cz = iz - hz; cz <= iz + hz; cz++)
+                testCell(ix + stepx * hx, cz);
+        }
+        else
+        {
+            iz += stepz; tmaxz += tdeltaz;
+            if(iz < -hz || iz >= dimz + hz)
+                break;
+            for(int cx = ix - hx; cx <= ix + hx; cx++)
+                testCell(cx, iz + stepz * hz);
+        }
+    }
+    return found;
+}
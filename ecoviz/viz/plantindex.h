@@ -0,0 +1,135 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+// plantindex.h: uniform grid over placed plants for box, slab and ray queries
+
+#ifndef _plantindex_h
+#define _plantindex_h
+
+#include "eco.h"
+#include <bitset>
+
+/// Where a plant is stored in the indexed plant grid
+struct IndexedPlant
+{
+    int cell;       //< flattened plant grid cell holding the plant
+    int species;    //< species index into the biome
+    int slot;       //< position in the species population of the cell
+};
+
+/**
+ * Spatial index over all plants in a PlantGrid. Plants are bucketed on a uniform grid in the x-z plane,
+ * with each bucket recording the bounds of its plants and the species present, so that queries only
+ * visit candidate plants. The index refers to plants where they lie in the grid rather than copying them,
+ * so it is a snapshot that is only valid until the plant grid next changes and must then be rebuilt.
+ */
+class PlantIndex
+{
+private:
+
+    /// summary of the plants in one bucket
+    struct Cell
+    {
+        int start, end;                     //< range of plants in the bucket
+        float x0, z0, x1, z1;               //< bounds of plant footprints
+        float y0, y1;                       //< lowest plant base and highest plant top
+        std::bitset<maxSpecies> species;    //< species with at least one plant in the bucket
+    };
+
+    PlantGrid * grid;                       //< plant grid that was indexed
+    std::vector<IndexedPlant> plants;       //< references to all plants, ordered by bucket
+    std::vector<Cell> cells;                //< row-major buckets
+    int dimx, dimz;                         //< number of buckets along x and z
+    float minx, minz;                       //< lower corner of indexed area
+    float cellx, cellz;                     //< bucket extent along x and z
+    float maxrad;                           //< largest canopy radius of any plant
+    long revision;                          //< plant grid revision at the time of the build, -1 if never built
+
+    /// bucket containing a position, clamped to the grid
+    void cellLocate(float x, float z, int &cx, int &cz) const;
+
+    /// true if any plant in the cell is of a requested species
+    bool speciesMatch(const Cell &c, const std::vector<bool> * speciesMask) const;
+
+    /// true if the cell can hold a plant that lies strictly behind every plane
+    bool cellInSlab(const Cell &c, const std::vector<Plane> &planes) const;
+
+    /// Collect plants overlapping a box that may lie within a slab
+    void gather(const std::vector<Plane> &planes, const std::vector<bool> * speciesMask,
+                std::vector<const IndexedPlant *> &found, float x0, float z0, float x1, float z1) const;
+
+public:
+
+    PlantIndex(){ grid = nullptr; dimx = dimz = 0; minx = minz = 0.0f; cellx = cellz = 1.0f; maxrad = 0.0f; revision = -1; }
+
+    /**
+     * @brief build     Bucket all plants in a grid, replacing the current contents of the index
+     * @param esys      plant grid to index
+     */
+    void build(PlantGrid * esys);
+
+    /// true if the index reflects the current contents of the plant grid
+    bool isCurrent(PlantGrid * esys){ return revision >= 0 && revision == esys->getRevision(); }
+
+    /// number of plants indexed
+    int numPlants() const { return (int) plants.size(); }
+
+    /// plant referred to by a query result, valid while the index is current
+    const Plant & getPlant(const IndexedPlant &ip) const
+    {
+        return grid->getPopulation(ip.cell / grid->gy, ip.cell % grid->gy)->pop[ip.species][ip.slot];
+    }
+
+    /**
+     * @brief queryBox  Find plants whose canopy footprint overlaps an axis-aligned box in the x-z plane
+     * @param x0, z0    lower corner of box
+     * @param x1, z1    upper corner of box
+     * @param speciesMask   only return plants of species flagged true, all species if nullptr
+     * @param found     candidate plants are appended to this list
+     */
+    void queryBox(float x0, float z0, float x1, float z1, const std::vector<bool> * speciesMask,
+                  std::vector<const IndexedPlant *> &found) const;
+
+    /**
+     * @brief querySlab Find plants that may lie behind all of a set of planes, such as the planes bounding a transect.
+     *                  Candidates are conservative and should be refined with exact tests by the caller.
+     * @param planes    bounding planes, with normals pointing away from the slab
+     * @param speciesMask   only return plants of species flagged true, all species if nullptr
+     * @param found     candidate plants are appended to this list
+     * @param x0, z0, x1, z1  optional box in the x-z plane further restricting the query
+     */
+    void querySlab(const std::vector<Plane> &planes, const std::vector<bool> * speciesMask, std::vector<const IndexedPlant *> &found,
+                   float x0 = -1.0e10f, float z0 = -1.0e10f, float x1 = 1.0e10f, float z1 = 1.0e10f) const;
+
+    /**
+     * @brief queryRay  Find the closest plant hit by a ray, with each plant treated as a vertical cylinder
+     *                  of its canopy width and height
+     * @param start     ray origin
+     * @param dirn      ray direction
+     * @param speciesMask   only consider plants of species flagged true, all species if nullptr
+     * @param hit       closest plant struck by the ray
+     * @param tval      ray parameter of the hit
+     * @retval @c true if a plant was hit
+     */
+    bool queryRay(vpPoint start, Vector dirn, const std::vector<bool> * speciesMask, const IndexedPlant * &hit, float &tval) const;
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+// plantindex_test.cpp: checks of plant index box, slab and ray queries against brute force, run by ctest.
+// Needs no rendering context. Exits with the number of failed checks.
+
+#include "plantindex.h"
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool cond, const char * what)
+{
+    if(!cond)
+    {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+static bool approx(float a, float b, float tol = 1.0e-3f)
+{
+    return fabs(a - b) <= tol * std::max(1.0f, fabs(b));
+}
+
+static void testIndexQueries()
+{
+    PlantGrid grid(pgdim, pgdim);
+    std::vector<Plant> all;
+    std::vector<int> allSpecies;
+
+    // a regular layout of plants, four per grid cell, with species varying across the layout
+    for(int x = 0; x < 10; x++)
+        for(int y = 0; y < 10; y++)
+        {
+            PlantPopulation pop;
+            pop.pop.resize(maxSpecies);
+            for(int p = 0; p < 4; p++)
+            {
+                Plant plnt;
+                plnt.pos = vpPoint(x * 10.0f + 2.5f + (p % 2) * 5.0f, 0.0f, y * 10.0f + 2.5f + (p / 2) * 5.0f);
+                plnt.height = 5.0f;
+                plnt.canopy = 2.0f;
+                plnt.col = 0.0f;
+                int s = (x + y + p) % 3;
+                pop.pop[s].push_back(plnt);
+                all.push_back(plnt);
+                allSpecies.push_back(s);
+            }
+            grid.setPopulation(x, y, pop);
+        }
+
+    PlantIndex index;
+    index.build(&grid);
+    check(index.isCurrent(&grid), "index is current after a build");
+    check(index.numPlants() == (int) all.size(), "index holds every plant");
+
+    // box query against brute force, with and without a species mask
+    std::vector<bool> mask(maxSpecies, true);
+    mask[1] = false;
+    for(int m = 0; m < 2; m++)
+    {
+        std::vector<const IndexedPlant *> found;
+        index.queryBox(12.0f, 31.0f, 47.0f, 58.0f, (m == 0 ? nullptr : &mask), found);
+
+        int expected = 0;
+        for(int i = 0; i < (int) all.size(); i++)
+        {
+            float rad = all[i].canopy / 2.0f;
+            bool overlaps = all[i].pos.x + rad >= 12.0f && all[i].pos.x - rad <= 47.0f && all[i].pos.z + rad >= 31.0f && all[i].pos.z - rad <= 58.0f;
+            if(overlaps && (m == 0 || mask[allSpecies[i]]))
+                expected++;
+        }
+        bool masked = true;
+        for(auto ip: found)
+            masked = masked && (m == 0 || mask[ip->species]);
+        check((int) found.size() == expected, "box query finds exactly the overlapping plants");
+        check(masked, "box query respects the species mask");
+    }
+
+    // slab query: every plant wholly behind the plane must be a candidate
+    Plane pln;
+    pln.formPlane(vpPoint(50.0f, 0.0f, 0.0f), Vector(1.0f, 0.0f, 0.0f));
+    std::vector<const IndexedPlant *> slab;
+    index.querySlab({pln}, nullptr, slab);
+    int behind = 0, behindFound = 0;
+    for(auto &plnt: all)
+        if(plnt.pos.x + plnt.canopy / 2.0f < 50.0f)
+            behind++;
+    for(auto ip: slab)
+    {
+        const Plant &plnt = index.getPlant(* ip);
+        if(plnt.pos.x + plnt.canopy / 2.0f < 50.0f)
+            behindFound++;
+    }
+    check(behindFound == behind, "slab query keeps every plant behind the plane");
+
+    // ray along a row of plants strikes the first, or the first of an unmasked species
+    const IndexedPlant * hit = nullptr;
+    float tval = 0.0f;
+    bool struck = index.queryRay(vpPoint(-10.0f, 1.0f, 2.5f), Vector(1.0f, 0.0f, 0.0f), nullptr, hit, tval);
+    check(struck && hit != nullptr && approx(index.getPlant(* hit).pos.x, 2.5f), "ray strikes the nearest plant");
+    check(struck && approx(tval, 11.5f), "ray parameter of the nearest plant");
+
+    // the first plant in the row is of species 0, the first of species 2 lies at x = 17.5
+    std::vector<bool> only(maxSpecies, false);
+    only[2] = true;
+    struck = index.queryRay(vpPoint(-10.0f, 1.0f, 2.5f), Vector(1.0f, 0.0f, 0.0f), &only, hit, tval);
+    check(struck && hit != nullptr && hit->species == 2 && approx(index.getPlant(* hit).pos.x, 17.5f), "ray skips plants of masked species");
+
+    check(!index.queryRay(vpPoint(-10.0f, 10.0f, 2.5f), Vector(1.0f, 0.0f, 0.0f), nullptr, hit, tval), "ray above the canopies misses");
+
+    // any change to the grid leaves the index out of date
+    grid.clearCell(0, 0);
+    check(!index.isCurrent(&grid), "index is stale after the grid changes");
+}
+
+int main(int argc, char * argv [])
+{
+    testIndexQueries();
+
+    if(failures == 0)
+        cerr << "plantindex: all checks passed" << endl;
+    return failures;
+}
@@ -20,6 +20,7 @@
 
 #include "scene.h"
 #include "eco.h"
+#include "plantindex.h"
 #include "hash_table.h"
 
 #include <math.h>
@@ -29,6 +30,7 @@
 #include <sstream>
 #include <string>
 #include <fstream>
+#include <charconv>
 #include "data_importer/data_importer.h"
 #include "data_importer/map_procs.h"
 #include <QMessageBox>
@@ -150,18 +152,91 @@ void Transect::paintThickness(Terrain * ter)
     offvec.normalize();
     offset[1].formPlane(offpnt, offvec);
 
-    // test if grid points on vizmap lie between offset planes
     ter->getGridDim(dx, dy);
-    for(int y = 0; y < dy; y++)
-        for(int x = 0; x < dx; x++)
+
+    // without a record of the previous band, start from an empty map
+    if((int) bandstart.size() != dy)
+    {
+        mapviz->fill(0.0f);
+        bandstart.assign(dy, 0);
+        bandend.assign(dy, 0);
+    }
+
+    // grid point (x, y) lies at toWorld(y, x), which is linear in each coordinate
+    vpPoint origin = ter->toWorld(0, 0, 0.0f);
+    float convx = ter->toWorld(1, 0, 0.0f).x - origin.x; // world x per grid row
+    float convz = ter->toWorld(0, 1, 0.0f).z - origin.z; // world z per grid column
+
+    const int block = 32; // rows per dirty rectangle
+    for(int yb = 0; yb < dy; yb += block)
+    {
+        int ye = std::min(dy, yb + block);
+        int bx0 = dx, bx1 = 0; // columns changed in this block of rows
+
+        for(int y = yb; y < ye; y++)
         {
-            // position on terrain corresponding to grid point, projected onto the base plane
-            vizpnt = ter->toWorld(y, x, 0.0f); // JG/PCM - orientation flip
-            if(!offset[0].side(vizpnt) && !offset[1].side(vizpnt)) // between planes so draw in red
-                mapviz->set(x, y, 1.0f); // PCM:  more flipping (ensure map  indices are valid, adjusted other values too)
-            else
-                mapviz->set(x, y, 0.0f);
+            // the band is the interval of the row behind both offset planes
+            float lo = 0.0f, hi = (float) dx;
+            for(int p = 0; p < 2; p++)
+            {
+                float a = offset[p].n.k * convz;
+                float b = offset[p].n.i * (origin.x + (float) y * convx) + offset[p].n.k * origin.z + offset[p].d;
+                if(fabs(a) < 1.0e-6f)
+                {
+                    if(b >= 0.0f)
+                        hi = -1.0f;
+                }
+                else if(a > 0.0f)
+                    hi = std::min(hi, -b / a);
+                else
+                    lo = std::max(lo, -b / a);
+            }
+
+            // settle the ends of the interval with the exact test on grid points
+            int s = 0, e = 0;
+            if(lo <= hi)
+            {
+                int c0 = std::max(0, (int) floor(std::min(lo, (float) dx)) - 1);
+                int c1 = std::min(dx, (int) ceil(std::max(hi, 0.0f)) + 2);
+                s = c1; e = c0;
+                for(int x = c0; x < c1; x++)
+                {
+                    // position on terrain corresponding to grid point, projected onto the base plane
+                    vizpnt = ter->toWorld(y, x, 0.0f); // JG/PCM - orientation flip
+                    if(!offset[0].side(vizpnt) && !offset[1].side(vizpnt)) // between planes so draw in red
+                    {
+                        s = std::min(s, x);
+                        e = x+1;
+                    }
+                }
+                if(s >= e)
+                    s = e = 0;
+            }
+
+            // clear cells leaving the band and fill those entering it
+            int os = bandstart[y], oe = bandend[y];
+            if(s == os && e == oe)
+                continue;
+            for(int x = os; x < oe; x++)
+                if(x < s || x >= e)
+                    mapviz->set(x, y, 0.0f); // PCM:  more flipping (ensure map  indices are valid, adjusted other values too)
+            for(int x = s; x < e; x++)
+                if(x < os || x >= oe)
+                    mapviz->set(x, y, 1.0f);
+            if(os < oe)
+            {
+                bx0 = std::min(bx0, os); bx1 = std::max(bx1, oe);
+            }
+            if(s < e)
+            {
+                bx0 = std::min(bx0, s); bx1 = std::max(bx1, e);
+            }
+            bandstart[y] = s; bandend[y] = e;
         }
+
+        if(bx0 < bx1)
+            mapviz->markDirty(basic_types::MapRect{bx0, yb, bx1, ye});
+    }
 }
 
 std::pair<Plane, Plane>  Transect::getTransectPlanes(vpPoint &basePlaneOrigin)
@@ -273,6 +348,7 @@ TimelineGraph::TimelineGraph()
     timeline = nullptr;
     hscale = 0; vscale = 0;
     numseries = 0;
+    numbins = 1;
     title = "";
 }
 
@@ -281,6 +357,7 @@ TimelineGraph::TimelineGraph(Timeline * tline, int nseries, std::string name)
     title = name;
     vscale = 0;
     numseries = nseries;
+    numbins = 1;
     setTimeLine(tline);
 }
 
@@ -293,6 +370,7 @@ TimelineGraph::TimelineGraph(const TimelineGraph & rhs)
     hscale = rhs.hscale;
     vscale = rhs.vscale;
     numseries = rhs.numseries;
+    numbins = rhs.numbins;
     title = rhs.title;
 }
 
@@ -313,7 +391,7 @@ void TimelineGraph::init()
     for(int i = 0; i < numseries; i++)
     {
         std::vector<float> series;
-        series.resize(hscale, 0.0f);
+        series.resize(hscale * numbins, 0.0f);
         graphdata.push_back(series);
     }
 }
@@ -329,6 +407,7 @@ void TimelineGraph::extractDataSeries(Scene *scene, ChartType chart_type)
         extractDBHSums(scene);
         break;
     case ChartDBHDistribution:
+        extractDBHDistribution(scene);
         break;
 
     };
@@ -351,123 +430,75 @@ void TimelineGraph::assignData(int attrib, int time, float value)
         vscale = value;
 }
 
-void TimelineGraph::extractDBHSums(Scene * s)
+void TimelineGraph::extractMetric(Scene * s, TimelineStats::Metric m, bool perHectare)
 {
-    ElapsedTimer tmr("extractDBHSums");
-    int vmax = 0;
+    const TimelineStats & stats = s->getTimelineStats();
     int nspecies = s->getBiome()->numPFTypes();
-    float hectares = s->getMasterTerrain()->getTerrainHectArea();
-    setNumSeries(nspecies);
+    int ntimesteps = std::min(timeline->getNumIdx(), stats.getNumTimesteps());
+    float vmax = 0.0f;
 
-    for(int t = 0; t < timeline->getNumIdx(); t++) // iterate over timesteps
-    {
+    // restrict to the selected sub-terrain if there is one, otherwise use the whole landscape
+    float x0, y0, x1, y1, hectares;
+    bool inRegion = s->getStatsRect(x0, y0, x1, y1, hectares);
+    if(!inRegion)
+        hectares = s->getMasterTerrain()->getTerrainHectArea();
+    float scale = (perHectare ? 1.0f / hectares : 1.0f);
 
-        std::vector<basic_tree> trees(s->sampler->sample(s->cohortmaps->get_map(t), nullptr));
-        std::vector<basic_tree> mature = s->cohortmaps->get_maturetrees(t);
-        tmr.elapsed("sampler");
-   std::cerr << "\n Ntrees = " << trees.size() << "; Nmature = " << mature.size() << "\n";
-        for(auto &tree: mature)
+    numbins = 1;
+    setNumSeries(nspecies);
+    for(int t = 0; t < ntimesteps; t++) // iterate over timesteps
+    {
+        float tot = 0.0f;
+        for(int spc = 0; spc < nspecies && spc < stats.getNumSpecies(); spc++)
         {
-            if(s->getMasterTerrain()->inGridBounds(tree.y, tree.x))
-               trees.push_back(tree);
+            float val = (inRegion ? stats.getInRect(m, t, spc, x0, y0, x1, y1) : stats.get(m, t, spc)) * scale;
+            assignData(spc, t, val);
+            tot += val; // cumulative sum
         }
-        tmr.elapsed("build list");
-        auto dbhs = std::vector<float>(nspecies);
-        for (const auto &tree : trees) {
-            dbhs[tree.species] += tree.dbh;
-        }
-        float dbhtot = 0.f;
-        for (int spc=0; spc<nspecies; ++spc) {
-            dbhs[spc]/=hectares;
-            assignData(spc, t, dbhs[spc]);
-            dbhtot += dbhs[spc]; // cumulative sum
-        }
-
-        if(dbhtot > vmax)
-            vmax = dbhtot;
-        tmr.elapsed("iterate data");
+        if(tot > vmax)
+            vmax = tot;
     }
-
     setVertScale(vmax);
 }
 
-void TimelineGraph::extractNormalizedBasalArea(Scene *s)
+void TimelineGraph::extractDBHSums(Scene * s)
 {
-    ElapsedTimer tmr("extractbasal area");
-    float vmax = 0.0f;
-    int nspecies = s->getBiome()->numPFTypes();
-    float hectares = s->getMasterTerrain()->getTerrainHectArea();
-
-    setNumSeries(nspecies);
-
-    for(int t = 0; t < timeline->getNumIdx(); t++) // iterate over timesteps
-    {
-        std::vector<basic_tree> trees(s->sampler->sample(s->cohortmaps->get_map(t), nullptr));
-        std::vector<basic_tree> mature = s->cohortmaps->get_maturetrees(t);
-        for(auto &tree: mature)
-        {
-            if(s->getMasterTerrain()->inGridBounds(tree.y, tree.x))
-               trees.push_back(tree);
-        }
-        cerr << "num trees = " << (int) trees.size() << " t = " << t << endl;
-        auto basal_areas = std::vector<float>(nspecies);
-        for(const auto &tree: trees)  // count species
-            basal_areas[tree.species] += (PI * tree.dbh*tree.dbh/ 4. / 10000.); // dbh is in cm, need to convert to m.
-
-        float basaltot = 0.f;
-        for (int spc=0; spc<nspecies; ++spc) {
-            basal_areas[spc] /= hectares; // calc m2/ha
-            basaltot += basal_areas[spc];
-            assignData(spc, t, basal_areas[spc]);
-        }
-        if (basaltot > vmax)
-            vmax = basaltot;
-    }
+    extractMetric(s, TimelineStats::DBHSum, true);
+}
 
-    // print out graph data for debugging
-    cerr << "BASAL AREA GRAPH DATA" << endl;
-    for(int t = 0; t < timeline->getNumIdx(); t++) // iterate over timesteps
-    {
-        cerr << "T " << t << " ";
-        for (int spc=0; spc<nspecies; ++spc)
-        {
-            cerr <<  graphdata[spc][t] << " ";
-        }
-        cerr << endl;
-    }
-    setVertScale(vmax);
+void TimelineGraph::extractNormalizedBasalArea(Scene *s)
+{
+    extractMetric(s, TimelineStats::BasalArea, true); // calc m2/ha
 }
 
 void TimelineGraph::extractSpeciesCounts(Scene * s)
 {
-    int vmax = 0;
-    int nspecies = s->getBiome()->numPFTypes();
-    setNumSeries(nspecies);
+    extractMetric(s, TimelineStats::Stems, false);
+}
 
-    for(int t = 0; t < timeline->getNumIdx(); t++) // iterate over timesteps
-    {
-        int tot = 0;
+void TimelineGraph::extractDBHDistribution(Scene * s)
+{
+    const TimelineStats & stats = s->getTimelineStats();
+    int nspecies = s->getBiome()->numPFTypes();
+    int ntimesteps = std::min(timeline->getNumIdx(), stats.getNumTimesteps());
+    float scale = 1.0f / s->getMasterTerrain()->getTerrainHectArea();
+    float vmax = 0.0f;
 
-        std::vector<basic_tree> trees(s->sampler->sample(s->cohortmaps->get_map(t), nullptr));
-        std::vector<basic_tree> mature = s->cohortmaps->get_maturetrees(t);
-        for(auto &tree: mature)
-        {
-            if(s->getMasterTerrain()->inGridBounds(tree.y, tree.x))
-               trees.push_back(tree);
-        }
-        for(int spc = 0; spc < nspecies; spc++) // iterate over species
+    numbins = TimelineStats::dbhBins;
+    setNumSeries(nspecies);
+    for(int t = 0; t < ntimesteps; t++)
+        for(int bin = 0; bin < numbins; bin++)
         {
-            int scount = 0;
-            for(auto tree: trees)  // count species
-                if(tree.species == spc)
-                    scount++;
-            assignData(spc, t, (float) scount);
-            tot += scount;
+            float tot = 0.0f;
+            for(int spc = 0; spc < nspecies && spc < stats.getNumSpecies(); spc++)
+            {
+                float val = stats.getDBHCount(t, spc, bin) * scale;
+                graphdata[spc][t * numbins + bin] = val;
+                tot += val; // stacked height of the class
+            }
+            if(tot > vmax)
+                vmax = tot;
         }
-        if(tot > vmax)
-            vmax = tot;
-    }
-
     setVertScale(vmax);
 }
 
@@ -811,6 +842,45 @@ void Scene::reset_sampler(int maxpercell)
         sampler.reset();
     sampler = std::unique_ptr<cohortsampler>(new cohortsampler(tw, th, rw - 1.0f, rh - 1.0f, 1.0f, 1.0f, maxpercell + 5, 3));
     //sampler = std::unique_ptr<cohortsampler>(new cohortsampler(tw, th, rw - 1.0f, rh - 1.0f, 1.0f, 1.0f, 60, 3));
+
+    // cohort data has changed
+    tstats.clear();
+}
+
+const TimelineStats & Scene::getTimelineStats()
+{
+    if(!tstats.isValid() && cohortmaps && tline)
+    {
+        Terrain * master = getMasterTerrain();
+        int ntimesteps = std::min(tline->getNumIdx(), cohortmaps->get_nmaps());
+        tstats.build(* cohortmaps, ntimesteps, biome->numPFTypes(),
+                     [master](const basic_tree & tree){ return master->inGridBounds(tree.y, tree.x); });
+    }
+    return tstats;
+}
+
+bool Scene::getStatsRect(float & x0, float & y0, float & x1, float & y1, float & hectares)
+{
+    Region src;
+    float sx, sy, ex, ey, pdx, pdy;
+
+    if(masterTerrain == nullptr || !cohortmaps || !terrain->getSourceRegion(src, sx, sy, ex, ey, pdx, pdy))
+        return false;
+
+    // plants are placed on the master terrain at (tree.x + offx, tx - tree.y + offy), as in EcoSystem::placePlant,
+    // and the sub-terrain spans [sy, ey] in world x and [sx, ex] in world z
+    float tx, ty, offx, offy;
+    long terlocx, terlocy, ecolocx, ecolocy;
+    masterTerrain->getTerrainDim(tx, ty);
+    masterTerrain->getTerrainLoc(terlocx, terlocy);
+    cohortmaps->getCohortLoc(ecolocx, ecolocy);
+    offx = (float) (ecolocx-terlocx);
+    offy = (float) (ecolocy-terlocy) * -1.0f;
+
+    x0 = sy - offx; x1 = ey - offx;
+    y0 = tx + offy - ex; y1 = tx + offy - sx;
+    hectares = (ex - sx) * (ey - sy) / 10000.0f;
+    return hectares > 0.0f;
 }
 
 void Scene::loadScene(std::vector<int> timestepIDs, bool shareCohorts, std::shared_ptr<CohortMaps> cohorts)
@@ -1079,89 +1149,170 @@ void Scene::exportInstancesJSON(map<string, vector<MitsubaModel>>& speciesMap, s
 
     bool parentRegionAvailable = scene->getTerrain()->getSourceRegion(parentRegion, parentX0, parentY0, parentX1, parentY1, parentDimx, parentDimy);
 
-    PlantGrid* pg = this->getEcoSys()->getPlants();
-    for (int x = 0; x < pg->gx; x++)
+    // only plants within the parent region are exported, so restrict the search to it
+    PlantIndex * pindex = this->getEcoSys()->getPlantIndex();
+    std::vector<const IndexedPlant *> candidates;
+    if (parentRegionAvailable)
+      pindex->queryBox(parentY0, parentX0, parentY1, parentX1, nullptr, candidates);
+    else
+      pindex->querySlab({}, nullptr, candidates);
+
+    // resolve species to model sets up front, so that plants can be formatted concurrently from a read-only cache
+    const std::vector<SpeciesInfo> & spcinfo = this->biome->getSpeciesMetaData();
+    int nspecies = (int) spcinfo.size();
+    std::vector<SMitsubaCacheItem *> spcModels(nspecies, nullptr);
+    std::vector<const MitsubaModel *> spcFallback(nspecies, nullptr); // used when the cached model sets offer nothing
+    std::vector<char> spcFound(nspecies, 0);
+    for (int s = 0; s < nspecies; s++)
     {
-      for (int y = 0; y < pg->gy; y++)
+      auto it = speciesMap.find(spcinfo[s].scientific_name);
+      if (it != speciesMap.end())
       {
-			  auto ppopulation = pg->getPopulation(x, y); // Get the population of the current cell
-
-        for (int s = 0; s < (int)ppopulation->pop.size(); s++)
-        {
-          for (int p = 0; p < (int)ppopulation->pop[s].size(); p++)
-          {
-					  Plant plant = ppopulation->pop[s][p]; // Get the current plant
+        spcFound[s] = 1;
+        if (mitsuba_cache.find(it->first) == mitsuba_cache.end())
+          fillModelCache(it->first, it->second);
+        auto cit = mitsuba_cache.find(it->first);
+        if (cit != mitsuba_cache.end())
+          spcModels[s] = &cit->second;
+        else
+          cerr << "Error Scene::exportInstancesJSON: mitsuba cache not working for " << it->first << endl;
+        if (!it->second.empty())
+          spcFallback[s] = &it->second.front();
+      }
+    }
 
-					  if (parentRegionAvailable)
-					  {
-						  if (plant.pos.x < parentY0 || plant.pos.x > parentY1 || plant.pos.z < parentX0 || plant.pos.z > parentX1)
-						  {
-							  continue;
-						  }
-					  }
+    // instance text for one chunk of plants, grouped by model in plant order
+    struct InstanceChunk
+    {
+      map<string, string> text;
+      std::vector<int> pickedO, pickedNotO;
+      std::vector<char> seen;
+      int unselected;
+    };
 
-            string code = this->biome->getSpeciesMetaData()[s].scientific_name;
+    auto putNum = [](string & out, double v)
+    {
+      char buf[64];
+      out.append(buf, std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, 6).ptr);
+    };
 
-            map<string, vector<MitsubaModel>>::iterator it;
-					  if ((it = speciesMap.find(code)) != speciesMap.end()) // If the plant code is found in the profile
-            {
-              vector<MitsubaModel>& vectMitsubaModel = it->second;
+    // plants are formatted a round of chunks at a time in parallel and then appended to the model files in order,
+    // so memory stays bounded however many plants there are
+    const int chunk = 1 << 12, round = 64;
+    int ncand = (int) candidates.size();
+    int unselected = 0;
+    std::vector<InstanceChunk> chunks(round);
 
-              MitsubaModel model = getModelIndex(vectMitsubaModel, code, plant);
+    for (int r = 0; r < ncand; r += chunk * round)
+    {
+      int nc = std::min(round, (ncand - r + chunk - 1) / chunk);
 
-              if (model.id == "")
-              {
-                qDebug() << "Error to select a model " ;
-              }
-              else
-              {
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (int c = 0; c < nc; c++)
+      {
+        InstanceChunk & out = chunks[c];
+        out.text.clear();
+        out.pickedO.assign(nspecies, 0);
+        out.pickedNotO.assign(nspecies, 0);
+        out.seen.assign(nspecies, 0);
+        out.unselected = 0;
+
+        int first = r + c * chunk, last = std::min(first + chunk, ncand);
+        for (int i = first; i < last; i++)
+        {
+          const Plant & plant = pindex->getPlant(* candidates[i]);
+          int s = candidates[i]->species;
 
-                int xHash = plant.pos.x * 100;
-                int zHash = plant.pos.z * 100;
-                int rotate = hashTable[(int)(hashTable[(int)((xHash) & 0xfffL)] ^ ((zHash) & 0xfffL))] % 360;
-                double scale = plant.height / model.height;
+          if (parentRegionAvailable) // candidates include plants whose canopy only overlaps the region
+          {
+            if (plant.pos.x < parentY0 || plant.pos.x > parentY1 || plant.pos.z < parentX0 || plant.pos.z > parentX1)
+            {
+              continue;
+            }
+          }
+          if (s < 0 || s >= nspecies)
+            continue;
+          out.seen[s] = 1;
+          if (!spcFound[s]) // plant code not found in the profile
+            continue;
+
+          const MitsubaModel * model = nullptr;
+          if (spcModels[s] != nullptr)
+          {
+            bool open;
+            model = spcModels[s]->pickModel(plant, open);
+            (open ? out.pickedO : out.pickedNotO)[s]++;
+          }
+          if (model == nullptr)
+            model = spcFallback[s];
+          if (model == nullptr || model->id == "")
+          {
+            out.unselected++;
+            continue;
+          }
 
-                // Current Instance
-                string key = model.id;
-                if (streams.find(key) != streams.end())
-                {
-                  streams[key] << ",\n";
-                }
-                else
-                {
-                  // Create Stream
-                  streams.emplace(key, ofstream());
-
-                  // Init stream
-                  streams[key].open(urlInstances + "/" + nameInstances + "/" + nameInstances + "_" + key + ".json");
-                  streams[key].imbue(std::locale::classic());
-                  streams[key] << std::fixed << std::setprecision(6);
-                  streams[key] << "{\n";
-                  streams[key] << "\t\"ObjectsInstances\": [\n";
-                  streams[key] << "\t{\n";
-                  streams[key] << "\t\t\"Ref\": \"" << key << "\",\n";
-                  streams[key] << "\t\t\"Instances\": [\n";
-                }
+          int xHash = plant.pos.x * 100;
+          int zHash = plant.pos.z * 100;
+          int rotate = hashTable[(int)(hashTable[(int)((xHash) & 0xfffL)] ^ ((zHash) & 0xfffL))] % 360;
+          double scale = plant.height / model->height;
+
+          // Current Instance
+          string & stream = out.text[model->id];
+          if (!stream.empty())
+            stream += ",\n";
+          stream += "\t\t\t{";
+          stream += "\"Rotate\": [ 0, "; putNum(stream, rotate / 10.); stream += ", 0 ],"; // Rotation Y
+          stream += "\"Translate\": [ "; putNum(stream, plant.pos.x - parentY0); stream += ", "; // Translation
+          putNum(stream, plant.pos.y); stream += ", "; putNum(stream, plant.pos.z - parentX0); stream += " ],";
+          stream += "\"Scale\": [ "; putNum(stream, scale); stream += ", "; // Scale
+          putNum(stream, scale); stream += ", "; putNum(stream, scale); stream += " ]";
+          stream += "}";
+        }
+      }
 
-                ofstream& stream = streams[key];
+      for (int c = 0; c < nc; c++)
+      {
+        for (auto & ent : chunks[c].text)
+        {
+          const string & key = ent.first;
+          auto it = streams.find(key);
+          if (it != streams.end())
+          {
+            it->second << ",\n";
+          }
+          else
+          {
+            // Create and init stream
+            it = streams.emplace(key, ofstream()).first;
+            it->second.open(urlInstances + "/" + nameInstances + "/" + nameInstances + "_" + key + ".json");
+            it->second << "{\n";
+            it->second << "\t\"ObjectsInstances\": [\n";
+            it->second << "\t{\n";
+            it->second << "\t\t\"Ref\": \"" << key << "\",\n";
+            it->second << "\t\t\"Instances\": [\n";
+          }
+          it->second.write(ent.second.data(), (std::streamsize) ent.second.size());
+        }
 
-                stream << "\t\t\t{";
-                stream << "\"Rotate\": [ 0, " << rotate / 10. << ", 0 ],";// Rotation Y
-                stream << "\"Translate\": [ " << plant.pos.x - parentY0 << ", " << plant.pos.y << ", " << plant.pos.z - parentX0 << " ],";// Translation
-                stream << "\"Scale\": [ " << scale << ", " << scale << ", " << scale << " ]";// Scale
-                stream << "}";
-              }
-            }
-            else if (plantCodeNotFound.find(code) == plantCodeNotFound.end())
-            {
-              // Plant code was not found in the profile
-              plantCodeNotFound.insert(code);
-            }
+        for (int s = 0; s < nspecies; s++)
+        {
+          if (!chunks[c].seen[s])
+            continue;
+          if (!spcFound[s])
+            plantCodeNotFound.insert(spcinfo[s].scientific_name);
+          else if (spcModels[s] != nullptr)
+          {
+            spcModels[s]->pickedO += chunks[c].pickedO[s];
+            spcModels[s]->pickedNotO += chunks[c].pickedNotO[s];
           }
         }
+        unselected += chunks[c].unselected;
       }
     }
-  
+
+    if (unselected > 0)
+      qDebug() << "Error to select a model for" << unselected << "plants";
+
     if (!streams.empty())
 	  {
       jsonFile << "{\n";
@@ -1323,7 +1474,7 @@ void Scene::dumpModelSelection(const string filename)
 
 }
 
-MitsubaModel Scene::SMitsubaCacheItem::selectModel(Plant &plant) {
+const MitsubaModel * Scene::SMitsubaCacheItem::pickModel(const Plant &plant, bool &open) const {
 
     int iheight = static_cast<int>(plant.height);
     double r0 = iheight>=0 && iheight<radiusO.size() ? radiusO[iheight] : 1;
@@ -1341,36 +1492,16 @@ MitsubaModel Scene::SMitsubaCacheItem::selectModel(Plant &plant) {
     */
     const int hack_force_closed_canopy_trees = 5;
 
-    if (plant.canopy + hack_force_closed_canopy_trees > (r0 + rNotO) / 2.0) {
-        selectedModels = &endingWithO;
-        ++pickedO;
-    } else {
-        selectedModels = &notEndingWithO;
-        ++pickedNotO;
-    }
+    open = (plant.canopy + hack_force_closed_canopy_trees > (r0 + rNotO) / 2.0);
+    selectedModels = (open ? &endingWithO : &notEndingWithO);
 
     // Find the first model with height >= plant.height
     for (const auto& model : *selectedModels) {
         if (model.height >= plant.height)
-            return model;
+            return &model;
     }
     // fallback to smallest model if none match
-    return selectedModels->empty() ? MitsubaModel{} : selectedModels->front();
-}
-
-MitsubaModel Scene::getModelIndex(const std::vector<MitsubaModel>& models, const std::string &code, Plant plant)
-{
-
-    auto it = mitsuba_cache.find(code);
-    if (it == mitsuba_cache.end()) {
-        fillModelCache(code, models);
-        it = mitsuba_cache.find(code);
-        if (it == mitsuba_cache.end()) {
-            cerr << "panic - mitsuba cache not working in Scene::getModelIndex";
-            return models.front();
-        }
-    }
-    return it->second.selectModel(plant);
+    return selectedModels->empty() ? nullptr : &selectedModels->front();
 }
 
 
@@ -1430,16 +1561,26 @@ void Scene::exportTerrainJSON(const string terrainURL, const string terrainName,
 
   QDir().mkdir(QString::fromStdString(terrainURL) + "OBJ");
   QDir().mkdir(QString::fromStdString(terrainURL) + "Masks");
+  QDir().mkdir(QString::fromStdString(terrainURL) + "Contours");
 
-  // Export OBJ
+  // Export OBJ, decimated to within a tenth of the grid spacing, which is not visible at render resolution
   Terrain* terrain = getTerrain();
-  terrain->saveOBJ(terrainURL + "OBJ/" + terrainName + ".obj");
+  terrain->saveMesh(terrainURL + "OBJ/" + terrainName + ".obj", 0.1f * terrain->getPointStep());
   terrain->saveOBJ_Border(terrainURL + "OBJ/" + terrainName+"_Border.obj");
 
   // Create terrain texture
   // - Save Masks according to a specific slope
   exportTextureSlope(terrainURL + "Masks/"+ terrainName + "maskSlopeBedrock.png", 50.,55.);
   exportTextureSlope(terrainURL + "Masks/" + terrainName + "maskSlopeGround.png", 60., 78.);
+  exportTextureAO(terrainURL + "Masks/" + terrainName + "ambientOcclusion.png", terrainURL + "Masks/" + terrainName + "skyView.png");
+
+  // Contours at a round interval giving about 20 levels over the height range
+  float minh, maxh;
+  terrain->getHeightBounds(minh, maxh);
+  float raw = std::max((maxh - minh) / 20.0f, 0.1f);
+  float step = std::pow(10.0f, std::floor(std::log10(raw)));
+  float interval = step * (raw < 1.5f * step ? 1.0f : (raw < 3.5f * step ? 2.0f : (raw < 7.5f * step ? 5.0f : 10.0f)));
+  exportContours(terrainURL + "Contours/" + terrainName + "contours.geojson", terrainURL + "Contours/" + terrainName + "contours.svg", interval);
 
   // Export JSON
   ofstream jsonFile;
@@ -1564,3 +1705,72 @@ void Scene::exportTextureSlope(string URL, float slopeMin, float slopeMax)
 
   slopeImage.save(QString(URL.data()) );
 }
+
+void Scene::exportTextureAO(const string aoURL, const string svfURL)
+{
+  basic_types::MapFloat aoMap, svfMap;
+  Region src;
+  float sx, sy, ex, ey, pdx, pdy;
+  int x, y;
+
+  terrain->getGridDim(x, y);
+
+  if (masterTerrain != nullptr && terrain->getSourceRegion(src, sx, sy, ex, ey, pdx, pdy))
+  {
+    // horizons reach beyond the sub-terrain, so compute over the input terrain and crop
+    string demname = basename;
+    if (!ifstream(datadir + "/" + basename + ".elvb").is_open() && !ifstream(datadir + "/" + basename + ".elv").is_open())
+      demname = "dem";
+
+    basic_types::MapFloat fullAO, fullSVF;
+    masterTerrain->calcAOCached(datadir + "/" + demname + ".ao", &fullAO, &fullSVF);
+    aoMap.setDim(x, y);
+    svfMap.setDim(x, y);
+    for (int i = 0; i < x; i++)
+      for (int j = 0; j < y; j++)
+      {
+        aoMap.set(i, j, fullAO.get(src.x0 + i, src.y0 + j));
+        svfMap.set(i, j, fullSVF.get(src.x0 + i, src.y0 + j));
+      }
+  }
+  else
+  {
+    terrain->calcAO(&aoMap, &svfMap);
+  }
+
+  QImage aoImage(x, y, QImage::Format_RGB32), svfImage(x, y, QImage::Format_RGB32);
+  for (int i = 0; i < x; i++)
+  {
+    for (int j = 0; j < y; j++)
+    {
+      int ao = (int) (255.0f * aoMap.get(i, j) + 0.5f);
+      int svf = (int) (255.0f * svfMap.get(i, j) + 0.5f);
+      aoImage.setPixel(i, (y-1)-j, qRgb(ao, ao, ao));
+      svfImage.setPixel(i, (y-1)-j, qRgb(svf, svf, svf));
+    }
+  }
+
+  aoImage.save(QString(aoURL.data()));
+  svfImage.save(QString(svfURL.data()));
+}
+
+void Scene::exportContours(const string geojsonURL, const string svgURL, float interval)
+{
+  float minh, maxh, tx, ty;
+  std::vector<ContourLine> lines;
+
+  terrain->getHeightBounds(minh, maxh);
+  terrain->getTerrainDim(tx, ty);
+  terrain->extractContours(contourLevels(minh, maxh, interval), lines);
+  writeContoursGeoJSON(geojsonURL, lines);
+
+  // the masks put world z across the image and world x up it
+  for (auto & line : lines)
+    for (size_t p = 0; p < line.xy.size(); p += 2)
+    {
+      float wx = line.xy[p];
+      line.xy[p] = line.xy[p+1];
+      line.xy[p+1] = tx - wx;
+    }
+  writeContoursSVG(svgURL, lines, ty, tx, interval);
+}
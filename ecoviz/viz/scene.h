@@ -31,6 +31,7 @@
 #include "typemap.h"
 #include "shape.h"
 #include "cohortsampler.h"
+#include "timelinestats.h"
 #include "mitsuba_model.h"
 
 // minimum and maximum transect thickness
@@ -52,6 +53,7 @@ private:
     bool redraw;        //< whether or not a redraw of transect manipulators is required
     bool valid;       //< true if a valid transect exists, false otherwise
     basic_types::MapFloat * mapviz; //< visualization in map form of the thickness of the transect
+    std::vector<int> bandstart, bandend; //< columns [start, end) of each row of mapviz currently inside the transect band
 
     /**
      * @brief findBoundPoints From a source point and vector direction find points on the defined line lying on the extreme edges of the terrain
@@ -64,7 +66,8 @@ private:
     bool findBoundPoints(vpPoint src, Vector dirn, vpPoint * bnd, Terrain * ter);
 
     /**
-     * @brief paintThickness Draw the transect thickness visualization into mapviz
+     * @brief paintThickness Draw the transect thickness visualization into mapviz. Only cells entering or leaving
+     *                       the band since the last call are written, and these are marked dirty in mapviz.
      */
     void paintThickness(Terrain * ter);
 
@@ -105,6 +108,7 @@ public:
         ter->getGridDim(dx, dy);
         mapviz->setDim(dx, dy);
         mapviz->fill(0.0f);
+        bandstart.clear(); bandend.clear();
     }
 
     // if non null ter provided, retarget this terrain
@@ -117,6 +121,7 @@ public:
         if (ter == nullptr)
         {
             mapviz->fill(0.0f);
+            bandstart.clear(); bandend.clear();
         }
         else // reset to new terrain dimensions
         {
@@ -173,7 +178,7 @@ public:
     inline bool getValidFlag(){ return valid; }
     inline void setValidFlag(bool status){ valid = status; }
     inline basic_types::MapFloat * getTransectMap(){ return mapviz; }
-    inline void setTransectMap(basic_types::MapFloat * mviz){ mapviz = mviz; }
+    inline void setTransectMap(basic_types::MapFloat * mviz){ mapviz = mviz; bandstart.clear(); bandend.clear(); }
 
     /**
      * @brief clearChangeFlag reset change flag to false
@@ -281,11 +286,21 @@ private:
     Timeline * timeline;    //< associated timeline for marking the current time and retrieving timeline bounds
     std::vector<std::vector<float>> graphdata; //< per attribute (e.g., species) per timestep data
     int hscale;             //< number of steps in the timeline
+    int numbins;            //< values per timestep, 1 for a time series and the number of classes for a distribution
     float vscale;             //< highest value on the verical axis
     int numseries;          //< number of attributes
     std::string title;      //< title for the graph
     static std::vector< std::string > graph_titles;
 
+    /**
+     * @brief extractMetric Fill the graph from the scene's timeline statistics, with one series per species, over the
+     *                      scene's sub-terrain if it has one
+     * @param s             Scene for extracting statistics
+     * @param m             statistic to graph
+     * @param perHectare    divide values by the area covered
+     */
+    void extractMetric(Scene * s, TimelineStats::Metric m, bool perHectare);
+
 public:
 
     TimelineGraph();
@@ -307,6 +322,7 @@ public:
     void setNumSeries(int nseries){ numseries = nseries; init(); }
     int getNumSeries(){ return numseries; }
     int getHoriScale(){ return hscale; }
+    int getNumBins(){ return numbins; }
     std::string getTitle() { return title; }
 
     // types of data series
@@ -328,6 +344,9 @@ public:
     void assignData(int attrib, int time, float value);
     float getData(int attrib, int time){ return graphdata[attrib][time]; }
 
+    /// value of an attribute in one class of a distribution at a particular time
+    float getBinData(int attrib, int time, int bin){ return graphdata[attrib][time * numbins + bin]; }
+
     /**
      * @brief extractSpeciesCounts Create a graph for the number of instances of each species over the timeline period
      * @param s     Scene for extracting counts
@@ -345,6 +364,13 @@ public:
      * @param s     Scene for extracting counts
      */
     void extractNormalizedBasalArea(Scene * s);
+
+    /**
+     * @brief extractDBHDistribution Create a distribution of trees per hectare over diameter at breast height classes,
+     *                               for each species and timestep, from the histogram of the whole landscape
+     * @param s     Scene for extracting counts
+     */
+    void extractDBHDistribution(Scene * s);
 };
 
 // for externally managing the saving and restoring sub-regions and camera views
@@ -466,6 +492,7 @@ private:
 
     EcoSystem * eco;
     Biome * biome;
+    TimelineStats tstats;                       //< per species stand statistics over the timeline, built on demand
 
     // ensure scene directory is valid
     std::string get_dirprefix();
@@ -480,7 +507,9 @@ private:
         std::vector<double> radiusNotO;
         int pickedO {0};
         int pickedNotO {0};
-        MitsubaModel selectModel(Plant &plant);
+        // model for a plant, nullptr if the chosen set is empty; @a open reports the model set chosen, which the
+        // caller tallies, so that picking is safe to call concurrently
+        const MitsubaModel * pickModel(const Plant &plant, bool &open) const;
 
     };
 
@@ -509,6 +538,8 @@ public:
     // set new Terrain core data; assumes newTerr has internal state set up
     void setNewTerrainData(std::unique_ptr<Terrain> newTerr, Terrain *master)
     {
+        if(terrain)
+            newTerr->inheritHeightMap(* terrain);
         terrain = std::move(newTerr);
 
         terrain->calcMeanHeight();
@@ -521,6 +552,9 @@ public:
         getTypeMap(TypeMapType::EMPTY)->matchDim(dy, dx);
         getTypeMap(TypeMapType::EMPTY)->clear();
 
+        // timeline statistics cover the master terrain, and are only restricted to the sub-terrain when queried
+        if(master != masterTerrain)
+            tstats.clear();
         masterTerrain = master;
     }
 
@@ -555,6 +589,24 @@ public:
     */
     void reset_sampler(int maxpercell);
 
+    /**
+     * @brief getTimelineStats  Per species and timestep stand statistics for the cohort data, gathered on first use
+     *                          and kept until the cohort data or terrain changes
+     */
+    const TimelineStats & getTimelineStats();
+
+    /// discard gathered timeline statistics, so that they are rebuilt on next use
+    void invalidateTimelineStats(){ tstats.clear(); }
+
+    /**
+     * @brief getStatsRect  Rectangle of cohort coordinates, as used by the timeline statistics, covered by the current
+     *                      sub-terrain of the master terrain
+     * @param x0, y0, x1, y1    corners of the rectangle
+     * @param hectares          area of the rectangle
+     * @retval @c true if the terrain is a sub-region of the master terrain, otherwise the whole landscape is in view
+     */
+    bool getStatsRect(float & x0, float & y0, float & x1, float & y1, float & hectares);
+
     /**
      * @brief loadScene     Load scene attributes located in the specified directory (or default initialization if no directory provided)
      * @param dirprefix     combined directory path and file name prefix containing the scene
@@ -620,13 +672,21 @@ public:
      void exportTextureSlope(const string URL, float slopeMin, float slopeMax);
 
      /**
-			* @brief Get the index of the model to be used for a given plant
-      * @param models 
-      * @param plant
-      * @return MitsubaModel of the chosen plant
+      * @brief compute ambient occlusion and sky-view factor and export them as greyscale textures. The maps are
+      *        computed over the whole input terrain, cached next to its DEM, and cropped to this scene's terrain.
+      * @param aoURL    ambient occlusion texture
+      * @param svfURL   sky-view factor texture
       */
-     MitsubaModel getModelIndex(const std::vector<MitsubaModel>& models, const string &code, Plant plant );
+     void exportTextureAO(const string aoURL, const string svfURL);
 
+     /**
+      * @brief extract height contours of the terrain and export them as GeoJSON in world x, z coordinates and as SVG
+      *        oriented like the mask textures
+      * @param geojsonURL   GeoJSON file
+      * @param svgURL       SVG file
+      * @param interval     height separation of the contours, in metres
+      */
+     void exportContours(const string geojsonURL, const string svgURL, float interval);
 
      /**
             * @brief get a descriptive string on data shown in the scene
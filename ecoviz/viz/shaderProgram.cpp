@@ -39,10 +39,122 @@
 
 #include "shaderProgram.h"
 #include <qfile.h>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <cstring>
+#include <map>
 
 namespace PMrender
 {
 
+  // programs linked so far in this run, by share group and key. Program objects are visible to every context in a
+  // share group, and like all programs here they live for the rest of the run, so renderers created later reuse them.
+  static std::map<std::pair<QOpenGLContextGroup *, QByteArray>, GLuint> linkedPrograms;
+
+  static const char programBinaryMagic[] = "ECOVIZPB"; // tag at the start of cached program binaries
+
+  // key for a program: a hash of the driver identification and the source of both stages
+  static QByteArray programKey(const std::string & vertSrc, const std::string & fragSrc)
+  {
+    QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
+    QByteArray id;
+
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+      const GLubyte * str = f->glGetString(name);
+      if (str != nullptr)
+        id.append((const char *) str);
+      id.append('\n');
+    }
+    id.append(vertSrc.c_str(), (qsizetype) vertSrc.size());
+    id.append('\0');
+    id.append(fragSrc.c_str(), (qsizetype) fragSrc.size());
+    return QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex();
+  }
+
+  static QString programCachePath(const QByteArray & key)
+  {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders/" + QString::fromLatin1(key) + ".bin";
+  }
+
+  static bool programBinariesSupported(void)
+  {
+    GLint formats = 0;
+    QOpenGLContext::currentContext()->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+  }
+
+  // create a program from a binary saved by an earlier run, returning 0 if there is none or the driver rejects it
+  static GLuint loadProgramBinary(const QByteArray & key)
+  {
+    QString path = programCachePath(key);
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+      return 0;
+    QByteArray blob = file.readAll();
+    file.close();
+
+    const int magicLen = (int) sizeof(programBinaryMagic) - 1;
+    const int headerLen = magicLen + (int) sizeof(GLenum);
+    if (blob.size() <= headerLen || !blob.startsWith(programBinaryMagic))
+    {
+      QFile::remove(path);
+      return 0;
+    }
+
+    GLenum format;
+    std::memcpy(&format, blob.constData() + magicLen, sizeof(GLenum));
+
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+    GLuint program = f->glCreateProgram();
+    f->glProgramBinary(program, format, blob.constData() + headerLen, (GLsizei) (blob.size() - headerLen));
+
+    GLint linked = 0;
+    f->glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == 0) // stale binary, e.g. after a driver update; it is rebuilt from source
+    {
+      f->glDeleteProgram(program);
+      QFile::remove(path);
+      return 0;
+    }
+    return program;
+  }
+
+  // save the binary of a linked program for later runs
+  static void saveProgramBinary(const QByteArray & key, GLuint program)
+  {
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+    GLint length = 0;
+
+    f->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+      return;
+
+    QByteArray blob(length, 0);
+    GLenum format = 0;
+    GLsizei written = 0;
+    f->glGetProgramBinary(program, length, &written, &format, blob.data());
+    if (written <= 0)
+      return;
+
+    QString path = programCachePath(key);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path); // written in full or not at all, so another instance never reads a partial binary
+    if (!file.open(QIODevice::WriteOnly))
+    {
+      std::cerr << "Could not write shader cache file: " << path.toStdString() << std::endl;
+      return;
+    }
+    file.write(programBinaryMagic, sizeof(programBinaryMagic) - 1);
+    file.write((const char *) &format, sizeof(GLenum));
+    file.write(blob.constData(), written);
+    file.commit();
+  }
+
   // Function to convert OpenGL error codes to a string
   QString getOpenGLErrorString(GLenum error) {
     switch (error) {
@@ -230,6 +342,25 @@ namespace PMrender
       fshader.close();
     }
 
+    // reuse a program linked earlier in this run, or restore one from disk, before compiling from source
+    QByteArray key = programKey(vertSrc, fragSrc);
+    auto cacheEntry = std::make_pair(QOpenGLContext::currentContext()->shareGroup(), key);
+    auto linked = linkedPrograms.find(cacheEntry);
+    if (linked != linkedPrograms.end())
+    {
+      program_ID = linked->second;
+      shaderReady = true;
+      return true;
+    }
+
+    bool useBinaries = programBinariesSupported();
+    if (useBinaries && (program_ID = loadProgramBinary(key)) != 0)
+    {
+      linkedPrograms[cacheEntry] = program_ID;
+      shaderReady = true;
+      return true;
+    }
+
     GLuint err = compileProgram(GL_VERTEX_SHADER, const_cast<GLchar*>(vertSrc.c_str()), vert_ID);
     if (0 != err)
     {
@@ -249,6 +380,8 @@ namespace PMrender
     program_ID = f->glCreateProgram();
     f->glAttachShader(program_ID, vert_ID);
     f->glAttachShader(program_ID, frag_ID);
+    if (useBinaries)
+      QOpenGLContext::currentContext()->extraFunctions()->glProgramParameteri(program_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
     err = linkProgram(program_ID);
     if (GL_NO_ERROR != err)
@@ -271,6 +404,15 @@ namespace PMrender
       vert_ID = 0;
     }
 
+    GLint linkStatus = 0;
+    f->glGetProgramiv(program_ID, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != 0) // only programs that work are worth sharing
+    {
+      linkedPrograms[cacheEntry] = program_ID;
+      if (useBinaries)
+        saveProgramBinary(key, program_ID);
+    }
+
     shaderReady = true;
     return true;
   }
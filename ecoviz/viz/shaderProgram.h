@@ -63,7 +63,9 @@ public:
     // void setShaderSources(const std::string& frageSource, const std::string& vertSource);
     void setShaderSources(const char * fragSourceFile, const char * vertSourceFile);
 
-    bool  compileAndLink(void); //compile and link shaders
+    // compile and link shaders. A program with identical sources is shared if one has already been linked in this
+    // context's share group, or restored from a program binary saved by an earlier run with the same driver
+    bool  compileAndLink(void);
 
     GLuint getProgramID(void) const { return program_ID; }
     bool initialised(void) const {return shaderReady; }
@@ -27,6 +27,12 @@
 #include "shape.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+
+const int minInstanceCapacity = 64; //< smallest allocation for instance buffers
+
+// global source of geometry revisions, so that a mesh refilled from another shape's geometry never sees a stale stamp
+static long shapeRevisionCounter = 0;
 
 //
 // Shape
@@ -46,9 +52,15 @@ void Shape::setColour(GLfloat * col)
     specular[3] = diffuse[3];
 }
 
+void Shape::touchGeometry()
+{
+    geomRev = ++shapeRevisionCounter;
+}
+
 void Shape::genCylinder(float radius, float height, int slices, int stacks, glm::mat4x4 trm)
 {
     int i, j, base;
+    touchGeometry();
 
     float a, x, y, h = 0.0f;
     float stepa = PI2 / (float) slices;
@@ -97,6 +109,7 @@ void Shape::genCylinder(float radius, float height, int slices, int stacks, glm:
 void Shape::genCappedCylinder(float startradius, float endradius, float height, int slices, int stacks, glm::mat4x4 trm, bool clip)
 {
     int i, j, base;
+    touchGeometry();
 
     float a, x, y, h = 0.0f, radius;
     float stepa = PI2 / (float) slices;
@@ -225,6 +238,7 @@ void Shape::genCappedCylinder(float startradius, float endradius, float height,
 void Shape::genCappedCone(float startradius, float height, int slices, int stacks, glm::mat4x4 trm, bool clip)
 {
     int i, j, base;
+    touchGeometry();
 
     float endradius = 0.001f;
     float a, x, y, h = 0.0f, radius;
@@ -318,6 +332,7 @@ void Shape::genPyramid(float baselen, float toplen, float height, glm::mat4x4 tr
     Vector v;
     glm::vec4 p;
     glm::vec3 n;
+    touchGeometry();
 
     // base verts
     vpPoint b[4];
@@ -457,6 +472,7 @@ void Shape::genSphere(float radius, int slices, int stacks, glm::mat4x4 trm)
 {
     int lat, lon, base;
     float plat, plon;
+    touchGeometry();
 
     // doesn't produce very evenly sized triangles, tend to cluster at poles
     base = int(verts.size()) / 8;
@@ -510,6 +526,7 @@ void Shape::genTest()
 
 void Shape::genCurve(std::vector<vpPoint> &curve, View * view, float thickness, float tol, bool closed, bool offset, bool viewadapt)
 {
+    touchGeometry();
 
     // Double the number of vertices actually required. Consider compacting later.
 
@@ -667,6 +684,7 @@ void Shape::genCylinderCurve(std::vector<vpPoint> &curve, float radius, float to
     glm::vec3 trs, n, rot;
     float angle, a, x, y, stepa = PI2 / (float) slices;
     glm::vec4 p;
+    touchGeometry();
 
     base = int(verts.size()) / 8;
     if((int) curve.size() > 1)
@@ -794,6 +812,7 @@ void Shape::genDashedCylinderCurve(std::vector<vpPoint> &curve, float radius, fl
     float angle, a, x, y, stepa = PI2 / (float) slices, dashaccum = 0.0f;
     glm::vec4 p;
     bool dashon = true;
+    touchGeometry();
 
     base = int(verts.size()) / 8;
     if((int) curve.size() > 1)
@@ -915,6 +934,7 @@ void Shape::genSphereCurve(std::vector<vpPoint> &curve, float thickness)
     int i;
     glm::mat4 tfm, idt;
     glm::vec3 trs;
+    touchGeometry();
 
     // assume view transformations are set up correctly
     if((int) curve.size() > 0)
@@ -956,6 +976,7 @@ void Shape::genHemisphere(float radius, int slices, int stacks, glm::mat4x4 trm)
 {
     int lat, lon, base;
     float plat, plon;
+    touchGeometry();
 
     // doesn't produce very evenly sized triangles, tend to cluster at poles
     base = int(verts.size()) / 8;
@@ -998,6 +1019,7 @@ void Shape::genPlane(const vpPoint &orient, const vpPoint &center, float thickne
     glm::vec4 p;
     Vector v;
     glm::vec3 n;
+    touchGeometry();
 
     glm::vec3 cent = glm::vec3(center.x, center.y, center.z);
     glm::vec3 ornt = glm::vec3(orient.x, orient.y, orient.z);
@@ -1045,10 +1067,15 @@ void Shape::genPlane(const vpPoint &orient, const vpPoint &center, float thickne
 }
 
 ShapeDrawData Shape::getDrawParameters()
+{
+    return getDrawParameters(inst);
+}
+
+ShapeDrawData Shape::getDrawParameters(const ShapeInstances &instances)
 {
     ShapeDrawData sdd;
 
-    sdd.VAO = vaoConstraint;
+    sdd.VAO = instances.getVAO();
     for(int i = 0; i < 4; i++)
         sdd.diffuse[i] = diffuse[i];
     for(int i = 0; i < 4; i++)
@@ -1056,7 +1083,7 @@ ShapeDrawData Shape::getDrawParameters()
     for(int i = 0; i < 4; i++)
         sdd.ambient[i] = ambient[i];
     sdd.indexBufSize = (int) indices.size();
-    sdd.numInstances = numInstances;
+    sdd.numInstances = instances.getNumInstances();
     sdd.texID = 0;
     sdd.current = false; // default setting
 
@@ -1066,178 +1093,210 @@ ShapeDrawData Shape::getDrawParameters()
 
 bool Shape::bindInstances(std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols)
 {
+    return bindInstances(inst, iTransl, iScale, icols);
+}
 
-    size_t bytesBound = 0;
-
-    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
-
-    if((int) indices.size() > 0 && ((int) iTransl->size() == (int) icols->size()))
-    {
-        if (vboConstraint != 0)
-        {
-
-            ef->glDeleteVertexArrays(1, &vaoConstraint);
-            ef->glDeleteBuffers(1, &vboConstraint);
-            ef->glDeleteBuffers(1, &iboConstraint);
-            //glDeleteBuffers(1, &iBuffer);
-            ef->glDeleteBuffers(1, &iTranslBuffer);
-            ef->glDeleteBuffers(1, &iScaleBuffer);
-            ef->glDeleteBuffers(1, &cBuffer);
-            vaoConstraint = 0;
-            vboConstraint = 0;
-            iboConstraint = 0;
-            //iBuffer = 0;
-            iTranslBuffer = 0;
-            iScaleBuffer = 0;
-            cBuffer = 0;
-        }
-
-        // vao
-        ef->glGenVertexArrays(1, &vaoConstraint);
-        ef->glBindVertexArray(vaoConstraint);
-
-        // vbo
-        // set up vertex buffer and copy in data
-        ef->glGenBuffers(1, &vboConstraint);
-        ef->glBindBuffer(GL_ARRAY_BUFFER, vboConstraint);
-        ef->glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*(int) verts.size(), (GLfloat *) &verts[0], GL_STATIC_DRAW);
+bool Shape::bindInstances(ShapeInstances &instances, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols)
+{
+    if((int) indices.size() == 0)
+        return false;
+    mesh.upload(verts, indices, geomRev);
+    return instances.bind(mesh, iTransl, iScale, icols);
+}
 
-        bytesBound += sizeof(GLfloat)*(int) verts.size();
+bool Shape::updateInstances(ShapeInstances &instances, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols,
+                            const std::vector<std::pair<int, int>> &runs)
+{
+    if((int) indices.size() == 0)
+        return false;
+    mesh.upload(verts, indices, geomRev);
+    return instances.update(mesh, iTransl, iScale, icols, runs);
+}
 
-        // ibo
-        ef->glGenBuffers(1, &iboConstraint);
-        ef->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboConstraint);
-        ef->glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*(int) indices.size(), (GLuint *) &indices[0], GL_STATIC_DRAW);
+//
+// ShapeMesh
+//
 
-        bytesBound += sizeof(GLuint) * (int)indices.size();
+void ShapeMesh::upload(const std::vector<float> &meshVerts, const std::vector<unsigned int> &meshIndices, long meshRevision)
+{
+    if (vbo != 0 && meshRevision == revision)
+        return;
 
-        // enable position attribute
-        ef->glEnableVertexAttribArray(0);
-        ef->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void*)(0));
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
 
-        // enable texture coord attribute
-        const int sz = 3*sizeof(GLfloat);
-        ef->glEnableVertexAttribArray(1);
-        ef->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void*)(sz) );
+    if (vbo == 0)
+    {
+        ef->glGenBuffers(1, &vbo);
+        ef->glGenBuffers(1, &ibo);
+    }
 
-        // enable normals
-        const int nz = 5*sizeof(GLfloat);
-        ef->glEnableVertexAttribArray(2);
-        ef->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void*)(nz) );
+    // the element buffer is bound to the array target so as not to disturb whatever vertex array is bound
+    ef->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    ef->glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*(int) meshVerts.size(), (GLfloat *) &meshVerts[0], GL_STATIC_DRAW);
+    ef->glBindBuffer(GL_ARRAY_BUFFER, ibo);
+    ef->glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint)*(int) meshIndices.size(), (GLuint *) &meshIndices[0], GL_STATIC_DRAW);
+    ef->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    revision = meshRevision;
+}
 
-        // generate buffer for translation and scaling (2 scales only)
+void ShapeMesh::release()
+{
+    if (vbo != 0 && QOpenGLContext::currentContext() != nullptr)
+    {
+        QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
 
-        ef->glGenBuffers(1, &iTranslBuffer);
-        ef->glBindBuffer(GL_ARRAY_BUFFER, iTranslBuffer);
-        if((int) iTransl->size() > 0) // load instance data
-        {
-            numInstances = (int) iTransl->size();
-            ef->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * numInstances, (GLfloat *) & (* iTransl)[0], GL_DYNAMIC_DRAW);
+        ef->glDeleteBuffers(1, &vbo);
+        ef->glDeleteBuffers(1, &ibo);
+    }
+    vbo = ibo = 0;
+    revision = -1;
+}
 
-            bytesBound  += sizeof(glm::vec3) * numInstances;
-        }
-        else // create a single instance
-        {
-            numInstances = 1;
-            //std::vector<glm::mat4> tmpform;
-            //glm::mat4 idt = glm::mat4(1.0f);
-            //tmpform.push_back(idt);
-            glm::vec3 tmpform = {0.0, 0.0, 0.0};
+//
+// ShapeInstances
+//
 
-            ef->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * numInstances, (GLfloat *) &tmpform[0], GL_DYNAMIC_DRAW);
+void ShapeInstances::release()
+{
+    QOpenGLContext * ctx = QOpenGLContext::currentContext();
 
-            bytesBound += sizeof(glm::vec3) * numInstances;
-        }
+    if (vaoConstraint != 0 && ctx != nullptr)
+    {
+        QOpenGLExtraFunctions *ef = ctx->extraFunctions();
 
-        ef->glGenBuffers(1, &iScaleBuffer);
-        ef->glBindBuffer(GL_ARRAY_BUFFER, iScaleBuffer);
-        if((int) iScale->size() > 0) // load instance data
-        {
-            numInstances = (int) iScale->size();
-            ef->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * numInstances, (GLfloat *) & (* iScale)[0], GL_DYNAMIC_DRAW);
+        // mesh buffers belong to the shape and are not deleted here
+        if (ctx == owner)
+            ef->glDeleteVertexArrays(1, &vaoConstraint);
+        //glDeleteBuffers(1, &iBuffer);
+        ef->glDeleteBuffers(1, &iTranslBuffer);
+        ef->glDeleteBuffers(1, &iScaleBuffer);
+        ef->glDeleteBuffers(1, &cBuffer);
+    }
+    vaoConstraint = 0;
+    //iBuffer = 0;
+    iTranslBuffer = 0;
+    iScaleBuffer = 0;
+    cBuffer = 0;
+    owner = nullptr;
+    meshVBO = meshIBO = 0;
+    numInstances = 0;
+    capacity = 0;
+}
 
-            bytesBound  += sizeof(glm::vec2) * numInstances;
-        }
-        else // create a single instance
-        {
-            numInstances = 1;
-            //std::vector<glm::mat4> tmpform;
-            //glm::mat4 idt = glm::mat4(1.0f);
-            //tmpform.push_back(idt);
-            glm::vec2 tmpform = {1.0, 1.0};
+void ShapeInstances::create()
+{
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
 
-            ef->glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * numInstances, (GLfloat *) &tmpform[0], GL_DYNAMIC_DRAW);
+    // vao, mesh attributes are set up when a mesh is attached
+    owner = QOpenGLContext::currentContext();
+    ef->glGenVertexArrays(1, &vaoConstraint);
+    ef->glBindVertexArray(vaoConstraint);
+
+    // instance buffers for translation, scaling (2 scales only) and colour variation
+    ef->glGenBuffers(1, &iTranslBuffer);
+    ef->glGenBuffers(1, &iScaleBuffer);
+    ef->glGenBuffers(1, &cBuffer);
+
+    // set up vert atributes and instancing step
+    ef->glBindBuffer(GL_ARRAY_BUFFER, iTranslBuffer);
+    ef->glEnableVertexAttribArray(3);
+    ef->glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (const GLvoid*)(0) );
+    ef->glVertexAttribDivisor(3, 1);
+
+    ef->glBindBuffer(GL_ARRAY_BUFFER, iScaleBuffer);
+    ef->glEnableVertexAttribArray(4);
+    ef->glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (const GLvoid*)(0));
+    ef->glVertexAttribDivisor(4, 1);
+
+    ef->glBindBuffer(GL_ARRAY_BUFFER, cBuffer);
+    ef->glEnableVertexAttribArray(5);
+    ef->glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)0); // stride may need adjusting here
+    ef->glVertexAttribDivisor(5, 1);
+
+    ef->glBindVertexArray(0);
+}
 
-            bytesBound += sizeof(glm::vec2) * numInstances;
-        }
+void ShapeInstances::attach(const ShapeMesh &mesh)
+{
+    // attribute pointers capture the buffer bound at the time, so are only re-specified for a different mesh
+    if (mesh.getVBO() == meshVBO && mesh.getIBO() == meshIBO)
+        return;
 
-        // set up vert atributes and instancing step
-        ef->glBindBuffer(GL_ARRAY_BUFFER, iTranslBuffer);
-        ef->glEnableVertexAttribArray(3);
-        ef->glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (const GLvoid*)(0) );
-        ef->glVertexAttribDivisor(3, 1);
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
 
-        ef->glBindBuffer(GL_ARRAY_BUFFER, iScaleBuffer);
-        ef->glEnableVertexAttribArray(4);
-        ef->glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (const GLvoid*)(0));
-        ef->glVertexAttribDivisor(4, 1);
+    ef->glBindVertexArray(vaoConstraint);
+    ef->glBindBuffer(GL_ARRAY_BUFFER, mesh.getVBO());
+    ef->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.getIBO()); // element buffer binding is part of the vao state
 
+    // enable position attribute
+    ef->glEnableVertexAttribArray(0);
+    ef->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void*)(0));
 
-        // we need a full mat4 because the plant dimensions (non-uniform scale) as well as position are being instanced
-        /*
-        glGenBuffers(1, &iBuffer); // create a vertex buffer object for plant transform instancing
-        glBindBuffer(GL_ARRAY_BUFFER, iBuffer);
-        if((int) iforms->size() > 0) // load instance data
-        {
-            numInstances = (int) iforms->size();
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * numInstances, (GLfloat *) & (* iforms)[0], GL_DYNAMIC_DRAW);
-        }
-        else // create a single instance
-        {
-            numInstances = 1;
-            std::vector<glm::mat4> tmpform;
-            glm::mat4 idt = glm::mat4(1.0f);
-            tmpform.push_back(idt);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * numInstances, (GLfloat *) &tmpform[0], GL_DYNAMIC_DRAW);
-        }
+    // enable texture coord attribute
+    const int sz = 3*sizeof(GLfloat);
+    ef->glEnableVertexAttribArray(1);
+    ef->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void*)(sz) );
 
-        glBindBuffer(GL_ARRAY_BUFFER, iBuffer);
-        for (unsigned int i = 0; i < 4 ; i++) {
-            glEnableVertexAttribArray(3 + i);
-            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-                                  (const GLvoid*)(sizeof(GLfloat) * i * 4));
-            glVertexAttribDivisor(3 + i, 1);
-        }
-        */
+    // enable normals
+    const int nz = 5*sizeof(GLfloat);
+    ef->glEnableVertexAttribArray(2);
+    ef->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat), (void*)(nz) );
 
-        ef->glGenBuffers(1, &cBuffer); // create a vertex buffer object for plant colour instancing
-        ef->glBindBuffer(GL_ARRAY_BUFFER, cBuffer);
-        // colour buffer to allow subtle variations in plant colour
-        if((int) icols->size() > 0)
-        {
-            numInstances = (int) icols->size();
-            ef->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * numInstances, (GLfloat *) & (* icols)[0], GL_DYNAMIC_DRAW);
+    ef->glBindVertexArray(0);
+    meshVBO = mesh.getVBO();
+    meshIBO = mesh.getIBO();
+}
 
-            bytesBound += sizeof(float) * numInstances;
-        }
-        else // a single colour instance, with no change to the underlying colour
-        {
-            numInstances = 1;
-            std::vector<float> tmpcol;
-            //glm::vec4 idt = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-            tmpcol.push_back(float(0.0));
-            ef->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * numInstances, (GLfloat *) &tmpcol[0], GL_DYNAMIC_DRAW);
+/// copy instance data into a buffer whose storage holds cap instances
+static void uploadInstances(QOpenGLExtraFunctions *ef, GLuint buffer, int cap, int count, std::size_t stride, const void * data)
+{
+    ef->glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    // respecify (orphan) the storage so that the driver need not wait on draws still reading the old contents
+    ef->glBufferData(GL_ARRAY_BUFFER, stride * cap, NULL, GL_DYNAMIC_DRAW);
+    ef->glBufferSubData(GL_ARRAY_BUFFER, 0, stride * count, data);
+}
 
-            bytesBound += sizeof(float) * numInstances;
-        }
+/// copy ranges [first, end) of instance data into a buffer, leaving the rest of its contents in place
+static void patchInstances(QOpenGLExtraFunctions *ef, GLuint buffer, const std::vector<std::pair<int, int>> &runs, std::size_t stride, const void * data)
+{
+    const char * bytes = (const char *) data;
 
-        ef->glBindBuffer(GL_ARRAY_BUFFER, cBuffer);
-        ef->glEnableVertexAttribArray(5);
-        ef->glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)0); // stride may need adjusting here
-        // glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (const GLvoid*)0);
-        ef->glVertexAttribDivisor(5, 1);
+    ef->glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for(auto &r: runs)
+        ef->glBufferSubData(GL_ARRAY_BUFFER, stride * r.first, stride * (r.second - r.first), bytes + stride * r.first);
+}
 
-        ef->glBindVertexArray(0);
+bool ShapeInstances::bind(const ShapeMesh &mesh, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols)
+{
+    if(mesh.getVBO() != 0 && ((int) iTransl->size() == (int) icols->size()))
+    {
+        QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+
+        // GL objects are created once and then reused by every subsequent bind
+        if (vaoConstraint == 0)
+            create();
+        attach(mesh);
+
+        // an empty list is drawn as a single instance with identity transformation and unchanged colour
+        glm::vec3 idtransl = {0.0, 0.0, 0.0};
+        glm::vec2 idscale = {1.0, 1.0};
+        float idcol = 0.0f;
+        int ntransl = (int) iTransl->size(), nscale = (int) iScale->size(), ncol = (int) icols->size();
+        const void * transl = (ntransl > 0 ? (const void *) iTransl->data() : (const void *) &idtransl);
+        const void * scale = (nscale > 0 ? (const void *) iScale->data() : (const void *) &idscale);
+        const void * col = (ncol > 0 ? (const void *) icols->data() : (const void *) &idcol);
+        ntransl = std::max(1, ntransl); nscale = std::max(1, nscale); ncol = std::max(1, ncol);
+        numInstances = std::min(ntransl, std::min(nscale, ncol));
+
+        // grow geometrically so that repeated binds with slowly increasing counts do not reallocate each time
+        int needed = std::max(ntransl, std::max(nscale, ncol));
+        if (needed > capacity)
+            capacity = std::max(needed, std::max(2 * capacity, minInstanceCapacity));
+
+        uploadInstances(ef, iTranslBuffer, capacity, ntransl, sizeof(glm::vec3), transl);
+        uploadInstances(ef, iScaleBuffer, capacity, nscale, sizeof(glm::vec2), scale);
+        uploadInstances(ef, cBuffer, capacity, ncol, sizeof(float), col);
+        ef->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         return true;
     }
@@ -1246,6 +1305,39 @@ bool Shape::bindInstances(std::vector<glm::vec3> * iTransl, std::vector<glm::vec
         // cerr << "indices = " << (int) indices.size() << " iforms = " << (int) iforms->size() << " icols = " << (int) icols->size() << endl;
         return false;
     }
+}
+
+bool ShapeInstances::update(const ShapeMesh &mesh, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols,
+                            const std::vector<std::pair<int, int>> &runs)
+{
+    int count = (int) iTransl->size();
+
+    if(mesh.getVBO() == 0 || count != (int) iScale->size() || count != (int) icols->size())
+        return false;
+
+    // unlike bind, an empty list draws nothing
+    if(count == 0)
+    {
+        numInstances = 0;
+        return true;
+    }
+
+    int changed = 0;
+    for(auto &r: runs)
+        changed += r.second - r.first;
+
+    // growth needs new storage anyway, and a single orphaning upload beats patching most of the buffer
+    if (vaoConstraint == 0 || count > capacity || 2 * changed > count)
+        return bind(mesh, iTransl, iScale, icols);
+
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
 
+    attach(mesh);
+    patchInstances(ef, iTranslBuffer, runs, sizeof(glm::vec3), iTransl->data());
+    patchInstances(ef, iScaleBuffer, runs, sizeof(glm::vec2), iScale->data());
+    patchInstances(ef, cBuffer, runs, sizeof(float), icols->data());
+    ef->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    numInstances = count;
 
+    return true;
 }
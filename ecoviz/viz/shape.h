@@ -41,19 +41,115 @@ struct ShapeDrawData
     bool   current;         // set to true if this is part of current manipulator, controls alpha transparency on rendering
 };
 
-class Shape: protected QOpenGLExtraFunctions
+/// OpenGL vertex and index buffers for a mesh. Buffer objects are shared between all contexts in the application's
+/// share group, so a mesh is uploaded once no matter how many views draw it.
+class ShapeMesh
 {
 private:
-    std::vector<float> verts;   //< vertex, texture and normal data
-    GLuint vaoConstraint;       //< openGL handles for various buffers
-    GLuint vboConstraint;
-    GLuint iboConstraint;
+    GLuint vbo, ibo;                    //< openGL handles for vertex and index buffers
+    long revision;                      //< geometry revision of the mesh currently on the GPU, -1 if none
+
+public:
+
+    ShapeMesh(){ vbo = ibo = 0; revision = -1; }
+
+    /**
+     * Upload a mesh, unless the buffers already hold this revision of it. Requires a current context.
+     * @param meshVerts     mesh vertices (position, texture coordinate, normal)
+     * @param meshIndices   mesh triangle indices
+     * @param meshRevision  revision stamp of the geometry, renewed by its owner whenever the geometry changes
+     */
+    void upload(const std::vector<float> &meshVerts, const std::vector<unsigned int> &meshIndices, long meshRevision);
+
+    /// delete the buffers, using whichever context in the share group is current. With no current context the
+    /// handles are dropped, leaving the buffers to be freed with the share group.
+    void release();
+
+    GLuint getVBO() const { return vbo; }
+    GLuint getIBO() const { return ibo; }
+};
+
+/// OpenGL buffers for drawing instances of some mesh. The mesh itself lives in a Shape, so that several instance
+/// sets (one per view, say) can draw the same geometry without the geometry being duplicated. The vertex array
+/// object is specific to the context that created it, whereas the buffers it refers to are shared.
+class ShapeInstances
+{
+private:
+    GLuint vaoConstraint;       //< openGL handle for the vertex array object
+    GLuint meshVBO, meshIBO;    //< mesh buffers currently attached to the vertex array object
     // GLuint iBuffer;             //< handles for the transform instance buffer
     GLuint iTranslBuffer;
     GLuint iScaleBuffer;
     GLuint cBuffer;             //< handle for the colour variation instance buffer
-    GLfloat diffuse[4], ambient[4], specular[4]; // material properties
     int numInstances;
+    int capacity;               //< number of instances the instance buffers can hold without reallocation
+    QOpenGLContext * owner;     //< context that created the vertex array object, which is not shared
+
+    /// generate the vertex array and instance buffer objects and set up instance attributes, requires a current context
+    void create();
+
+    /// point the vertex array object at a mesh, unless it already refers to it
+    void attach(const ShapeMesh &mesh);
+
+public:
+
+    ShapeInstances()
+    {
+        vaoConstraint = meshVBO = meshIBO = 0;
+        iTranslBuffer = iScaleBuffer = cBuffer = 0;
+        numInstances = 0;
+        capacity = 0;
+        owner = nullptr;
+    }
+
+    /// delete any buffers held. The instance buffers go with any current context in the share group, whereas the
+    /// vertex array object is only deleted if the context that created it is current, and otherwise goes with that context.
+    void release();
+
+    /// draw no instances, while keeping the buffers
+    void removeAllInstances(){ numInstances = 0; }
+
+    /// vertex array object for draw calls, 0 if nothing has been bound
+    GLuint getVAO() const { return vaoConstraint; }
+
+    /// number of instances currently bound
+    int getNumInstances() const { return numInstances; }
+
+    /**
+     * Attach a mesh and upload instance data. Buffers persist between calls: the mesh is only re-attached when it
+     * changes and instance storage grows geometrically, so repeated binds only copy instance data.
+     * An empty instance list results in a single instance with identity transformation.
+     * @param mesh      uploaded mesh buffers
+     * @param iTransl   translation applied to each instance
+     * @param iScale    scaling (base, height) applied to each instance
+     * @param icols     colour offset applied to each instance in the shader
+     * @retval @c true if buffers successfully bound
+     */
+    bool bind(const ShapeMesh &mesh, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols);
+
+    /**
+     * Overwrite ranges of previously bound instance data, leaving the rest of the buffers as they are. Falls back
+     * to a full bind if the buffers cannot hold every instance or if most instances are covered by the ranges.
+     * @param mesh      uploaded mesh buffers
+     * @param iTransl   translation applied to each instance, the complete list
+     * @param iScale    scaling (base, height) applied to each instance, the complete list
+     * @param icols     colour offset applied to each instance in the shader, the complete list
+     * @param runs      ranges [first, end) of instances that differ from those uploaded, in increasing order.
+     *                  Instances beyond the previous count must be covered.
+     * @retval @c true if buffers successfully updated
+     */
+    bool update(const ShapeMesh &mesh, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols,
+                const std::vector<std::pair<int, int>> &runs);
+};
+
+class Shape: protected QOpenGLExtraFunctions
+{
+private:
+    std::vector<float> verts;   //< vertex, texture and normal data
+    ShapeMesh mesh;             //< openGL buffers for the geometry, shared by all instance sets
+    ShapeInstances inst;        //< openGL buffers for the default instance set
+    long geomRev;               //< revision of verts and indices, renewed whenever they change
+    GLfloat diffuse[4], ambient[4], specular[4]; // material properties
 
     /**
      * Create a sphere vertex at specified integer latitude and longitude with a transformation matrix applied and append to existing geometry
@@ -73,46 +169,46 @@ private:
      */
     void genHemisphereVert(float radius, float lat, float lon, glm::mat4x4 trm);
 
+    /// give the geometry a fresh revision, so that the mesh buffers are refilled on the next bind
+    void touchGeometry();
+
 public:
 
     std::vector<unsigned int> indices;   // vertex indices for triangles
 
     Shape()
     {
-        vaoConstraint = 0;
-        vboConstraint = 0;
-        iboConstraint = 0;
-
         // default colour
         diffuse[0] = 0.325f; diffuse[1] = 0.235f; diffuse[3] = diffuse[2] = 1.0f;
-        numInstances = 1;
+        touchGeometry();
+    }
+
+    // copy construction - only geometry and other data is copied, the new shape holds no buffers
+    Shape(const Shape & old) : Shape()
+    {
+        *this = old;
     }
 
+    // buffers are deleted if a context is current, as when a shape built for a single paint goes out of scope
     ~Shape()
     {
-        clear();
+        release();
     }
 
     // copy assignment - no buffers are bound, only geometry and other data is copied
-    // (this is therefore not a true copy assignment....but suitable for our special use case)
+    // (this is therefore not a true copy assignment....but suitable for our special use case).
+    // Mesh and instance buffers already held are kept and refilled with the new geometry on the next bind.
 
     Shape& operator=(const Shape & old)
     {
         if (this != &old)
         {
             clear();
-            numInstances = 0;
 
             verts = old.verts;
             indices = old.indices;
-            vaoConstraint = 0;
-            vboConstraint = 0;
-            iboConstraint = 0;
-            // iBuffer = 0;
-            iTranslBuffer = 0;
-            iScaleBuffer = 0;
-            cBuffer = 0;
-            numInstances = old.numInstances;
+            touchGeometry();
+            inst.removeAllInstances();
 
             for (std::size_t i = 0; i < 4; ++i)
             {
@@ -129,11 +225,19 @@ public:
     {
         verts.clear();
         indices.clear();
+        touchGeometry();
     }
 
     void removeAllInstances()
     {
-        numInstances = 0;
+        inst.removeAllInstances();
+    }
+
+    /// delete the mesh and default instance buffers, see ShapeMesh::release and ShapeInstances::release
+    void release()
+    {
+        inst.release();
+        mesh.release();
     }
 
 
@@ -253,6 +357,12 @@ public:
      */
     ShapeDrawData getDrawParameters();
 
+    /**
+     * Return data required to draw this shape's material with a separately bound instance set
+     * @param instances instance buffers created by bindInstances(instances, ...)
+     */
+    ShapeDrawData getDrawParameters(const ShapeInstances &instances);
+
     /**
      * Bind the appropriate OpenGL buffers for rendering instances. Only needs to be done if
      * the instances attributes change.
@@ -263,6 +373,28 @@ public:
      */
     // bool bindInstances(std::vector<glm::mat4> * iforms, std::vector<glm::vec4> * icols);
     bool bindInstances(std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols);
+
+    /**
+     * Bind this shape's geometry together with instance attributes into an external instance set
+     * @param instances destination buffers
+     * @param iTransl   translation applied to each instance
+     * @param iScale    scaling applied (first) to each instance
+     * @param icols     scale colour offset applied to each instance in shader
+     * @retval @c true if buffers successfully bound
+     */
+    bool bindInstances(ShapeInstances &instances, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols);
+
+    /**
+     * As bindInstances, but only copies the given ranges of instances, see ShapeInstances::update
+     * @param instances destination buffers, previously bound to this shape
+     * @param iTransl   translation applied to each instance
+     * @param iScale    scaling applied (first) to each instance
+     * @param icols     scale colour offset applied to each instance in shader
+     * @param runs      ranges [first, end) of instances that have changed
+     * @retval @c true if buffers successfully updated
+     */
+    bool updateInstances(ShapeInstances &instances, std::vector<glm::vec3> * iTransl, std::vector<glm::vec2> * iScale, std::vector<float> * icols,
+                         const std::vector<std::pair<int, int>> &runs);
 };
 
 #endif
@@ -92,19 +92,20 @@ void screenProject(View * view, std::vector<vpPoint> * from, std::vector<vpPoint
 
 void drapeProject(std::vector<vpPoint> * from, std::vector<vpPoint> * to, Terrain * ter)
 {
-    int i;
-    std::vector<vpPoint> copy;
-    vpPoint dpnt;
+    int i, n = (int) from->size();
+    std::vector<float> wx(n), wz(n), h(n);
 
-    // drape onto the landscape
-    for(i = 0; i < (int) from->size(); i++)
+    // drape onto the landscape in a single query, points beyond the edge taking the height at the edge
+    for(i = 0; i < n; i++)
     {
-        ter->drapePnt((* from)[i], dpnt);
-        copy.push_back(dpnt);           // add draped point to list
+        wx[i] = (* from)[i].x;
+        wz[i] = (* from)[i].z;
     }
-    to->clear();
-    (* to) = copy;
-    copy.clear();
+    ter->drapeHeights(n, wx.data(), wz.data(), h.data());
+
+    to->resize(n);
+    for(i = 0; i < n; i++)
+        (* to)[i] = vpPoint(wx[i], h[i], wz[i]);
 }
 
 void dropProject(std::vector<vpPoint> * from, std::vector<vpPoint> * to)
@@ -24,6 +24,7 @@
 // date: 17 December 2012
 
 #include "terrain.h"
+#include "common/horizon.h"
 #include <sstream>
 #include <streambuf>
 #include <stdio.h>
@@ -31,9 +32,15 @@
 #include <iostream>
 #include <fstream>
 #include <utility>
+#include <limits>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
+long Terrain::idCounter = 0;
+
 bool Terrain::inGridBounds(int x, int y)
 {
     int gx, gy;
@@ -112,9 +119,10 @@ vpPoint Terrain::toWorld(int x, int y, float h) const
 
 float Terrain::getHeightFromReal(float x, float y)
 {
-    int gx, gy;
-    toGrid(vpPoint(x, 0, y), gx, gy);
-    return grid->get(gx,gy);
+    float h;
+
+    drapeHeights(1, &y, &x, &h);
+    return h;
 }
 
 float Terrain::toWorld(float gdist) const
@@ -142,49 +150,42 @@ bool Terrain::inSynthBounds(vpPoint p) const
 
 void Terrain::init(int dx, int dy, float sx, float sy)
 {
-    grid->setDim(dx, dy);
-    drawgrid->setDim(dy, dx);
+    // new storage rather than resizing in place, since sub-terrains may still be viewing the old heights
+    heightStore = std::make_shared<basic_types::MapFloat>();
+    heightStore->setDim(dy, dx);
+    grid = HeightView(heightStore);
+    initState(sx, sy);
+}
+
+void Terrain::initState(float sx, float sy)
+{
+    int dx, dy;
+
+    getGridDim(dx, dy);
     setTerrainDim(sx, sy);
-    setFocus(vpPoint(sy/2.0f, grid->get(dx/2-1,dy/2-1), sx/2.0f));
+    setFocus(vpPoint(sy/2.0f, (dx > 0 && dy > 0 ? grid.get(std::max(dx/2-1, 0), std::max(dy/2-1, 0)) : 0.0f), sx/2.0f));
     scfac = 1.0f;
-
-    // init accel structure
-    spherestep = 8;
-    numspx = (grid->height()-1) / spherestep + 1; numspy = (grid->width()-1) / spherestep + 1; // JG mod
-    for(int i = 0; i < numspx; i++)
-    {
-        std::vector<AccelSphere> sphrow;
-        for(int j = 0; j < numspy; j++)
-        {
-            AccelSphere sph;
-            sphrow.push_back(sph);
-        }
-        boundspheres.push_back(sphrow);
-    }
+    packed.clear();
 
     bufferState = BufferState::REALLOCATE;
     accelValid = false;
+    derivedValid = false;
     scaleOn = false;
 }
 
 void Terrain::initGrid(int dx, int dy, float sx, float sy)
 {
     init(dx, dy, sx, sy);
-    grid->fill(0.0f);
-    drawgrid->fill(0.0f);
+    heightStore->fill(0.0f);
 }
 
 void Terrain::delGrid()
 {
-    if(boundspheres.size() > 0)
-    {
-        for(int i = 0; i < (int) boundspheres.size(); i++)
-            boundspheres[i].clear();
-        boundspheres.clear();
-    }
+    accel.clear();
 
     bufferState = BufferState::REALLOCATE;
     accelValid = false;
+    derivedValid = false;
 }
 
 // PCM ----
@@ -195,14 +196,15 @@ void Terrain::delGrid()
  {
     int dx = x1-x0+1;
     int dy = y1-y0+1;
-    float val;
 
     assert(dx > 0);
     assert(dy > 0);
 
     std::unique_ptr<Terrain> newTerrain(new Terrain(Region(x0,y0,x1,y1)) );
 
-    newTerrain->init(dx, dy, (float) (dx-1) * step, (float) (dy-1) * step);
+    // view this terrain's heights in place, rather than copying them
+    newTerrain->grid = grid.block(x0, y0, dx, dy);
+    newTerrain->initState((float) (dx-1) * step, (float) (dy-1) * step);
     newTerrain->step = step;
     newTerrain->scfac = scfac;
     newTerrain->scaleOn = scaleOn;
@@ -213,20 +215,14 @@ void Terrain::delGrid()
     newTerrain->locx = locx; newTerrain->locy = locy;
     // other state that may have changed since init()?
 
-    // copy data
-    for (int x = 0; x < dx; x++)
-    {
-        for (int y = 0; y < dy; y++)
-        {
-            val  = grid->get(x0+x,y0+y);
-
-            newTerrain->grid->set(x,y, val);
-            newTerrain->drawgrid->set(y,x, val);
-        }
-    }
-
     newTerrain->calcMeanHeight();
 
+    // the sub-grid cells are a block of this terrain's cells, so their bounds can be copied across
+    if(!accelValid)
+        buildAccel();
+    newTerrain->accel.buildFrom(accel, x0, y0, dx, dy);
+    newTerrain->accelValid = !newTerrain->accel.isEmpty();
+
     return newTerrain;
  }
 
@@ -240,7 +236,7 @@ void Terrain::setMidFocus()
     getGridDim(dx, dy);
     getTerrainDim(sx, sy);
     if(dx > 0 && dy > 0)
-        setFocus(vpPoint(sy/2.0f, grid->get(dx/2-1,dy/2-1), sx/2.0f));
+        setFocus(vpPoint(sy/2.0f, grid.get(dx/2-1,dy/2-1), sx/2.0f));
     else
         setFocus(vpPoint(0.0f, 0.0f, 0.0f));
 }
@@ -253,23 +249,23 @@ void Terrain::getMidPoint(vpPoint & mid)
     getGridDim(dx, dy);
     getTerrainDim(sx, sy);
     if(dx > 0 && dy > 0)
-        // mid = vpPoint(sx/2.0f, grid->get(dy/2-1,dx/2-1), sy/2.0f);
-        //mid = vpPoint(sy/2.0f, grid->get(dy/2-1,dx/2-1), sx/2.0f);
-        mid = vpPoint(sy/2.0f, grid->get(dx/2-1,dy/2-1), sx/2.0f); // PCM: not sure *why* - seems to be flipped grid?
+        // mid = vpPoint(sx/2.0f, grid.get(dy/2-1,dx/2-1), sy/2.0f);
+        //mid = vpPoint(sy/2.0f, grid.get(dy/2-1,dx/2-1), sx/2.0f);
+        mid = vpPoint(sy/2.0f, grid.get(dx/2-1,dy/2-1), sx/2.0f); // PCM: not sure *why* - seems to be flipped grid?
     else
         mid = vpPoint(0.0f, 0.0f, 0.0f);
 }
 
 void Terrain::getGridDim(int & dx, int & dy) const
 {
-    dx = grid->width();
-    dy = grid->height();
+    dx = grid.width();
+    dy = grid.height();
 }
 
 void Terrain::getGridDim(uint & dx, uint & dy)
 {
-    dx = (uint) grid->width();
-    dy = (uint) grid->height();
+    dx = (uint) grid.width();
+    dy = (uint) grid.height();
 }
 
 void Terrain::getTerrainDim(float &tx, float &ty) const
@@ -317,7 +313,7 @@ float Terrain::longEdgeDist()
 
 float Terrain::getHeight(int x, int y)
 {
-    return grid->get(x,y);
+    return grid.get(x,y);
 }
 
 float Terrain::getFlatHeight(int idx)
@@ -327,48 +323,105 @@ float Terrain::getFlatHeight(int idx)
 
     x = idx % dx;
     y = idx / dx;
-    return grid->get(x,y);
+    return grid.get(x,y);
 }
 
-void Terrain::getNormal(int x, int y, Vector & norm)
+/// world-space height gradient at grid position (x, y) from central differences, one sided on the border,
+/// and optionally the Laplacian of height from the same neighbours
+static inline void heightGradient(const HeightView & grid, int x, int y, float cx, float cz, float & dhdx, float & dhdz,
+                                  float * laplacian = nullptr)
 {
-    vpPoint x1, x2, y1, y2;
-    int dx, dy;
-    Vector dfdx, dfdy;
-
-    getGridDim(dx, dy);
+    const int gx = grid.width(), gy = grid.height();
+    const int xm = std::max(x-1, 0), xp = std::min(x+1, gx-1);
+    const int ym = std::max(y-1, 0), yp = std::min(y+1, gy-1);
+    const float * run = grid.run(x);
+    const float hxm = grid.get(xm, y), hxp = grid.get(xp, y);
+
+    dhdx = (hxp - hxm) / (cx * (float) (xp - xm));
+    dhdz = (run[yp] - run[ym]) / (cz * (float) (yp - ym));
+    if(laplacian != nullptr)
+    {
+        const float h = run[y];
+        (* laplacian) = (hxp - 2.0f * h + hxm) / (cx * cx) + (run[yp] - 2.0f * h + run[ym]) / (cz * cz);
+    }
+}
 
-    // x-positions
-    if(x > 0)
-        x1 = toWorld(x-1, y, getHeight(x-1, y));
-    else
-        x1 = toWorld(x, y, getHeight(x, y));
+void Terrain::getNormal(int x, int y, Vector & norm)
+{
+    int gx, gy;
+    float tx, ty, dhdx, dhdz;
 
-    if(x < dx-1)
-        x2 = toWorld(x+1, y, getHeight(x+1, y));
-    else
-        x2 = toWorld(x, y, getHeight(x, y));
+    if(derivedValid)
+    {
+        norm = Vector(derived.nx.get(x, y), derived.ny.get(x, y), derived.nz.get(x, y));
+        return;
+    }
 
-    // y-positions
-    if(y > 0)
-        y1 = toWorld(x, y-1, getHeight(x, y-1));
-    else
-        y1 = toWorld(x, y, getHeight(x, y));
+    getGridDim(gx, gy);
+    getTerrainDim(tx, ty);
+    if(gx < 2 || gy < 2)
+    {
+        norm = Vector(0.0f, 1.0f, 0.0f);
+        return;
+    }
+    heightGradient(grid, x, y, tx / (float) (gx-1), ty / (float) (gy-1), dhdx, dhdz);
+    float grad = sqrtf(dhdx * dhdx + dhdz * dhdz);
+    float len = 1.0f / sqrtf(1.0f + grad * grad);
+    norm = Vector(-dhdx * len, len, -dhdz * len);
+}
 
-    if(y < dy-1)
-        y2 = toWorld(x, y+1, getHeight(x, y+1));
-    else
-        y2 = toWorld(x, y, getHeight(x, y));
+const TerrainDerivatives & Terrain::getDerivedMaps()
+{
+    if(!derivedValid)
+        buildDerived();
+    return derived;
+}
 
-    // cross pattern
-    dfdx.diff(x1, x2);
-    dfdy.diff(y1, y2);
-    dfdx.normalize();
-    dfdy.normalize();
+void Terrain::buildDerived()
+{
+    int gx, gy;
+    float tx, ty;
 
-    norm.cross(dfdx, dfdy);
-    norm.mult(-1.0f); // JGBUG - may be wrong direction
-    norm.normalize();
+    getGridDim(gx, gy);
+    getTerrainDim(tx, ty);
+    for(basic_types::MapFloat * m: {&derived.nx, &derived.ny, &derived.nz, &derived.slope, &derived.aspect, &derived.curvature})
+        if(m->width() != gx || m->height() != gy)
+            m->setDim(gx, gy);
+    derivedValid = true;
+    if(gx < 2 || gy < 2)
+        return;
+
+    // grid x maps to world x and grid y to world z, as in toWorld
+    const float cx = tx / (float) (gx-1), cz = ty / (float) (gy-1);
+    float * nx = derived.nx.getPtr(), * ny = derived.ny.getPtr(), * nz = derived.nz.getPtr();
+    float * slope = derived.slope.getPtr(), * aspect = derived.aspect.getPtr(), * curv = derived.curvature.getPtr();
+    const float rad2deg = 180.0f / (float) M_PI;
+
+    // blocks of runs at a time, as in HeightView::copyRowMajor, so that the heights are read along their runs
+    // while the row major maps are written a short stretch of each row at a time
+    const int tile = 32;
+    #pragma omp parallel for
+    for(int x0 = 0; x0 < gx; x0 += tile)
+    {
+        const int x1 = std::min(x0 + tile, gx);
+        for(int y = 0; y < gy; y++)
+        {
+            long base = (long) y * gx;
+            for(int x = x0; x < x1; x++)
+            {
+                float dhdx, dhdz, lap;
+                heightGradient(grid, x, y, cx, cz, dhdx, dhdz, &lap);
+                float grad = sqrtf(dhdx * dhdx + dhdz * dhdz);
+                float len = 1.0f / sqrtf(1.0f + grad * grad);
+                float a = atan2f(-dhdz, -dhdx) * rad2deg;
+
+                nx[base+x] = -dhdx * len; ny[base+x] = len; nz[base+x] = -dhdz * len;
+                slope[base+x] = atanf(grad) * rad2deg;
+                aspect[base+x] = (a < 0.0f ? a + 360.0f : a);
+                curv[base+x] = lap;
+            }
+        }
+    }
 }
 
 float Terrain::getTerrainHectArea()
@@ -383,28 +436,36 @@ float Terrain::getTerrainHectArea()
 
 float Terrain::getCellExtent()
 {
-    return dimx / (float) grid->width();
+    return dimx / (float) grid.width();
 }
 
 void Terrain::updateBuffers(PMrender::TRenderer * renderer)
 {
-    const int width = grid->width();
-    const int height = grid->height();
+    const int width = grid.width();
+    const int height = grid.height();
     float scx, scy;
 
     getTerrainDim(scx, scy);
 
+    // a new revision tells every renderer, not just this one, that the heightmap must be refreshed
     if (bufferState == BufferState::REALLOCATE || bufferState == BufferState::DIRTY )
+        heightRevision++;
+
+    // the texture takes one run of heights per grid x, which is the storage order, so only a sub-terrain whose
+    // runs are spaced out in its parent's storage needs packing, and only when its heights change
+    const float * data = grid.run(0);
+    if (!grid.contiguous())
     {
-        // renderer->updateHeightMap(width, height, scx, scy, drawgrid->getPtr(), true);
-        renderer->updateHeightMap(height, width, scy, scx, drawgrid->getPtr(), true);
-    }
-    else
-    {
-        // renderer->updateHeightMap(width, height, scx, scy, drawgrid->getPtr());
-        renderer->updateHeightMap(height, width, scy, scx, drawgrid->getPtr());
+        if (bufferState != BufferState::CLEAN || packed.size() != (size_t) width * height)
+        {
+            packed.resize((size_t) width * height);
+            grid.copyRuns(packed.data());
+        }
+        data = packed.data();
     }
 
+    renderer->updateHeightMap(height, width, scy, scx, data, heightmap, heightRevision);
+
     bufferState = BufferState::CLEAN;
 }
 
@@ -416,89 +477,300 @@ void Terrain::draw(View * view, PMrender::TRenderer *renderer)
     renderer->draw(view);
 }
 
-void Terrain::buildSphereAccel()
+void Terrain::buildAccel()
 {
-    int si, sj, i, j, imin, imax, jmin, jmax;
-    float rad, sqlen;
-    vpPoint p, c, b1, b2;
-    Vector del;
-
-    // cerr << "numspx = " << numspx << ", numspy = " << numspy << endl;
-    for(si = 0; si < numspx; si++)
-        for(sj = 0; sj < numspy; sj++)
-        {
-            imin = si*spherestep; imax = std::min(imin+spherestep, grid->height());
-            jmin = sj*spherestep; jmax = std::min(jmin+spherestep, grid->width());
-            // cerr << "(" << si << ", " << sj << ") = " << "i: " << imin << " - " << imax << " j: " << jmin << " - " << jmax << endl;
-
-            // center point
-            b1 = toWorld(imin, jmin, grid->get(jmin, imin));
-            b2 = toWorld(imax, jmax, grid->get(jmax-1, imax-1));
-            c.affinecombine(0.5f, b1, 0.5f, b2);
-
-            // update radius
-            rad = 0.0f;
-            for(j = jmin; j < jmax; j++)
-                for(i = imin; i < imax; i++)
-                {
-                    p = toWorld(i, j, grid->get(j,i));
-                    del.diff(c, p);
-                    sqlen = del.sqrdlength();
-                    if(sqlen > rad)
-                        rad = sqlen;
-                }
-            boundspheres[si][sj].center = c;
-            boundspheres[si][sj].radius = sqrtf(rad);
-        }
+    accel.build(grid);
     accelValid = true;
 }
 
 bool Terrain::rayIntersect(vpPoint start, Vector dirn, vpPoint & p)
 {
-    int i, j, si, sj, imin, imax, jmin, jmax;
-    vpPoint currp;
-    float besttval, tval, dist;
-    bool found = false;
-    float tol = dimx / (float) (grid->width()-1); // set world space detection tolerance to approx half gap between grid points
-
-    besttval = 100000000.0f;
+    int gx, gy;
+    float tx, ty, convx, convy, t;
 
     if(!accelValid)
-        buildSphereAccel();
+        buildAccel();
 
-    // bounding sphere accel structure
-    for(si = 0; si < numspx; si++)
-        for(sj = 0; sj < numspy; sj++)
-        {
-            rayPointDist(start, dirn, boundspheres[si][sj].center, tval, dist);
-            if(dist <= boundspheres[si][sj].radius) // intersects enclosing sphere so test enclosed points
+    // world x runs down the grid rows and world z along them, see toWorld
+    getGridDim(gx, gy);
+    getTerrainDim(tx, ty);
+    convx = (float) (gx-1) / tx;
+    convy = (float) (gy-1) / ty;
+    float o[3] = {start.z * convy, start.x * convx, start.y};
+    float d[3] = {dirn.k * convy, dirn.i * convx, dirn.j};
+
+    if(!accel.intersect(grid, o, d, t))
+        return false;
+    p = vpPoint(start.x + t * dirn.i, start.y + t * dirn.j, start.z + t * dirn.k);
+    return true;
+}
+
+HeightView::HeightView(std::shared_ptr<const basic_types::MapFloat> store) : store(store)
+{
+    gy = store->width(); gx = store->height();
+    stride = gy;
+    base = (gx > 0 && gy > 0 ? store->getPtr() : nullptr);
+}
+
+HeightView HeightView::block(int x0, int y0, int dx, int dy) const
+{
+    assert(x0 >= 0 && y0 >= 0 && dx > 0 && dy > 0 && x0+dx <= gx && y0+dy <= gy);
+
+    HeightView sub(*this);
+    sub.base = run(x0) + y0;
+    sub.gx = dx; sub.gy = dy;
+    return sub;
+}
+
+void HeightView::copyRuns(float * dst) const
+{
+    for(int x = 0; x < gx; x++)
+        memcpy(dst + (long) x * gy, run(x), sizeof(float) * gy);
+}
+
+void HeightView::copyRowMajor(float * dst) const
+{
+    // blocks of runs at a time, so that both reads and writes stay within a few cache lines
+    const int tile = 32;
+    #pragma omp parallel for
+    for(int x0 = 0; x0 < gx; x0 += tile)
+        for(int y = 0; y < gy; y++)
+            for(int x = x0; x < std::min(x0 + tile, gx); x++)
+                dst[(long) y * gx + x] = get(x, y);
+}
+
+bool HeightPyramid::allocate(int cw, int ch)
+{
+    std::vector<std::pair<int, int>> dims;
+
+    dims.push_back(std::make_pair(cw, ch));
+    while(cw > 1 || ch > 1)
+    {
+        cw = (cw+1) / 2; ch = (ch+1) / 2;
+        dims.push_back(std::make_pair(cw, ch));
+    }
+
+    bool same = (dims.size() == levels.size());
+    for(int l = 0; same && l < (int) dims.size(); l++)
+        same = (levels[l].wd == dims[l].first && levels[l].ht == dims[l].second);
+    if(same)
+        return false;
+
+    levels.resize(dims.size());
+    for(int l = 0; l < (int) dims.size(); l++)
+    {
+        levels[l].wd = dims[l].first; levels[l].ht = dims[l].second;
+        levels[l].lo.assign(dims[l].first * dims[l].second, 0.0f);
+        levels[l].hi.assign(dims[l].first * dims[l].second, 0.0f);
+    }
+    return true;
+}
+
+void HeightPyramid::reduce()
+{
+    for(int l = 1; l < (int) levels.size(); l++)
+    {
+        const Level & src = levels[l-1];
+        Level & dst = levels[l];
+        for(int y = 0; y < dst.ht; y++)
+            for(int x = 0; x < dst.wd; x++)
             {
-                imin = si*spherestep; imax = std::min(imin+spherestep, grid->height());
-                jmin = sj*spherestep; jmax = std::min(jmin+spherestep, grid->width());
-                // check ray against grid points
-                for(j = jmin; j < jmax; j++)
-                    for(i = imin; i < imax; i++)
+                float lo = std::numeric_limits<float>::max();
+                float hi = std::numeric_limits<float>::lowest();
+                for(int sy = 2*y; sy < std::min(2*y+2, src.ht); sy++)
+                    for(int sx = 2*x; sx < std::min(2*x+2, src.wd); sx++)
                     {
-                        currp = toWorld(i, j, grid->get(j,i));
-                        rayPointDist(start, dirn, currp, tval, dist);
-                        if(dist < tol)
-                        {
-                            found = true;
-                            if(tval < besttval)
-                            {
-                                besttval = tval;
-                                p = currp;
-                            }
-                        }
+                        lo = std::min(lo, src.lo[sy*src.wd+sx]);
+                        hi = std::max(hi, src.hi[sy*src.wd+sx]);
                     }
+                dst.lo[y*dst.wd+x] = lo;
+                dst.hi[y*dst.wd+x] = hi;
+            }
+    }
+}
 
+void HeightPyramid::build(const HeightView & grid)
+{
+    int cw = grid.width()-1, ch = grid.height()-1;
+
+    if(cw < 1 || ch < 1)
+    {
+        clear();
+        return;
+    }
+    allocate(cw, ch);
+
+    // level 0 is row major whereas the heights are stored in runs along y, so work through blocks of runs
+    Level & base = levels[0];
+    const int tile = 32;
+    #pragma omp parallel for
+    for(int x0 = 0; x0 < cw; x0 += tile)
+        for(int y = 0; y < ch; y++)
+            for(int x = x0; x < std::min(x0 + tile, cw); x++)
+            {
+                const float * r0 = grid.run(x), * r1 = grid.run(x+1);
+                float h00 = r0[y], h10 = r1[y], h01 = r0[y+1], h11 = r1[y+1];
+                base.lo[y*cw+x] = std::min(std::min(h00, h10), std::min(h01, h11));
+                base.hi[y*cw+x] = std::max(std::max(h00, h10), std::max(h01, h11));
             }
+    reduce();
+}
+
+void HeightPyramid::buildFrom(const HeightPyramid & parent, int x0, int y0, int dx, int dy)
+{
+    int cw = dx-1, ch = dy-1;
+
+    if(cw < 1 || ch < 1 || parent.levels.empty())
+    {
+        clear();
+        return;
+    }
+    allocate(cw, ch);
+
+    const Level & src = parent.levels[0];
+    Level & base = levels[0];
+    for(int y = 0; y < ch; y++)
+    {
+        std::copy_n(src.lo.begin() + ((y0+y)*src.wd + x0), cw, base.lo.begin() + y*cw);
+        std::copy_n(src.hi.begin() + ((y0+y)*src.wd + x0), cw, base.hi.begin() + y*cw);
+    }
+    reduce();
+}
 
+bool HeightPyramid::nodeRange(int level, int x, int y, const float o[3], const float d[3], float & tin, float & tout) const
+{
+    const Level & lev = levels[level];
+    int cw = levels[0].wd, ch = levels[0].ht;
+    float lo[3], hi[3];
+
+    // node bounds in grid coordinates
+    lo[0] = (float) (x << level); hi[0] = (float) std::min((x+1) << level, cw);
+    lo[1] = (float) (y << level); hi[1] = (float) std::min((y+1) << level, ch);
+    lo[2] = lev.lo[y*lev.wd+x]; hi[2] = lev.hi[y*lev.wd+x];
+
+    // slab test, clipped to the forward half of the ray
+    tin = 0.0f; tout = std::numeric_limits<float>::max();
+    for(int a = 0; a < 3; a++)
+    {
+        if(d[a] == 0.0f)
+        {
+            if(o[a] < lo[a] || o[a] > hi[a])
+                return false;
+        }
+        else
+        {
+            float t0 = (lo[a] - o[a]) / d[a], t1 = (hi[a] - o[a]) / d[a];
+            if(t0 > t1)
+                std::swap(t0, t1);
+            tin = std::max(tin, t0); tout = std::min(tout, t1);
+            if(tin > tout)
+                return false;
         }
+    }
+    return true;
+}
 
+bool HeightPyramid::cellIntersect(const HeightView & grid, int x, int y, const float o[3], const float d[3],
+                                  float tin, float tout, float & t) const
+{
+    // h(u,v) = a + b u + c v + e u v over the cell, with the ray at u = ou + du t, v = ov + dv t, height = oh + dh t
+    double h00 = grid.get(x, y), h10 = grid.get(x+1, y), h01 = grid.get(x, y+1), h11 = grid.get(x+1, y+1);
+    double a = h00, b = h10 - h00, c = h01 - h00, e = h11 - h10 - h01 + h00;
+    double ou = o[0] - x, ov = o[1] - y, oh = o[2], du = d[0], dv = d[1], dh = d[2];
+
+    // ray height above the surface as a quadratic in t
+    double qa = -e * du * dv;
+    double qb = dh - b * du - c * dv - e * (ou * dv + ov * du);
+    double qc = oh - a - b * ou - c * ov - e * ou * ov;
+
+    double roots[2];
+    int nroots = 0;
+    if(std::fabs(qa) < 1e-12)
+    {
+        if(std::fabs(qb) < 1e-12)
+            return false;
+        roots[nroots++] = -qc / qb;
+    }
+    else
+    {
+        double disc = qb * qb - 4.0 * qa * qc;
+        if(disc < 0.0)
+            return false;
+        // numerically stable form of the quadratic roots
+        double q = -0.5 * (qb + (qb < 0.0 ? -std::sqrt(disc) : std::sqrt(disc)));
+        roots[nroots++] = q / qa;
+        if(q != 0.0)
+            roots[nroots++] = qc / q;
+    }
+
+    double slack = 1e-6 * std::max(1.0, (double) tout);
+    bool found = false;
+    double best = std::numeric_limits<double>::max();
+    for(int r = 0; r < nroots; r++)
+        if(roots[r] >= (double) tin - slack && roots[r] <= (double) tout + slack && roots[r] >= 0.0 && roots[r] < best)
+        {
+            best = roots[r];
+            found = true;
+        }
+    if(found)
+        t = (float) best;
     return found;
 }
 
+bool HeightPyramid::intersect(const HeightView & grid, const float o[3], const float d[3], float & t) const
+{
+    struct Node
+    {
+        int level, x, y;
+        float tin, tout;
+    };
+    std::vector<Node> stack;
+    float best = std::numeric_limits<float>::max();
+    float tin, tout;
+
+    if(levels.empty())
+        return false;
+
+    int top = (int) levels.size() - 1;
+    if(nodeRange(top, 0, 0, o, d, tin, tout))
+        stack.push_back({top, 0, 0, tin, tout});
+
+    // depth first, nearest child first, pruning anything that starts beyond the best hit so far
+    while(!stack.empty())
+    {
+        Node n = stack.back();
+        stack.pop_back();
+        if(n.tin >= best)
+            continue;
+
+        if(n.level == 0)
+        {
+            float th;
+            if(cellIntersect(grid, n.x, n.y, o, d, n.tin, n.tout, th) && th < best)
+                best = th;
+            continue;
+        }
+
+        const Level & child = levels[n.level-1];
+        Node kids[4];
+        int nkids = 0;
+        for(int cy = 2*n.y; cy < std::min(2*n.y+2, child.ht); cy++)
+            for(int cx = 2*n.x; cx < std::min(2*n.x+2, child.wd); cx++)
+                if(nodeRange(n.level-1, cx, cy, o, d, tin, tout) && tin < best)
+                    kids[nkids++] = {n.level-1, cx, cy, tin, tout};
+
+        // push the farthest first so that the nearest is visited next
+        std::sort(kids, kids+nkids, [](const Node & p, const Node & q){ return p.tin > q.tin; });
+        for(int k = 0; k < nkids; k++)
+            stack.push_back(kids[k]);
+    }
+
+    if(best == std::numeric_limits<float>::max())
+        return false;
+    t = best;
+    return true;
+}
+
 bool Terrain::pick(int sx, int sy, View * view, vpPoint & p)
 {
     vpPoint start;
@@ -530,36 +802,115 @@ bool Terrain::pick(int sx, int sy, View * view, vpPoint & p)
 
 bool Terrain::drapePnt(vpPoint pnt, vpPoint & drape)
 {
-    float x, y, h, drapeh, u, v, h0, h1, ux, uy;
-    int cx, cy, dx, dy;
+    float h;
+    bool inside;
 
-    getGridDim(dx, dy);
-    toGrid(pnt, x, y, h); // locate point on base domain
+    drapeHeights(1, &pnt.x, &pnt.z, &h, nullptr, &inside);
+    if(inside)
+        drape = vpPoint(pnt.x, h, pnt.z);
+    return inside;
+}
 
-    // test whether point is in bounds
-    ux = (float) (dy-1) - pluszero;
-    uy = (float) (dx-1) - pluszero;
+int Terrain::drapeHeights(int n, const float * wx, const float * wz, float * h, Vector * nrm, bool * inside) const
+{
+    int gx, gy;
+    float tx, ty;
 
-    if(x < pluszero || y < pluszero || x > ux || y > uy)
-        return false;
+    getGridDim(gx, gy);
+    getTerrainDim(tx, ty);
+    if(gx < 2 || gy < 2)
+    {
+        for(int i = 0; i < n; i++)
+        {
+            h[i] = 0.0f;
+            if(nrm != nullptr)
+                nrm[i] = Vector(0.0f, 1.0f, 0.0f);
+            if(inside != nullptr)
+                inside[i] = false;
+        }
+        return 0;
+    }
 
-    // index of grid cell
-    cx = (int) floor(x);
-    cy = (int) floor(y);
+    // world x runs along the grid runs and world z across them, scaled as in toGrid
+    const float convx = (float) (gx-1) / tx, convz = (float) (gy-1) / ty;
+    const int chunk = 256;
+    int count = 0;
 
-    // get parametric coordinates within grid cell
-    u = (x - (float) cx);
-    v = (y - (float) cy);
+    #pragma omp parallel for reduction(+:count) if(n > 16 * chunk)
+    for(int c0 = 0; c0 < n; c0 += chunk)
+    {
+        const int m = std::min(chunk, n - c0);
+        float h00[chunk], h01[chunk], h10[chunk], h11[chunk], fs[chunk], fr[chunk];
 
-    // bilinear interpolation
-    h0 = (1.0f - u) * grid->get(cy,cx) + u * grid->get(cy,cx+1);
-    h1 = (1.0f - u) * grid->get(cy+1,cx) + u * grid->get(cy+1,cx);
-    drapeh = (1.0f - v) * h0 + v * h1;
-    // this could be implemented using ray-triangle intersection
-    // but it would be much less efficient
-    drape = toWorld(x, y, drapeh);
+        // clamp to the grid and gather the corners of each cell; corners along a run are adjacent in memory
+        for(int i = 0; i < m; i++)
+        {
+            float s = wx[c0+i] * convx, r = wz[c0+i] * convz;
+            bool in = (s >= pluszero && r >= pluszero && s <= (float) (gy-1) - pluszero && r <= (float) (gx-1) - pluszero);
+            count += (in ? 1 : 0);
+            if(inside != nullptr)
+                inside[c0+i] = in;
+
+            s = std::min(std::max(s, 0.0f), (float) (gy-1));
+            r = std::min(std::max(r, 0.0f), (float) (gx-1));
+            int cs = std::min((int) s, gy-2), cr = std::min((int) r, gx-2);
+            const float * run0 = grid.run(cr) + cs, * run1 = grid.run(cr+1) + cs;
+            h00[i] = run0[0]; h01[i] = run0[1];
+            h10[i] = run1[0]; h11[i] = run1[1];
+            fs[i] = s - (float) cs; fr[i] = r - (float) cr;
+        }
 
-    return true;
+        // bilinear interpolation
+        #pragma omp simd
+        for(int i = 0; i < m; i++)
+        {
+            float h0 = h00[i] + fs[i] * (h01[i] - h00[i]);
+            float h1 = h10[i] + fs[i] * (h11[i] - h10[i]);
+            h[c0+i] = h0 + fr[i] * (h1 - h0);
+        }
+
+        // normal from the gradient of the bilinear patch
+        if(nrm != nullptr)
+        {
+            float dx[chunk], dz[chunk];
+            #pragma omp simd
+            for(int i = 0; i < m; i++)
+            {
+                dx[i] = ((1.0f - fr[i]) * (h01[i] - h00[i]) + fr[i] * (h11[i] - h10[i])) * convx;
+                dz[i] = ((1.0f - fs[i]) * (h10[i] - h00[i]) + fs[i] * (h11[i] - h01[i])) * convz;
+            }
+            for(int i = 0; i < m; i++)
+            {
+                float len = 1.0f / sqrtf(1.0f + dx[i] * dx[i] + dz[i] * dz[i]);
+                nrm[c0+i] = Vector(-dx[i] * len, len, -dz[i] * len);
+            }
+        }
+    }
+    return count;
+}
+
+void Terrain::extractContours(const std::vector<float> & levels, std::vector<ContourLine> & lines) const
+{
+    int gx, gy;
+    float tx, ty;
+
+    getGridDim(gx, gy);
+    getTerrainDim(tx, ty);
+    lines.clear();
+    if(gx < 2 || gy < 2)
+        return;
+
+    // march along the runs, which are contiguous, so contour x is grid y and contour y is grid x
+    ::extractContours(grid.run(0), gy, gx, 1, grid.runStride(), levels, lines);
+
+    const float sx = tx / (float) (gx-1), sz = ty / (float) (gy-1); // inverse of the toGrid scaling
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int i = 0; i < (int) lines.size(); i++)
+        for(size_t p = 0; p < lines[i].xy.size(); p += 2)
+        {
+            lines[i].xy[p] *= sx;
+            lines[i].xy[p+1] *= sz;
+        }
 }
 
 void Terrain::loadElv(const std::string &filename, int dFactor)
@@ -607,8 +958,7 @@ void Terrain::loadElv(const std::string &filename, int dFactor)
                 if (x % dFactor == 0 && y % dFactor == 0)
                 {
                     count++;
-                    grid->set(x/dFactor, y/dFactor, val); //  * 0.3048f); // convert from feet to metres
-                    drawgrid->set(y/dFactor, x/dFactor, val); // * 0.3048f);
+                    heightStore->set(y/dFactor, x/dFactor, val); // * 0.3048f); // convert from feet to metres
                 }
             }
         }
@@ -681,8 +1031,7 @@ void Terrain::loadElvBinary(const std::string &filename, int dFactor)
                 if (x % dFactor == 0 && y % dFactor == 0)
                 {
                     count++;
-                    grid->set(x/dFactor, y/dFactor, val); //  * 0.3048f); // convert from feet to metres
-                    drawgrid->set(y/dFactor, x/dFactor, val); // * 0.3048f);
+                    heightStore->set(y/dFactor, x/dFactor, val); // * 0.3048f); // convert from feet to metres
                 }
             }
         }
@@ -731,8 +1080,7 @@ void Terrain::loadElv(const std::string &filename)
             // for (int x = 0; x < dx; x++)
             {
                 infile >> val;
-                grid->set(x, y, val); //  * 0.3048f); // convert from feet to metres
-                drawgrid->set(y, x, val); // * 0.3048f);
+                heightStore->set(y, x, val); //  * 0.3048f); // convert from feet to metres
             }
         }
         setMidFocus();
@@ -749,7 +1097,6 @@ void Terrain::loadElvBinary(const std::string &filename)
     //float lat;
     int dx, dy;
 
-    float val;
     ifstream infile;
 
     infile.open((char *) filename.c_str(), ios::binary);
@@ -770,24 +1117,9 @@ void Terrain::loadElvBinary(const std::string &filename)
         // original code: outer loop over x, inner loop over y
         // raster format (ESRI) is oriented differently
 
-        std::vector<float> heights;
-        heights.resize(dx*dy);
-
-        infile.read(reinterpret_cast<char*>(heights.data()), dx*dy*sizeof(float));
+        // the file lists heights with x varying slowest, which is the storage order, so they are read in place
+        infile.read(reinterpret_cast<char*>(heightStore->getPtr()), (long) dx*dy*sizeof(float));
         infile.close();
-
-        long ct = 0;
-        for (int x = 0; x < dx; x++)
-        // for (int y = 0; y < dy; y++)
-        {
-            for (int y = 0; y < dy; y++)
-            // for (int x = 0; x < dx; x++)
-            {
-                val = heights[ct++];
-                grid->set(x, y, val); //  * 0.3048f); // convert from feet to metres
-                drawgrid->set(y, x, val); // * 0.3048f);
-            }
-        }
         setMidFocus();
 std::cerr << " -- *** -- Done read: " << dx << "," << dy << ", " << step << ", " << locx << "," << locy << std::endl;
     }
@@ -812,7 +1144,7 @@ void Terrain::saveElv(const std::string &filename)
         {
             for (int y = 0; y < gy; y++)
             {
-                outfile << grid->get(x,y) << " ";
+                outfile << grid.get(x,y) << " ";
             }
         }
         outfile << endl;
@@ -827,118 +1159,244 @@ void Terrain::saveElv(const std::string &filename)
 
 void Terrain::calcSlopeMap(basic_types::MapFloat* slopeMap)
 {
+  const TerrainDerivatives & dmaps = getDerivedMaps();
   int dx, dy;
-  float slope;
-  Vector norm;
 
   getGridDim(dx, dy);
+  slopeMap->setDim(dx, dy);
+  const float * slope = dmaps.slope.getPtr();
+  float * elev = slopeMap->getPtr();
+  for (long i = 0; i < (long) dx * dy; i++)
+    elev[i] = 90.0f - slope[i];
+}
 
-  for (int x = 0; x < dx; x++)
-  {
-    for (int y = 0; y < dy; y++)
+// Compute ambient occlusion and sky-view factor maps by horizon scanning
+void Terrain::calcAO(basic_types::MapFloat * aoMap, basic_types::MapFloat * svfMap, int ndirs, float radius)
+{
+    int gx, gy;
+    float tx, ty;
+
+    getGridDim(gx, gy);
+    getTerrainDim(tx, ty);
+    if(gx < 2 || gy < 2 || ndirs < 1)
+        return;
+
+    aoMap->setDim(gx, gy);
+    aoMap->fill(0.0f);
+    float * ao = aoMap->getPtr();
+    float * svf = nullptr;
+    if(svfMap != nullptr)
     {
-      getNormal(x, y, norm);
-      slope = 90.0f - acosf(norm.j) * 180.0f / M_PI;
+        svfMap->setDim(gx, gy);
+        svfMap->fill(0.0f);
+        svf = svfMap->getPtr();
+    }
+    float cell = tx / (float) (gx-1);
+    long ncells = (long) gx * gy;
+    std::vector<float> hght(ncells), tanHorizon(ncells);
+    grid.copyRowMajor(hght.data());
 
-      slopeMap->set(x, y, slope);
+    for(int dir = 0; dir < ndirs; dir++)
+    {
+        float phi = 2.0f * (float) M_PI * (float) dir / (float) ndirs;
+        sweepHorizon(hght.data(), nullptr, gx, gy, cell, cosf(phi), sinf(phi), radius, tanHorizon.data());
+
+        #pragma omp parallel for
+        for(long i = 0; i < ncells; i++)
+        {
+            float cos2 = 1.0f / (1.0f + tanHorizon[i] * tanHorizon[i]);
+            ao[i] += cos2;
+            if(svf != nullptr)
+                svf[i] += 1.0f - tanHorizon[i] * sqrtf(cos2);
+        }
     }
-  }
+
+    float norm = 1.0f / (float) ndirs;
+    #pragma omp parallel for
+    for(long i = 0; i < ncells; i++)
+    {
+        ao[i] *= norm;
+        if(svf != nullptr)
+            svf[i] *= norm;
+    }
+}
+
+uint64_t Terrain::heightHash() const
+{
+    // FNV-1a over the dimensions and the bit patterns of the heights
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](uint32_t v){ hash = (hash ^ v) * 1099511628211ull; };
+    int gx, gy;
+
+    getGridDim(gx, gy);
+    mix((uint32_t) gx); mix((uint32_t) gy);
+    for(int x = 0; x < gx; x++)
+    {
+        const float * run = grid.run(x);
+        for(int y = 0; y < gy; y++)
+        {
+            uint32_t bits;
+            memcpy(&bits, &run[y], sizeof(bits));
+            mix(bits);
+        }
+    }
+    return hash;
 }
 
-// Compute ambiant occlusion map
-void Terrain::calcAO(basic_types::MapFloat* slopeMap)
+bool Terrain::calcAOCached(const std::string & cachefile, basic_types::MapFloat * aoMap, basic_types::MapFloat * svfMap,
+                           int ndirs, float radius)
 {
-	int dx, dy;
-	float ao;
-	Vector norm;
+    const char magic[4] = {'E', 'V', 'A', 'O'};
+    const int version = 1;
+    int gx, gy;
+    uint64_t hash = heightHash();
 
-	getGridDim(dx, dy);
+    getGridDim(gx, gy);
 
-	for (int x = 0; x < dx; x++)
-	{
-		for (int y = 0; y < dy; y++)
-		{
-      // Compute ambiant occlusion with raycasting in a demi sphere
-      // 1. Get the normal at the point
-      
-      
-      // 2. Cast rays in a hemisphere above the point
+    ifstream infile(cachefile, ios::binary);
+    if(infile.is_open())
+    {
+        char fmagic[4];
+        int fversion, fgx, fgy, fndirs;
+        float fradius;
+        uint64_t fhash;
+        infile.read(fmagic, 4);
+        infile.read(reinterpret_cast<char *>(&fversion), sizeof(int));
+        infile.read(reinterpret_cast<char *>(&fgx), sizeof(int));
+        infile.read(reinterpret_cast<char *>(&fgy), sizeof(int));
+        infile.read(reinterpret_cast<char *>(&fndirs), sizeof(int));
+        infile.read(reinterpret_cast<char *>(&fradius), sizeof(float));
+        infile.read(reinterpret_cast<char *>(&fhash), sizeof(uint64_t));
+        if(infile && memcmp(fmagic, magic, 4) == 0 && fversion == version && fgx == gx && fgy == gy
+                && fndirs == ndirs && fradius == radius && fhash == hash)
+        {
+            aoMap->setDim(gx, gy);
+            infile.read(reinterpret_cast<char *>(aoMap->getPtr()), (long) gx * gy * sizeof(float));
+            if(svfMap != nullptr)
+            {
+                svfMap->setDim(gx, gy);
+                infile.read(reinterpret_cast<char *>(svfMap->getPtr()), (long) gx * gy * sizeof(float));
+            }
+            if(infile)
+                return true;
+        }
+        infile.close();
+    }
 
-      // 3. Compute the number of rays that hit the terrain
-      
-      // 4. Compute the ratio of rays that hit the terrain
-      // 5. Set the value in the map
+    // the cache always holds both maps, so that callers with and without sky-view share it
+    basic_types::MapFloat svfTmp;
+    basic_types::MapFloat * svfOut = (svfMap != nullptr ? svfMap : &svfTmp);
+    calcAO(aoMap, svfOut, ndirs, radius);
 
-		}
-	}
+    ofstream outfile(cachefile, ios::binary);
+    if(outfile.is_open())
+    {
+        outfile.write(magic, 4);
+        outfile.write(reinterpret_cast<const char *>(&version), sizeof(int));
+        outfile.write(reinterpret_cast<const char *>(&gx), sizeof(int));
+        outfile.write(reinterpret_cast<const char *>(&gy), sizeof(int));
+        outfile.write(reinterpret_cast<const char *>(&ndirs), sizeof(int));
+        outfile.write(reinterpret_cast<const char *>(&radius), sizeof(float));
+        outfile.write(reinterpret_cast<const char *>(&hash), sizeof(uint64_t));
+        outfile.write(reinterpret_cast<const char *>(aoMap->getPtr()), (long) gx * gy * sizeof(float));
+        outfile.write(reinterpret_cast<const char *>(svfOut->getPtr()), (long) gx * gy * sizeof(float));
+        outfile.close();
+    }
+    else
+    {
+        cerr << "Error Terrain::calcAOCached: unable to write cache file " << cachefile << endl;
+    }
+    return false;
 }
 
 
-void Terrain::saveOBJ(const std::string& filename)
+namespace
 {
-  int gx, gy;
 
-  ofstream outfile;
-  outfile.open((char*)filename.c_str(), ios_base::out);
-  if (outfile.is_open())
-  {
-    getGridDim(gx, gy);
-    //outfile << gx << " " << gy << " " << step << " " << latitude << endl;
+/// Terrain grid, or a triangulation of a subset of its vertices, presented to the mesh writers
+class TerrainMesh : public MeshSource
+{
+public:
+    TerrainMesh(const HeightView & grid, const TerrainDerivatives & dmaps, float step,
+                const std::vector<uint32_t> * verts, const std::vector<uint32_t> * tris)
+        : grid(grid), dmaps(dmaps), step(step), verts(verts), tris(tris) {}
 
-    // Vertexes
-    for (int x = 0; x < gx; x++)
+    int64_t vertexCount() const override
     {
-      for (int y = 0; y < gy; y++)
-      {
-        outfile << "v " << y * step  << " " << grid->get(x, y) << " " << x * step << "\n";
-      }
+        return (verts != nullptr ? (int64_t) verts->size() : (int64_t) grid.width() * grid.height());
     }
-    // Normals
-    for (int x = 0; x < gx; x++)
+
+    int64_t faceCount() const override
     {
-      for (int y = 0; y < gy; y++)
-      {
-        Vector norm;
-        getNormal(x, y, norm);
+        return (tris != nullptr ? (int64_t) tris->size() / 3 : 2 * (int64_t) (grid.width() - 1) * (grid.height() - 1));
+    }
 
-				outfile << "vn " << norm.k << " " << norm.j << " " << norm.i << "\n"; // JGBUG - may be wrong direction ??
-      }
+    void getVertices(int64_t first, int count, float * pos, float * nrm, float * uv) const override
+    {
+        int gx = grid.width(), gy = grid.height();
+        for(int i = 0; i < count; i++)
+        {
+            int64_t v = (verts != nullptr ? (int64_t) (*verts)[first + i] : first + i);
+            int x = (int) (v / gy), y = (int) (v % gy);
+            pos[3*i] = y * step; pos[3*i+1] = grid.get(x, y); pos[3*i+2] = x * step;
+            nrm[3*i] = dmaps.nz.get(x, y); nrm[3*i+1] = dmaps.ny.get(x, y); nrm[3*i+2] = dmaps.nx.get(x, y);
+            uv[2*i] = float(x) / float(gx); uv[2*i+1] = float(y) / float(gy);
+        }
     }
-    // UV
-    for (int x = 0; x < gx; x++)
+
+    void getFaces(int64_t first, int count, uint32_t * idx) const override
     {
-      for (int y = 0; y < gy; y++)
-      {
-        outfile << "vt " << float(x)/float(gx)  << " " << float(y) / float(gy) << "\n";
-      }
+        if(tris != nullptr)
+        {
+            std::copy(tris->begin() + 3 * first, tris->begin() + 3 * (first + count), idx);
+            return;
+        }
+        int gy = grid.height();
+        for(int i = 0; i < count; i++)
+        {
+            // two triangles per cell, cells in storage order
+            int64_t f = first + i, cell = f / 2;
+            uint32_t ij = (uint32_t) ((cell / (gy - 1)) * gy + cell % (gy - 1));
+            idx[3*i] = ij;
+            idx[3*i+1] = (f % 2 == 0 ? ij + 1 : ij + gy + 1);
+            idx[3*i+2] = (f % 2 == 0 ? ij + gy + 1 : ij + gy);
+        }
     }
-    // Faces
-    for (int x = 0; x < gx - 1; x++)
-		{
-			for (int y = 0; y < gy - 1; y++)
-			{
-        int ij = x * gy + y;
-        int ij1 = x * gy + y + 1;
-        int i1j = (x + 1) * gy + y;
-        int i1j1 = (x + 1) * gy + y + 1;
-
-        outfile << "f " << ij + 1 << "/" << ij + 1 << "/" << ij + 1 << " ";
-        outfile << ij1 + 1 << "/" << ij1 + 1 << "/" << ij1 + 1 << " ";
-        outfile << i1j1 + 1 << "/" << i1j1 + 1 << "/" << i1j1 + 1 << "\n";
-
-        outfile << "f " << ij + 1 << "/" << ij + 1 << "/" << ij + 1 << " ";
-        outfile << i1j1 + 1 << "/" << i1j1 + 1 << "/" << i1j1 + 1 << " ";
-        outfile << i1j + 1 << "/" << i1j + 1 << "/" << i1j + 1 << "\n";
-
-			}
-		}
-    outfile << endl;
-    outfile.close();
-  }
-  else
-  {
-    cerr << "Error Terrain::loadOBJ:unable to open file " << filename << endl;
-  }
+
+private:
+    const HeightView & grid;
+    const TerrainDerivatives & dmaps;
+    float step;
+    const std::vector<uint32_t> * verts;    //< grid vertices x * gy + y of a triangulation, or nullptr for all
+    const std::vector<uint32_t> * tris;     //< triangles indexing verts, or nullptr for the full grid
+};
+
+} // namespace
+
+void Terrain::saveOBJ(const std::string& filename)
+{
+  saveMesh(filename);
+}
+
+bool Terrain::saveMesh(const std::string & filename, float maxError)
+{
+    int gx, gy;
+    std::vector<uint32_t> verts, tris;
+
+    getGridDim(gx, gy);
+    if(gx < 2 || gy < 2)
+    {
+        cerr << "Error Terrain::saveMesh: no terrain to save to " << filename << endl;
+        return false;
+    }
+
+    // triangulate along the contiguous runs, so triangulation x is grid y, matching the vertex order x * gy + y
+    bool decimate = (maxError > 0.0f);
+    if(decimate)
+        triangulateGrid(grid.run(0), gy, gx, 1, grid.runStride(), maxError, verts, tris);
+
+    TerrainMesh mesh(grid, getDerivedMaps(), step, decimate ? &verts : nullptr, decimate ? &tris : nullptr);
+    return writeMesh(filename, mesh);
 }
 
 
@@ -957,7 +1415,7 @@ void Terrain::saveOBJ_Border(const std::string& filename)
     float terrainBase = 1000000.0f; // +infinity
     for (int x = 0; x < gx; x=x+2)
       for (int y = 0; y < gy; y=y+2)
-        terrainBase = min(terrainBase, grid->get(x, y));
+        terrainBase = min(terrainBase, grid.get(x, y));
 
 		terrainBase -= 50.0f; // add a little margin
 
@@ -966,25 +1424,25 @@ void Terrain::saveOBJ_Border(const std::string& filename)
     for (int x = 0; x < gx; x++) // First X line
     {
       outfile << "v " << 0 << " " << terrainBase << " " << x * step << "\n";
-      outfile << "v " << 0 << " " << grid->get(x, 0) << " " << x * step << "\n";
+      outfile << "v " << 0 << " " << grid.get(x, 0) << " " << x * step << "\n";
     }
 
     for (int x = 0; x < gx; x++) // First X line
     {
       outfile << "v " << (gy-1) * step << " " << terrainBase << " " << x * step << "\n";
-      outfile << "v " << (gy-1) * step << " " << grid->get(x, gy-1) << " " << x * step << "\n";
+      outfile << "v " << (gy-1) * step << " " << grid.get(x, gy-1) << " " << x * step << "\n";
     }
 
     for (int y = 0; y < gy; y++)
     {
       outfile << "v " << y * step << " " << terrainBase << " " << 0 << "\n";
-      outfile << "v " << y * step << " " << grid->get(0, y) << " " << 0 << "\n";
+      outfile << "v " << y * step << " " << grid.get(0, y) << " " << 0 << "\n";
     }
 
 		for (int y = 0; y < gy; y++)
 		{
 			outfile << "v " << y * step << " " << terrainBase << " " << (gx - 1) * step << "\n";
-			outfile << "v " << y * step << " " << grid->get((gx - 1), y) << " " << (gx - 1) * step << "\n";
+			outfile << "v " << y * step << " " << grid.get((gx - 1), y) << " " << (gx - 1) * step << "\n";
 		}
 
     // Normals
@@ -1045,12 +1503,16 @@ void Terrain::calcMeanHeight()
     int i, j, cnt = 0;
     hghtmean = 0.0f;
 
-    for(j = 0; j < grid->height(); j++)
-        for(i = 0; i < grid->width(); i++)
+    // along each run of heights in turn, which is the storage order
+    for(i = 0; i < grid.width(); i++)
+    {
+        const float * run = grid.run(i);
+        for(j = 0; j < grid.height(); j++)
         {
-            hghtmean += grid->get(i,j);
+            hghtmean += run[j];
             cnt++;
         }
+    }
     hghtmean /= (float) cnt;
 }
 
@@ -1062,13 +1524,16 @@ void Terrain::getHeightBounds(float &minh, float &maxh)
     maxh = -10000000.0f;
     minh = 100000000.0;
 
-    for(j = 0; j < grid->height(); j++)
-        for(i = 0; i < grid->width(); i++)
+    for(i = 0; i < grid.width(); i++)
+    {
+        const float * run = grid.run(i);
+        for(j = 0; j < grid.height(); j++)
         {
-            hght = grid->get(i,j);
+            hght = run[j];
             if(hght < minh)
                 minh = hght;
             if(hght > maxh)
                 maxh = hght;
         }
+    }
 }
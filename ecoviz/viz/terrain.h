@@ -25,28 +25,137 @@
 #define TERRAIN_H
 
 #include <memory>
+#include <algorithm>
+#include <cstdint>
 #include "vecpnt.h"
 #include "view.h"
 #include "trenderer.h"
 #include "common/basic_types.h"
+#include "common/contour.h"
+#include "common/meshexport.h"
 
 #define DEFAULT_DIMX 512
 #define DEFAULT_DIMY 512
 
 
-class AccelSphere
+/**
+ * Read-only view of a rectangle of heights. The storage holds a contiguous run of y values for each x, which is the
+ * layout of the heightmap texture, and runs lie @a stride floats apart so that a sub-terrain can view a block of its
+ * parent's heights in place. The view shares ownership of the storage, so it stays valid if the owner reloads.
+ */
+class HeightView
 {
+public:
+
+    HeightView() : base(nullptr), gx(0), gy(0), stride(0) {}
+
+    /// View all of @a store, which holds store->height() runs of store->width() heights
+    explicit HeightView(std::shared_ptr<const basic_types::MapFloat> store);
+
+    /// View of the @a dx by @a dy block of this view with corner (@a x0, @a y0)
+    HeightView block(int x0, int y0, int dx, int dy) const;
+
+    /// Height at grid position (x, y), unchecked
+    float get(int x, int y) const { return base[(long) x * stride + y]; }
+
+    /// The gy heights with grid position x
+    const float * run(int x) const { return base + (long) x * stride; }
+
+    int width() const { return gx; }
+    int height() const { return gy; }
+
+    /// True if each run directly follows the last, so that run(0) addresses every height
+    bool contiguous() const { return stride == gy; }
+
+    /// Distance in floats between the starts of successive runs
+    long runStride() const { return stride; }
+
+    /// Copy the heights to @a dst in storage order, gx runs of gy values
+    void copyRuns(float * dst) const;
+
+    /// Copy the heights to @a dst in row-major order, gy rows of gx values
+    void copyRowMajor(float * dst) const;
+
 private:
-    friend class boost::serialization::access;
-    /// Boost serialization
-    template<class Archive> void serialize(Archive & ar, const unsigned int version)
-    {
-        ar & center; ar & radius;
-    }
+    std::shared_ptr<const basic_types::MapFloat> store; //< storage being viewed
+    const float * base;     //< height at grid position (0, 0)
+    int gx, gy;             //< grid dimensions
+    long stride;            //< distance in floats between successive runs
+};
 
+/**
+ * Min/max pyramid over the cells of a height grid. Level 0 holds the lowest and highest corner height of every
+ * grid cell and each coarser level bounds a 2x2 block of the level below, so that a ray can skip any block of
+ * cells whose height range it passes over or under. Coordinates are in grid units: x and y index the grid and
+ * the third component is height.
+ */
+class HeightPyramid
+{
 public:
-    vpPoint center;
-    float radius;
+
+    /// Build every level from the heights in grid, reusing storage if the dimensions are unchanged
+    void build(const HeightView & grid);
+
+    /**
+     * @brief buildFrom Build the pyramid of a sub-grid, copying the cell bounds from the pyramid of its parent
+     *                  rather than recomputing them from heights
+     * @param parent    valid pyramid over the parent grid
+     * @param x0, y0    grid position of the sub-grid in the parent
+     * @param dx, dy    number of grid samples in the sub-grid
+     */
+    void buildFrom(const HeightPyramid & parent, int x0, int y0, int dx, int dy);
+
+    /// Discard all levels
+    void clear(){ levels.clear(); }
+
+    /// True if there are levels to traverse
+    bool isEmpty() const { return levels.empty(); }
+
+    /**
+     * @brief intersect Find the first intersection of a ray with the bilinear surface through the grid heights
+     * @param grid      height grid the pyramid was built from
+     * @param o         ray origin in grid coordinates
+     * @param d         ray direction in grid coordinates
+     * @param[out] t    ray parameter of the nearest hit, if the return value is @c true
+     * @retval @c true if the ray strikes the surface at t >= 0
+     * @retval @c false otherwise.
+     */
+    bool intersect(const HeightView & grid, const float o[3], const float d[3], float & t) const;
+
+private:
+
+    struct Level
+    {
+        int wd, ht;                 //< number of nodes across and down
+        std::vector<float> lo, hi;  //< minimum and maximum height per node, row major
+    };
+
+    std::vector<Level> levels;      //< level 0 is one node per grid cell, the last level is a single node
+
+    /// size levels for a grid of cw x ch cells, returns false if storage was already the right size
+    bool allocate(int cw, int ch);
+
+    /// fill levels 1 and above from level 0
+    void reduce();
+
+    /// ray parameter range [tin, tout] within the bounds of a node, returns false if the ray misses it
+    bool nodeRange(int level, int x, int y, const float o[3], const float d[3], float & tin, float & tout) const;
+
+    /// nearest intersection within [tin, tout] of the ray with the bilinear patch of a single grid cell
+    bool cellIntersect(const HeightView & grid, int x, int y, const float o[3], const float d[3],
+                       float tin, float tout, float & t) const;
+};
+
+/**
+ * Per cell quantities derived from central height differences (one sided on the border), computed together in a
+ * single pass over the grid by Terrain::getDerivedMaps. All maps share the dimensions of the height grid.
+ */
+struct TerrainDerivatives
+{
+    basic_types::MapFloat nx, ny, nz;   ///< unit world-space normal
+    basic_types::MapFloat slope;        ///< angle from horizontal in degrees
+    basic_types::MapFloat aspect;       ///< direction of steepest descent in degrees, from world +x towards world +z
+    basic_types::MapFloat curvature;    ///< Laplacian of height in 1/m, positive in hollows and negative on ridges
 };
 
 /// Renderable heightmap
@@ -69,8 +178,9 @@ private:
         GLfloat normal[3];
     };
 
-    basic_types::MapFloat * grid;           ///< grid of height values in metres
-    basic_types::MapFloat * drawgrid;       ///< inverted grid for rendering
+    std::shared_ptr<basic_types::MapFloat> heightStore;  ///< heights written by the loaders, nullptr for a sub-terrain
+    HeightView grid;                        ///< grid of height values in metres, all of heightStore or a block of the parent's
+    std::vector<float> packed;              ///< contiguous copy of a sub-terrain's heights for texture upload
     vpPoint focus;                          ///< focal point fo view
 
     float dimx, dimy;                       ///< dimensions of terrain in metres
@@ -79,13 +189,16 @@ private:
     float scfac;                            ///< artificial vertical scaling to make large terrains more discernable
     float step;                             ///< interval between grid vertices in meters
 
-    int numspx, numspy;                     ///< dimensions of accel structure
-    int spherestep;                         ///< number of grid points per accel sphere
     bool accelValid;                        ///< true if the accel structure does not need updating
     bool scaleOn;                           ///< is the terrain being scaled
-    std::vector<std::vector<AccelSphere>> boundspheres; ///< bounding sphere accel structure
+    HeightPyramid accel;                    ///< min/max pyramid used to intersect rays with the terrain
+    bool derivedValid;                      ///< true if the derived maps match the current heights
+    TerrainDerivatives derived;             ///< memoized normals, slope, aspect and curvature
 
     mutable BufferState bufferState = BufferState::REALLOCATE;  ///< Buffer state
+    long heightRevision = 0;                ///< incremented whenever height data is found to have changed
+    long id;                                ///< identity of this terrain, never shared by two terrains
+    static long idCounter;                  ///< source of terrain identities
 
     float hghtrange;        ///< maximum terrain height range from synthesizer
     float hghtmean;         ///< mean terrain height, calculated on first synthesis
@@ -102,51 +215,80 @@ private:
     int parentGridy;       ///< samples in x/y (NOTE: float terrain extent can be recovered as dim*step
 
     // PM: terrain renderer
-    mutable GLuint htMapTextureId;
+    std::shared_ptr<PMrender::SharedHeightMap> heightmap = std::make_shared<PMrender::SharedHeightMap>(); ///< heightmap texture shared by all views
+
+    /// re-build the min/max pyramid when terrain is changed
+    void buildAccel();
 
-    /// re-build sphere acceleration structure when terrain is changed
-    void buildSphereAccel();
+    /// recompute every derived map in one pass over the grid
+    void buildDerived();
 
-    /// internal intialisation
+    /// internal intialisation, allocating fresh storage for a grid of size @a dx by @a dy
     void init(int dx, int dy, float sx, float sy);
 
+    /// reset the state that depends on the grid, once it is in place
+    void initState(float sx, float sy);
+
     //void updateBuffers(PMrender::TRenderer *renderer) const;
 
     friend class boost::serialization::access;
-    /// Boost serialization
-    template<class Archive> void serialize(Archive & ar, const unsigned int version)
+    /// Boost serialization. Heights are written through the grid, so a sub-terrain saves its own block of the parent.
+    template<class Archive> void save(Archive & ar, const unsigned int version) const
     {
-        ar & grid;
+        int gx = grid.width(), gy = grid.height();
+        std::vector<float> hghts((long) gx * gy);
+        if(!hghts.empty())
+            grid.copyRuns(hghts.data());
+        ar & gx; ar & gy;
+        ar & hghts;
         ar & focus;
         ar & dimx; ar & dimy;
-        ar & synthx; ar & synthy;
-        ar & numspx; ar & numspy;
-        ar & spherestep;
-        ar & accelValid;
-        ar & boundspheres;
+        ar & step;
+        ar & hghtrange;
+        ar & hghtmean;
+    }
+
+    /// Boost serialization. A loaded terrain owns its heights, with the grid bound to fresh storage.
+    template<class Archive> void load(Archive & ar, const unsigned int version)
+    {
+        int gx, gy;
+        std::vector<float> hghts;
+        vpPoint f;
+        float tx, ty;
+
+        ar & gx; ar & gy;
+        ar & hghts;
+        ar & f;
+        ar & tx; ar & ty;
+        ar & step;
         ar & hghtrange;
         ar & hghtmean;
+
+        sourceRegion = Region();
+        parentGridx = parentGridy = 0;
+        init(gx, gy, tx, ty);
+        if(!hghts.empty() && (long) hghts.size() == (long) gx * gy)
+            std::copy(hghts.begin(), hghts.end(), heightStore->data());
+        setFocus(f);
     }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
 
 public:
 
     /// Constructor
     Terrain(Region source = Region()) // empty source region by default
     {
-        dimx = dimy = synthx = synthy = 0.0f; numspx = numspy = 0;
-        hghtrange = 0.0f; hghtmean = 0.0f; accelValid = false;
-        grid = new basic_types::MapFloat();
-        drawgrid = new basic_types::MapFloat();
+        dimx = dimy = synthx = synthy = 0.0f;
+        hghtrange = 0.0f; hghtmean = 0.0f; accelValid = false; derivedValid = false;
         // PCM - set only if this terrain was created from (larger) parent terrain
         sourceRegion = source;
         parentGridx = parentGridy = 0;
+        id = ++idCounter;
       }
 
     /// Destructor
     ~Terrain()
     {
-        delete grid;
-        delete drawgrid;
     }
 
 
@@ -176,10 +318,9 @@ public:
         return Region(0, 0, dx, dy);
     }
 
-    void setHeightMaptextureID(GLuint id) { htMapTextureId = id; }
-
     /**
-     * Update the vertex buffers if necessary. This is called immediately before rendering.
+     * Update the vertex buffers if necessary. This is called immediately before rendering. The heightmap texture
+     * is shared by every renderer drawing this terrain, so new height data is only uploaded by the first of them.
      *
      * @pre There is a current OpenGL contex
      * @post @ref bufferState == @ref BufferState::CLEAN
@@ -227,7 +368,23 @@ public:
     float getCellArea(){ return getCellExtent()*getCellExtent(); }
 
     /// set buffer to dirty to force render reload
-    void setBufferToDirty(){ bufferState = BufferState::DIRTY; accelValid = false; }
+    void setBufferToDirty(){ bufferState = BufferState::DIRTY; accelValid = false; derivedValid = false; }
+
+    /// true if height data has changed since it was last uploaded, so that views caching its rendering must redraw
+    bool isBufferDirty() const { return bufferState != BufferState::CLEAN; }
+
+    /// revision of the height data, advanced each time changed data is uploaded
+    long getHeightRevision() const { return heightRevision; }
+
+    /// identity of the terrain, which unlike its address is never reused by a later terrain
+    long getId() const { return id; }
+
+    /**
+     * @brief inheritHeightMap Take over the heightmap texture of the terrain this one replaces, so that views
+     *                         refill it in place rather than allocating a new texture
+     * @param prev  terrain being replaced
+     */
+    void inheritHeightMap(const Terrain &prev){ heightmap = prev.heightmap; heightRevision = prev.heightRevision + 1; }
 
     /// Raise the focus so that it sits on the terrain after synthesis
     inline void raiseFocus()
@@ -242,9 +399,16 @@ public:
     /// Obtain height at a flattened grid index
     float getFlatHeight(int idx);
 
-    /// Return a world-space normal given a grid position
+    /// Return a world-space normal given a grid position, from the derived maps if they are current and otherwise
+    /// from the neighbouring heights alone, so that a single query never builds the maps
     void getNormal(int x, int y, Vector & norm);
 
+    /**
+     * @brief getDerivedMaps Normals, slope, aspect and curvature for the whole grid, computed on first use after
+     *                       the heights change and shared by every later caller
+     */
+    const TerrainDerivatives & getDerivedMaps();
+
     /// check if a point is within the grid dimensions, return true if it is
     bool inGridBounds(int x, int y);
 
@@ -315,7 +479,9 @@ public:
     bool inSynthBounds(vpPoint p) const;
 
     /**
-     * Find the intersection of an arbitrary ray with the terrain.
+     * Find the first intersection of an arbitrary ray with the terrain surface, bilinearly
+     * interpolated between grid points. The ray descends the min/max pyramid, so the cost grows
+     * with the logarithm of the grid size rather than the number of grid points.
      *
      * @param start    start point of ray
      * @param dirn     direction of ray
@@ -333,8 +499,7 @@ public:
      * @param view     View specifying the projection
      * @param[out] p   Picked point, if the return value is @c true
      * @retval @c true if the ray from the center of projection through screen coordinates
-     *                 (@a sx, @a sy) passes within @a tol of a grid point on
-     *                 the terrain.
+     *                 (@a sx, @a sy) strikes the terrain.
      * @retval @c false otherwise.
      */
     bool pick(int sx, int sy, View * view, vpPoint & p);
@@ -348,6 +513,26 @@ public:
      */
     bool drapePnt(vpPoint pnt, vpPoint & drape);
 
+    /**
+     * @brief drapeHeights Terrain heights, and optionally normals, at many world positions in one call, bilinearly
+     *                     interpolated between grid points as for drapePnt. Positions off the terrain take the height of
+     *                     the nearest point on its border. Interpolation is vectorised and large batches run in parallel.
+     * @param n         number of positions
+     * @param wx, wz    world x and z coordinates of the positions
+     * @param[out] h    n heights
+     * @param[out] nrm  n unit normals of the interpolated surface, or nullptr
+     * @param[out] inside   n flags, set if the position lies within the terrain as tested by drapePnt, or nullptr
+     * @return number of positions within the terrain
+     */
+    int drapeHeights(int n, const float * wx, const float * wz, float * h, Vector * nrm = nullptr, bool * inside = nullptr) const;
+
+    /**
+     * @brief extractContours Contour lines of the terrain heights, see the marching squares engine in common/contour.h
+     * @param levels    heights of the contours, in increasing order
+     * @param[out] lines    contours with points given as interleaved world x, z coordinates
+     */
+    void extractContours(const std::vector<float> & levels, std::vector<ContourLine> & lines) const;
+
     /// Create a flat terrain
     void test();
 
@@ -386,6 +571,17 @@ public:
        */
     void saveOBJ(const std::string& filename);
 
+    /**
+     * @brief saveMesh  Save the terrain as a triangle mesh with per-vertex normals and texture coordinates, laid out
+     *                  as by saveOBJ. Files ending in .ply are written as binary PLY, others as OBJ, in both cases
+     *                  formatted in parallel and streamed in chunks.
+     * @param filename  file to write
+     * @param maxError  if positive, decimate to an RTIN mesh whose heights stay within about this many metres of the
+     *                  grid, see triangulateGrid; otherwise write two triangles for every grid cell
+     * @retval @c true if the file was written
+     */
+    bool saveMesh(const std::string & filename, float maxError = 0.0f);
+
     /**
        * Save the border of the terrain region to OBJ file.
        * @param filename   File to save (simple ascii elevation format)
@@ -395,10 +591,41 @@ public:
 
     /// Recalculate the mean height over the terrain
     void calcMeanHeight();
+
+    /// Interpolated height at world z = @a x and world x = @a y, clamped to the terrain, see drapeHeights
     float getHeightFromReal(float x, float y);
 
+    /**
+     * @brief calcSlopeMap  Fill a map with the elevation of the surface normal above the horizontal in degrees,
+     *                      that is 90 - slope, which is what the Mitsuba slope masks are thresholded on
+     * @param slopeMap      map resized to match the grid
+     */
     void calcSlopeMap(basic_types::MapFloat *slopeMap);
-    void calcAO(basic_types::MapFloat* slopeMap);
+
+    /**
+     * @brief calcAO    Compute ambient occlusion and sky-view factor by scanning the terrain horizon in a set of
+     *                  evenly spaced directions, at a cost linear in the number of cells per direction
+     * @param aoMap     cosine weighted sky visibility for a horizontal receiver (mean squared cosine of the
+     *                  horizon elevation), in [0,1], resized to match the grid. See sweepHorizon.
+     * @param svfMap    fraction of the sky hemisphere visible (one minus the mean sine of the horizon elevation),
+     *                  in [0,1], resized to match the grid; may be nullptr
+     * @param ndirs     number of horizon directions
+     * @param radius    search distance in metres, or unlimited if <= 0
+     */
+    void calcAO(basic_types::MapFloat * aoMap, basic_types::MapFloat * svfMap = nullptr, int ndirs = 16, float radius = 0.0f);
+
+    /**
+     * @brief calcAOCached  As calcAO, but reuse the maps stored in cachefile if they were computed from the same
+     *                      heights with the same parameters, otherwise compute them and rewrite the cache
+     * @param cachefile     binary cache, normally stored next to the DEM
+     * @retval @c true if the maps were read from the cache
+     * @retval @c false if they were computed
+     */
+    bool calcAOCached(const std::string & cachefile, basic_types::MapFloat * aoMap, basic_types::MapFloat * svfMap,
+                      int ndirs = 16, float radius = 0.0f);
+
+    /// 64-bit hash of the grid dimensions and heights, used to validate derived data caches
+    uint64_t heightHash() const;
 
     /// PCM - build new terrain from sub-region -
     /// calling function must assume responsibility for memory
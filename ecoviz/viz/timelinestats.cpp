@@ -0,0 +1,207 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+
+#include "timelinestats.h"
+#include "vecpnt.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+void TimelineStats::build(const CohortMaps & cmaps, int timesteps, int species, std::function<bool(const basic_tree &)> keepMature)
+{
+    ntimesteps = std::max(timesteps, 0);
+    nspecies = std::max(species, 0);
+    metrics.assign((long) ntimesteps * nspecies * NumMetrics, 0.0);
+    dbhHist.assign((long) ntimesteps * nspecies * dbhBins, 0.0);
+
+    // bins start at the size of a cohort cell and grow until the tables fit the budget
+    float rw = 0.0f, rh = 0.0f;
+    int cgw = 0, cgh = 0;
+    if(ntimesteps > 0)
+    {
+        cmaps.get_map(0).getDimReal(rw, rh);
+        cmaps.get_map(0).getDim(cgw, cgh);
+    }
+    if(ntimesteps > 0 && nspecies > 0 && cgw > 0 && cgh > 0 && rw > 0.0f && rh > 0.0f)
+    {
+        double slices = (double) ntimesteps * nspecies * NumMetrics;
+        double scale = std::max(1.0, std::sqrt(slices * cgw * cgh / (double) satBudget));
+        do
+        {
+            bw = std::max(1, (int) std::ceil(cgw / scale));
+            bh = std::max(1, (int) std::ceil(cgh / scale));
+            scale *= 1.05;
+        }
+        while(slices * (bw+1) * (bh+1) > (double) satBudget && (bw > 1 || bh > 1));
+        binw = rw / (float) bw;
+        binh = rh / (float) bh;
+        sat.assign((long) slices * (bw+1) * (bh+1), 0.0);
+    }
+    else
+    {
+        bw = bh = 0;
+        binw = binh = 0.0f;
+        sat.clear();
+    }
+
+    // timesteps write disjoint slices, so need no synchronisation
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int t = 0; t < ntimesteps; t++)
+    {
+        // add n trees of the given species and size, located at (x, y)
+        auto accumulate = [this, t](int spc, double n, float dbh, float x, float y)
+        {
+            if(spc < 0 || spc >= nspecies)
+                return;
+            double ba = n * PI * dbh * dbh / 4.0 / 10000.0; // dbh is in cm, need to convert to m
+            double * m = &metrics[idx(t, spc) * NumMetrics];
+            m[Stems] += n;
+            m[DBHSum] += n * dbh;
+            m[BasalArea] += ba;
+            dbhHist[idx(t, spc) * dbhBins + dbhBin(dbh)] += n;
+
+            if(!sat.empty())
+            {
+                // binned one entry past the bin, so that a running sum turns the table into a summed-area table
+                int bx = std::min(std::max((int) std::floor(x / binw), 0), bw-1) + 1;
+                int by = std::min(std::max((int) std::floor(y / binh), 0), bh-1) + 1;
+                long off = (long) by * (bw+1) + bx;
+                sat[satBase(t, spc, Stems) + off] += n;
+                sat[satBase(t, spc, DBHSum) + off] += n * dbh;
+                sat[satBase(t, spc, BasalArea) + off] += ba;
+            }
+        };
+
+        // each cohort stands for a whole number of identical trees, matching what the cohort sampler places
+        const ValueGridMap<std::vector<data_importer::ilanddata::cohort> > & cmap = cmaps.get_map(t);
+        int cgw, cgh;
+        cmap.getDim(cgw, cgh);
+        for(int cidx = 0; cidx < cgw * cgh; cidx++)
+            for(const auto & crt: cmap.get(cidx))
+            {
+                int n = int(crt.nplants + 1e-3f);
+                if(n > 0)
+                {
+                    xy<float> middle = crt.get_middle();
+                    accumulate(crt.specidx % 64, (double) n, crt.dbh, middle.x, middle.y);
+                }
+            }
+
+        for(const auto & tree: cmaps.get_maturetrees(t))
+            if(keepMature(tree))
+                accumulate(tree.species, 1.0, tree.dbh, tree.x, tree.y);
+
+        // running sums along rows and then columns
+        if(!sat.empty())
+        {
+            std::vector<double> col(bw+1);
+            for(int spc = 0; spc < nspecies; spc++)
+                for(int m = 0; m < NumMetrics; m++)
+                {
+                    double * s = &sat[satBase(t, spc, (Metric) m)];
+                    std::fill(col.begin(), col.end(), 0.0);
+                    for(int j = 1; j <= bh; j++)
+                    {
+                        double row = 0.0;
+                        for(int i = 1; i <= bw; i++)
+                        {
+                            row += s[(long) j * (bw+1) + i];
+                            col[i] += row;
+                            s[(long) j * (bw+1) + i] = col[i];
+                        }
+                    }
+                }
+        }
+    }
+}
+
+void TimelineStats::clear()
+{
+    ntimesteps = nspecies = bw = bh = 0;
+    binw = binh = 0.0f;
+    metrics.clear();
+    dbhHist.clear();
+    sat.clear();
+}
+
+float TimelineStats::get(Metric m, int t, int species) const
+{
+    if(t < 0 || t >= ntimesteps || species < 0 || species >= nspecies || m < 0 || m >= NumMetrics)
+    {
+        cerr << "Error TimelineStats::get: out of bounds" << endl;
+        return 0.0f;
+    }
+    return (float) metrics[idx(t, species) * NumMetrics + m];
+}
+
+float TimelineStats::getTotal(Metric m, int t) const
+{
+    double tot = 0.0;
+    for(int s = 0; s < nspecies; s++)
+        tot += get(m, t, s);
+    return (float) tot;
+}
+
+double TimelineStats::satAt(long base, float u, float v) const
+{
+    u = std::min(std::max(u, 0.0f), (float) bw);
+    v = std::min(std::max(v, 0.0f), (float) bh);
+    int i = std::min((int) u, bw-1), j = std::min((int) v, bh-1);
+    double fu = u - (float) i, fv = v - (float) j;
+    const double * s = &sat[base + (long) j * (bw+1) + i];
+    double lo = s[0] + fu * (s[1] - s[0]);
+    double hi = s[bw+1] + fu * (s[bw+2] - s[bw+1]);
+    return lo + fv * (hi - lo);
+}
+
+float TimelineStats::getInRect(Metric m, int t, int species, float x0, float y0, float x1, float y1) const
+{
+    if(t < 0 || t >= ntimesteps || species < 0 || species >= nspecies || m < 0 || m >= NumMetrics)
+    {
+        cerr << "Error TimelineStats::getInRect: out of bounds" << endl;
+        return 0.0f;
+    }
+    if(sat.empty() || x1 <= x0 || y1 <= y0)
+        return 0.0f;
+
+    long base = satBase(t, species, m);
+    float u0 = x0 / binw, u1 = x1 / binw, v0 = y0 / binh, v1 = y1 / binh;
+    double val = satAt(base, u1, v1) - satAt(base, u0, v1) - satAt(base, u1, v0) + satAt(base, u0, v0);
+    return (float) std::max(val, 0.0);
+}
+
+float TimelineStats::getDBHCount(int t, int species, int bin) const
+{
+    if(t < 0 || t >= ntimesteps || species < 0 || species >= nspecies || bin < 0 || bin >= dbhBins)
+    {
+        cerr << "Error TimelineStats::getDBHCount: out of bounds" << endl;
+        return 0.0f;
+    }
+    return (float) dbhHist[idx(t, species) * dbhBins + bin];
+}
+
+int TimelineStats::dbhBin(float dbh)
+{
+    int bin = (int) (dbh / dbhBinWidth);
+    return std::min(std::max(bin, 0), dbhBins - 1);
+}
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ *
+ * EcoViz -  a tool for visual analysis and photo‐realistic rendering of forest
+ * landscape model simulations
+ * Copyright (C) 2025  J.E. Gain  (jgain@cs.uct.ac.za)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ********************************************************************************/
+/**
+ * @file
+ *
+ * Per species and timestep stand statistics gathered in a single pass over the cohort maps, for the whole landscape
+ * and, through summed-area tables, for any rectangle of it.
+ */
+
+#ifndef TIMELINESTATS_H
+#define TIMELINESTATS_H
+
+#include <vector>
+#include <functional>
+#include "cohortmaps.h"
+
+class TimelineStats
+{
+public:
+
+    enum Metric
+    {
+        Stems,          //< number of trees
+        BasalArea,      //< summed stem cross-section at breast height, in m^2
+        DBHSum,         //< summed diameter at breast height, in cm
+        NumMetrics
+    };
+
+    static const int dbhBins = 20;              //< number of DBH histogram bins, the last open-ended
+    static constexpr float dbhBinWidth = 5.0f;  //< width of each DBH histogram bin, in cm
+    static const long satBudget = 1L << 24;     //< most summed-area table entries held over all timesteps and species, 8 bytes each
+
+private:
+    int ntimesteps, nspecies;
+    std::vector<double> metrics;    //< NumMetrics values for each species and timestep
+    std::vector<double> dbhHist;    //< dbhBins tree counts for each species and timestep
+    int bw, bh;                     //< number of summed-area table bins in x and y
+    float binw, binh;               //< extent of a bin in cohort coordinates
+    std::vector<double> sat;        //< (bw+1) x (bh+1) summed-area table for each metric, species and timestep
+
+    inline long idx(int t, int species) const { return (long) t * nspecies + species; }
+
+    /// first entry of the summed-area table for a metric, species and timestep, with entry (i, j) at [j * (bw+1) + i]
+    inline long satBase(int t, int species, Metric m) const { return (idx(t, species) * NumMetrics + m) * (long) (bw+1) * (bh+1); }
+
+    /// summed-area table value at a point in bin units, interpolated bilinearly as if values were spread evenly over each bin
+    double satAt(long base, float u, float v) const;
+
+public:
+
+    TimelineStats(){ ntimesteps = nspecies = bw = bh = 0; binw = binh = 0.0f; }
+
+    /**
+     * @brief build Gather statistics for every timestep from the cohorts, each standing for nplants identical
+     *              trees, and the mature trees. Timesteps are processed in parallel. Values are also binned by
+     *              location into summed-area tables, with bins no finer than a cohort cell and coarsened as needed
+     *              to hold the tables within satBudget entries.
+     * @param cmaps         cohort and mature tree data
+     * @param timesteps     number of timesteps to gather
+     * @param species       number of species, higher species indices are ignored
+     * @param keepMature    returns whether a mature tree counts towards the statistics
+     */
+    void build(const CohortMaps & cmaps, int timesteps, int species, std::function<bool(const basic_tree &)> keepMature);
+
+    /// clear all statistics
+    void clear();
+
+    /// whether statistics have been gathered
+    bool isValid() const { return ntimesteps > 0; }
+
+    int getNumTimesteps() const { return ntimesteps; }
+    int getNumSpecies() const { return nspecies; }
+
+    /// value of metric @a m for a species at timestep @a t
+    float get(Metric m, int t, int species) const;
+
+    /// value of metric @a m summed over all species at timestep @a t
+    float getTotal(Metric m, int t) const;
+
+    /**
+     * @brief getInRect Value of metric @a m for a species at timestep @a t over a rectangle of the landscape,
+     *                  in constant time. Values within a bin are taken to be spread evenly over it, so rectangles
+     *                  that do not follow bin boundaries are approximate. Where the tables were coarsened to fit
+     *                  satBudget a bin spans several cohort cells, and the value is interpolated rather than exact.
+     *                  The tables are held in double precision, since the value is a difference of prefix sums
+     *                  over the whole landscape.
+     * @param x0, y0    lower corner in cohort coordinates (as for tree positions)
+     * @param x1, y1    upper corner in cohort coordinates
+     */
+    float getInRect(Metric m, int t, int species, float x0, float y0, float x1, float y1) const;
+
+    /// number of trees of a species at timestep @a t falling in DBH histogram bin @a bin
+    float getDBHCount(int t, int species, int bin) const;
+
+    /// DBH histogram bin for diameter @a dbh, in cm
+    static int dbhBin(float dbh);
+};
+
+#endif
@@ -216,16 +216,13 @@ void TimeWindow::updateScene(int t)
 
 void TimeWindow::updateSingleScene(int t)
 {
-     // auto bt_master = std::chrono::steady_clock::now().time_since_epoch();
      set_labelvalue(t, scene->getTimeline()->getTimeEnd());
      scene->getTimeline()->setNow(t);
      int curr_cohortmap = scene->getTimeline()->getCurrentIdx();
      if (curr_cohortmap >= scene->cohortmaps->get_nmaps())
          curr_cohortmap = scene->cohortmaps->get_nmaps() - 1;
 
-     // auto bt_sample = std::chrono::steady_clock::now().time_since_epoch();
      std::vector<basic_tree> trees(scene->sampler->sample(scene->cohortmaps->get_map(curr_cohortmap), nullptr));
-     // auto et_sample = std::chrono::steady_clock::now().time_since_epoch();
      std::vector<basic_tree> mature = scene->cohortmaps->get_maturetrees(curr_cohortmap);
 
      for(auto &tree: mature)
@@ -238,25 +235,13 @@ void TimeWindow::updateSingleScene(int t)
              cerr << "tree out of bounds at (" << tree.x << ", " << tree.y << ")" << endl;
      }
 
-     // auto bt_render = std::chrono::steady_clock::now().time_since_epoch();
-     scene->getEcoSys()->clear();
-     scene->getEcoSys()->placeManyPlants(scene->getMasterTerrain(), scene->getNoiseField(), scene->cohortmaps, trees);
+     // apply only births, deaths and size changes relative to the previously displayed timestep
+     int births, deaths, updates;
+     scene->getEcoSys()->updatePlants(scene->getMasterTerrain(), scene->getNoiseField(), scene->cohortmaps, trees,
+                                      births, deaths, updates);
+     winparent->getScheduler()->countStep(births, deaths, updates);
      signalRebindPlants();
      winparent->rendercount++;
      signalRepaintAllGL();
      // update(); // JG should not be needed because of RepaintAllGL immediately above
-     // auto et_render = std::chrono::steady_clock::now().time_since_epoch();
-
-     // std::cout << "Timestep changed to " << tstep << std::endl;
-     // auto et_master = std::chrono::steady_clock::now().time_since_epoch();
-
-     // int sampletime = std::chrono::duration_cast<std::chrono::milliseconds>(et_sample - bt_sample).count();
-     // int rendertime = std::chrono::duration_cast<std::chrono::milliseconds>(et_render - bt_render).count();
-     // int overalltime = std::chrono::duration_cast<std::chrono::milliseconds>(et_master - bt_master).count();
-
-     // std::cout << "Number of plants: " << trees.size() << std::endl;
-     // std::cout << "Overall time: " << overalltime << std::endl;
-     // std::cout << "Sample time: " << sampletime << std::endl;
-     // std::cout << "Render time: " << rendertime << std::endl;
-
  }
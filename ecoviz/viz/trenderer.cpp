@@ -31,10 +31,36 @@ namespace PMrender {
 
   // create and update heightmap texture
 
-// this sets the heightmap texture; if dimensions have changed, mesh+normals are rebuilt
-// if force == draw, then we a rebuild will take place - use to manage changed data from synthesis
+  // textures released by shared heightmaps while no context was current
+  static std::vector<GLuint> orphanedHeightmaps;
 
-  void TRenderer::updateHeightMap(int wd, int ht, float scx, float scy, float* data, bool force)
+  // renderer whose complete set of textures is bound to the texture units of each context, if known
+  static std::map<QOpenGLContext *, const TRenderer *> texturesBoundBy;
+
+  SharedHeightMap::~SharedHeightMap()
+  {
+    if (texture == 0)
+        return;
+    QOpenGLContext * ctx = QOpenGLContext::currentContext();
+    if (ctx != nullptr)
+        ctx->functions()->glDeleteTextures(1, &texture);
+    else
+        orphanedHeightmaps.push_back(texture);
+  }
+
+  void SharedHeightMap::releaseOrphans(void)
+  {
+    if (orphanedHeightmaps.empty())
+        return;
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glDeleteTextures((GLsizei) orphanedHeightmaps.size(), orphanedHeightmaps.data()); CE();
+    orphanedHeightmaps.clear();
+  }
+
+// this binds the shared heightmap texture, uploading new height data if no other renderer has done so already;
+// if the terrain, its dimensions or its data have changed, mesh+normals are rebuilt
+
+  void TRenderer::updateHeightMap(int wd, int ht, float scx, float scy, const float* data, std::shared_ptr<SharedHeightMap> shared, long revision)
   {
     if (data == NULL)
       {
@@ -46,48 +72,56 @@ namespace PMrender {
 
     assert(wd != 0 && ht != 0);
 
-    if (width == wd && height == ht && !force) // nothing to do - make sure binding is intact
+    SharedHeightMap::releaseOrphans();
+
+    if (shared->revision != revision || shared->texture == 0) // first renderer to see this data uploads it
       {
-        //std::cerr << "rebind heightmap texture\n";
-        if (heightmapTexture == 0)
-        {
-             std::cerr << "Error! Heighmap texture undefined!\n";
+        // if grid dimensions have changed:
+        if(shared->texture != 0 && (shared->width != wd || shared->height != ht))
+          {
+            // std::cerr << "- Delete texture\n";
+            f->glDeleteTextures(1, &shared->texture);  CE();
+            shared->texture = 0;
           }
-        f->glActiveTexture(htmapTexUnit); CE();
-        f->glBindTexture(GL_TEXTURE_2D, heightmapTexture); CE();
-        return;
-      }
 
-    // if grid dimensions have changed:
-    if(heightmapTexture != 0 && (width != wd || height != ht))
-      {
-        // std::cerr << "- Delete texture\n";
-        f->glDeleteTextures(1, &heightmapTexture);  CE();
-        heightmapTexture = 0;
+        if (shared->texture == 0) // create texture if it does not exist
+          {
+            // std::cerr << "- Create heightmap texture: wd = " << wd << "; ht = " << ht << "\n";
+            f->glGenTextures(1, &shared->texture); CE();
+            f->glActiveTexture(htmapTexUnit); CE();
+            f->glBindTexture(GL_TEXTURE_2D, shared->texture ); CE();
+
+            f->glTexImage2D(GL_TEXTURE_2D, 0,GL_R32F, wd, ht, 0,GL_RED, GL_FLOAT,  (const GLfloat*)data); CE();
+            // no filtering
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); CE();
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); CE();
+            // deal with out of array access
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+            shared->width = wd;
+            shared->height = ht;
+          }
+        else // otherwise sub in new texture data
+          {
+            // std::cerr << " - sub texture\n";
+            f->glActiveTexture(htmapTexUnit); CE();
+            f->glBindTexture(GL_TEXTURE_2D, shared->texture ); CE();
+            f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, wd, ht, GL_RED, GL_FLOAT, (const GLfloat*)data); CE();
+          }
+        shared->revision = revision;
+        f->glFlush(); // make the new contents visible to the other contexts in the share group
       }
 
-    if (heightmapTexture == 0) // create texture if it does not exist
-      {
-        // std::cerr << "- Create heightmap texture: wd = " << wd << "; ht = " << ht << "\n";
-        f->glGenTextures(1, &heightmapTexture); CE();
-        f->glActiveTexture(htmapTexUnit); CE();
-        f->glBindTexture(GL_TEXTURE_2D, heightmapTexture ); CE();
-
-        f->glTexImage2D(GL_TEXTURE_2D, 0,GL_R32F, wd, ht, 0,GL_RED, GL_FLOAT,  (GLfloat*)data); CE();
-        // no filtering
-        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); CE();
-        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); CE();
-        // deal with out of array access
-        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-      }
-    else // otherwise sub in new texture data
-      {
-        // std::cerr << " - sub texture\n";
-        f->glActiveTexture(htmapTexUnit); CE();
-        f->glBindTexture(GL_TEXTURE_2D, heightmapTexture ); CE();
-        f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, wd, ht, GL_RED, GL_FLOAT, (GLfloat*)data); CE();
-      }
+    bool sameTerrain = (heightmapShare == shared);
+    heightmapShare = shared; // releases the heightmap of a previously drawn terrain
+    heightmapTexture = shared->texture;
+
+    f->glActiveTexture(htmapTexUnit); CE();
+    f->glBindTexture(GL_TEXTURE_2D, heightmapTexture); CE();
+    noteTextureBinding();
+
+    if (sameTerrain && width == wd && height == ht && heightmapRevision == revision) // nothing else to do
+        return;
 
     // test all values for lowest terrain height:
     terrainBase = 1000000.0; // +infinity
@@ -101,6 +135,7 @@ namespace PMrender {
     height = ht;
     scalex = scx;
     scaley = scy;
+    heightmapRevision = revision;
 
     // rebuild VAO and everything else if this was first image or new
     // dimensions or data in heightmap has changed
@@ -705,7 +740,7 @@ void TRenderer::generateNormalTexture(void)
  // ******* Radiance Scaling setup **************
   // rebuild buffer for viewport of vWd X vHt size
 
-  bool TRenderer::initRadianceScalingBuffers(int vWd, int vHt)
+  bool TRenderer::initRadianceScalingBuffers(int vWd, int vHt, int samples)
   {
 
       size_t numBytesOnGPU = 0;
@@ -713,6 +748,7 @@ void TRenderer::generateNormalTexture(void)
     // get viewport size - every time this changes we'll have to rebuild the textures
     _w = vWd;
     _h = vHt;
+    _samples = samples;
 
     // std::cerr << " -- initRadianceScalingBuffers - rebuilding radScaling textures/FBOs with w = " << _w << " and h = " << _h << std::endl;
 
@@ -730,8 +766,9 @@ void TRenderer::generateNormalTexture(void)
     f->glBindTexture(GL_TEXTURE_2D, destTexture); CE();
     // - Give an empty image to OpenGL ( the last "0" )
     f->glTexImage2D(GL_TEXTURE_2D, 0,GL_RGBA8, _w, _h, 0,GL_RGBA, GL_UNSIGNED_BYTE, 0); CE();
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); CE();
-    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); CE();
+    // linear filtering, since the FXAA pass samples between texels
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); CE();
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); CE();
     f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); CE();
     f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); CE();
 
@@ -902,20 +939,125 @@ void TRenderer::generateNormalTexture(void)
     f->glBindFramebuffer(GL_FRAMEBUFFER,  0); CE();
 
     // std::cout << " -- initRadianceScalingBuffers -- " << numBytesOnGPU/1024.0/1024.0 << " MB on GPU\n";
+    if (samples > 0)
+        return initMultisampleBuffers(samples);
     return true;
   }
 
+  // multisampled counterparts of fboRadScaling and fboManipLayer with the same attachment layout, so the pass 1
+  // shaders write to them unchanged. Renderbuffers suffice since they are only read by resolving into the textures.
+
+  bool TRenderer::initMultisampleBuffers(int samples)
+  {
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+    GLenum formats[6] = {GL_DEPTH_COMPONENT24, GL_RGBA16F, GL_RGBA16F, GL_RGBA8, GL_DEPTH_COMPONENT24, GL_RGBA8};
+
+    f->glGenRenderbuffers(6, msRenderbuffers); CE();
+    for (int i = 0; i < 6; i++)
+    {
+        f->glBindRenderbuffer(GL_RENDERBUFFER, msRenderbuffers[i]); CE();
+        ef->glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, formats[i], _w, _h); CE();
+    }
+    f->glBindRenderbuffer(GL_RENDERBUFFER, 0); CE();
+
+    // terrain and plants: depth, gradient, normal and colour
+    f->glGenFramebuffers(1, &fboRSMultisample); CE();
+    f->glBindFramebuffer(GL_FRAMEBUFFER, fboRSMultisample); CE();
+    f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, msRenderbuffers[0]); CE();
+    for (int i = 0; i < 3; i++)
+        f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+i, GL_RENDERBUFFER, msRenderbuffers[1+i]); CE();
+
+    GLenum DrawBuffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    ef->glDrawBuffers(3, DrawBuffers);  CE();
+
+    if(f->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "RS FBO (multisample) - initialisation: failed\n";
+        return false;
+    }
+
+    // manipulator transparency layer: depth and colour
+    f->glGenFramebuffers(1, &fboManipMultisample); CE();
+    f->glBindFramebuffer(GL_FRAMEBUFFER, fboManipMultisample); CE();
+    f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, msRenderbuffers[4]); CE();
+    f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, msRenderbuffers[5]); CE();
+
+    GLenum mDrawBuffers[1] = {GL_COLOR_ATTACHMENT0};
+    ef->glDrawBuffers(1, mDrawBuffers);  CE();
+
+    if(f->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "manip FBO (multisample) - initialisation: failed\n";
+        return false;
+    }
+
+    f->glBindFramebuffer(GL_FRAMEBUFFER,  0); CE();
+    return true;
+  }
+
+  // resolve the multisampled renders into the single sample textures read by radiance scaling pass 2.
+  // Each colour attachment is blitted separately, since a blit writes one read buffer to every draw buffer.
+
+  void TRenderer::resolveMultisampleBuffers(void)
+  {
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, fboRSMultisample); CE();
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fboRadScaling); CE();
+    for (int i = 0; i < 3; i++)
+    {
+        GLenum bufs[3] = {GL_NONE, GL_NONE, GL_NONE};
+        bufs[i] = GL_COLOR_ATTACHMENT0 + i;
+        ef->glReadBuffer(bufs[i]); CE();
+        ef->glDrawBuffers(3, bufs); CE();
+        ef->glBlitFramebuffer(0, 0, _w, _h, 0, 0, _w, _h, GL_COLOR_BUFFER_BIT, GL_NEAREST); CE();
+    }
+    GLenum DrawBuffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    ef->glDrawBuffers(3, DrawBuffers); CE();
+    ef->glReadBuffer(GL_COLOR_ATTACHMENT0); CE();
+
+    // pass 2 also reads the manipulator depth, so resolve that along with the colour
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, fboManipMultisample); CE();
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fboManipLayer); CE();
+    ef->glBlitFramebuffer(0, 0, _w, _h, 0, 0, _w, _h, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST); CE();
+
+    f->glBindFramebuffer(GL_FRAMEBUFFER, 0); CE();
+  }
+
+  void TRenderer::renderTargetSize(int vwd, int vht, int &rwd, int &rht, int &samples)
+  {
+    float scale = 1.0f;
+
+    samples = 0;
+    if (interacting)
+        scale = interactionScale;
+    else if (quality == SUPERSAMPLE_2X)
+        scale = 2.0f;
+    else if (quality == MSAA)
+    {
+        GLint maxSamples = 0;
+        QOpenGLContext::currentContext()->functions()->glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+        samples = std::min(4, (int) maxSamples);
+        if (samples < 2) // no multisampling available
+            samples = 0;
+    }
+    rwd = std::max(1, (int) (scale * vwd + 0.5f));
+    rht = std::max(1, (int) (scale * vht + 0.5f));
+  }
+
   // update radiance scaling FBO textures/attachments if viewport has changed size
   // vwd and vht are current viewport width and height, resp.
   // render conext
 
-  void TRenderer::updateRadianceScalingBuffers(int vwd, int vht, bool force)
+  void TRenderer::updateRadianceScalingBuffers(int vwd, int vht, int samples, bool force)
   {
     if (shadModel != RADIANCE_SCALING && shadModel != RADIANCE_SCALING_TRANSECT &&
             shadModel != RADIANCE_SCALING_OVERVIEW)
       return;
 
-    if (_w == 0 || _h == 0 || vwd != _w || vht != _h || force)
+    if (_w == 0 || _h == 0 || vwd != _w || vht != _h || samples != _samples || force)
       {
         // std::cerr << "Delete old rad scaling buffer\n";
 
@@ -923,7 +1065,8 @@ void TRenderer::generateNormalTexture(void)
         deleteFBOrscalingBuffers();
 
         //std::cerr << "Calling Rad scaling...\n";
-        initRadianceScalingBuffers(vwd, vht);
+        initRadianceScalingBuffers(vwd, vht, samples);
+        noteTextureBinding();
         //std::cerr << "Done\n";
       }
   }
@@ -945,12 +1088,22 @@ void TRenderer::initInstanceData(void)
       typeMapTexture = 0;
       constraintTexture = 0;
       heightmapTexture = 0;
+      heightmapRevision = -1;
+      typeMapSource[PAINT] = typeMapSource[CONSTRAINT] = nullptr;
+      typeMapRevision[PAINT] = typeMapRevision[CONSTRAINT] = -1;
+      typeMapWidth[PAINT] = typeMapWidth[CONSTRAINT] = 0;
+      typeMapHeight[PAINT] = typeMapHeight[CONSTRAINT] = 0;
       decalTexture = 0;
       vboScreenQuad = 0;
+      vaoScreenLines = vboScreenLines = 0;
       fboRadScaling = 0;
       fboRSOutput = 0;
       fboManipLayer = 0;
+      fboRSMultisample = fboManipMultisample = 0;
+      for (int i = 0; i < 6; i++)
+          msRenderbuffers[i] = 0;
       typeBuffer = NULL;
+      typeBufferCells = 0;
 
       // texture units reserved for rendering:
       htmapTexUnit = GL_TEXTURE0;
@@ -969,6 +1122,7 @@ void TRenderer::initInstanceData(void)
       scalex = scaley = 0.0f;
       indexSize = 0;
       _w = _h = 0;
+      _samples = 0;
       terrainBase = 1000000.0; // +infinity (well kind of ...)
 
      // default colours
@@ -1046,6 +1200,12 @@ TRenderer::TRenderer(QOpenGLWidget *drawTo, const std::string& dir)
   RSinvertCurvature = false;
   RStransition = 0.2f;
   RSenhance = 0.5f;
+
+  // render quality - views choose their own, see setRenderQuality
+  quality = SUPERSAMPLE_2X;
+  interactionScale = 0.5f;
+  interacting = false;
+  outputFBO = 0;
   initInstanceData();
 }
 
@@ -1061,6 +1221,9 @@ void TRenderer::deleteTerrainOpenGLbuffers(void)
     if (fboNormalMap != 0) f->glDeleteFramebuffers(1, &fboNormalMap);  CE();
     if (vaoScreenQuad != 0) ef->glDeleteVertexArrays(1, &vaoScreenQuad);  CE();
     if (vboScreenQuad != 0) f->glDeleteBuffers(1, &vboScreenQuad);  CE();
+    if (vaoScreenLines != 0) ef->glDeleteVertexArrays(1, &vaoScreenLines);  CE();
+    if (vboScreenLines != 0) f->glDeleteBuffers(1, &vboScreenLines);  CE();
+    vaoScreenLines = vboScreenLines = 0;
 
     for (int i = 0; i < 5; i++)
     {
@@ -1086,6 +1249,14 @@ void TRenderer::deleteTerrainOpenGLbuffers(void)
     if (fboRadScaling != 0) f->glDeleteFramebuffers(1, &fboRadScaling);  CE();
     if (fboRSOutput != 0) f->glDeleteFramebuffers(1, &fboRSOutput); CE();
     if (fboManipLayer != 0) f->glDeleteFramebuffers(1, &fboManipLayer); CE();
+
+    // multisampled stand-ins, zeroed since they are not recreated for single sample renders
+    if (fboRSMultisample != 0) f->glDeleteFramebuffers(1, &fboRSMultisample); CE();
+    if (fboManipMultisample != 0) f->glDeleteFramebuffers(1, &fboManipMultisample); CE();
+    if (msRenderbuffers[0] != 0) f->glDeleteRenderbuffers(6, msRenderbuffers); CE();
+    fboRSMultisample = fboManipMultisample = 0;
+    for (int i = 0; i < 6; i++)
+        msRenderbuffers[i] = 0;
   }
 
 void TRenderer::destroyInstanceData(void)
@@ -1094,7 +1265,8 @@ void TRenderer::destroyInstanceData(void)
 
     QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
     if (typeMapTexture != 0)  f->glDeleteTextures(1, &typeMapTexture);  CE();
-    if (heightmapTexture != 0)	f->glDeleteTextures(1, &heightmapTexture);  CE();
+    heightmapShare.reset(); // the texture is deleted with the last renderer or terrain using it
+    heightmapTexture = 0;
     if (constraintTexture != 0) f->glDeleteTextures(1, &constraintTexture);  CE();
 
     deleteTerrainOpenGLbuffers();
@@ -1116,6 +1288,11 @@ TRenderer::~TRenderer()
   {       delete (*it).second; it++; }
 
   destroyInstanceData();
+
+  // forget our texture bindings, so that a renderer later allocated at this address does not assume them
+  for (auto &bound: texturesBoundBy)
+      if (bound.second == this)
+          bound.second = nullptr;
 }
 
 // load in a new heightfield with accompanying terrain type map.
@@ -1156,15 +1333,11 @@ void TRenderer::updateTypeMapTexture(TypeMap* tmap, typeMapInfo tinfo, bool forc
       return;
     }
 
-  Region R = tmap->getRegion();
   int    wd = tm->width();
   int    ht = tm->height();
   const int* ptr = (int*)tm->getPtr();
   std::vector<GLfloat *> *ct = tmap->getColourTable();
-  int Rwidth  = R.x1 - R.x0; // region bounds from [R.x0, R.x1)
-  int Rheight = R.y1 - R.y0;
-  int xoff = R.x0;
-  int yoff = R.y0;
+  std::vector<Region> regions;
   int index;
 
   bool initTexture = false;
@@ -1200,9 +1373,17 @@ void TRenderer::updateTypeMapTexture(TypeMap* tmap, typeMapInfo tinfo, bool forc
 
    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
    f->glActiveTexture(texUnit); CE();
+   noteTextureBinding();
+
+   // nothing to upload if the texture already holds the current contents of this map
+   if(*texId != 0 && !force && typeMapSource[tinfo] == tmap && typeMapRevision[tinfo] == tmap->getRevision())
+   {
+       f->glBindTexture(GL_TEXTURE_2D, *texId); CE();
+       return;
+   }
 
     // if grid dimensions have changed:
-    if(*texId != 0 && force)
+    if(*texId != 0 && (force || typeMapWidth[tinfo] != wd || typeMapHeight[tinfo] != ht))
     {
         /*
         cerr << "tmap = " << wd << ", " << ht << endl;
@@ -1217,9 +1398,13 @@ void TRenderer::updateTypeMapTexture(TypeMap* tmap, typeMapInfo tinfo, bool forc
       // allocate subbuffer: this is used to avoid mem allocation each time this method is called (frequently)
 
       //std::cout << "Region: " << R.x0 << "," << R.y0 << "," << R.x1 << "," << R.y1 << "\n";
-      if(typeBuffer != NULL)
-          delete [] typeBuffer;
-      typeBuffer = new GLfloat [width*height*4];
+      if(typeBufferCells < wd*ht)
+        {
+          if(typeBuffer != NULL)
+              delete [] typeBuffer;
+          typeBuffer = new GLfloat [wd*ht*4];
+          typeBufferCells = wd*ht;
+        }
       if (typeBuffer == NULL)
         {
           std::cerr << "TRenderer::updateTypeMapTexture - typeBuffer could not be allocated\n";
@@ -1233,60 +1418,77 @@ void TRenderer::updateTypeMapTexture(TypeMap* tmap, typeMapInfo tinfo, bool forc
       f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
       f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
       initTexture = true;
-      xoff = yoff = 0;
-      Rwidth = wd;
-      Rheight = ht; // copy in whole buffer region, not sub-window
+      typeMapWidth[tinfo] = wd;
+      typeMapHeight[tinfo] = ht;
+      regions.push_back(Region(0, 0, wd, ht)); // copy in whole buffer region, not sub-window
     }
-  else // need to sub in region - bind texture first
+  else // need to sub in regions - bind texture first
     {
       f->glBindTexture(GL_TEXTURE_2D, *texId); CE();
+      if (typeMapSource[tinfo] != tmap) // a different map must be copied in whole, not just its changes
+          regions.push_back(Region(0, 0, wd, ht));
+      else
+          tmap->changedSince(typeMapRevision[tinfo], regions);
     }
 
-  // build colour buffer for texture:
+  for (auto &R: regions)
+  {
+    int Rwidth  = R.x1 - R.x0; // region bounds from [R.x0, R.x1)
+    int Rheight = R.y1 - R.y0;
+    int xoff = R.x0;
+    int yoff = R.y0;
 
-  int cnt = 0;
-  int colIdx;
-  //std::cout << "Width, Height = " << Rwidth << "," << Rheight << std::endl;
-  for (int i = 0; i < Rheight; i++)
-    for (int j = 0; j < Rwidth; j++)
-    {
-      index = (yoff + i)*wd + (xoff + j);
-        colIdx = ptr[index];
-      if (colIdx == 0 && tinfo != CONSTRAINT) // background should be used - use terMatDiffuse; for CONSTRAINT, ignore
-        {
-          //std::cout << "BG col at [" << i << "," << j << "]\n";
-          //std::cout << "Ter Colour=[" << terMatDiffuse[0] << "," <<
-          //  terMatDiffuse[1] << "," << terMatDiffuse[2] << "," << terMatDiffuse[3] << "]\n";
-          typeBuffer[4*cnt]   = terMatDiffuse[0];
-          typeBuffer[4*cnt+1] = terMatDiffuse[1];
-          typeBuffer[4*cnt+2] = terMatDiffuse[2];
-          typeBuffer[4*cnt+3] = terMatDiffuse[3];
-        }
-      else
-        {
-          typeBuffer[4*cnt]   = (*ct)[ colIdx ][0];
-          typeBuffer[4*cnt+1] = (*ct)[ colIdx ][1];
-          typeBuffer[4*cnt+2] = (*ct)[ colIdx ][2];
-          typeBuffer[4*cnt+3] = (*ct)[ colIdx ][3];
+    if (Rwidth <= 0 || Rheight <= 0)
+        continue;
 
-          //std::cout << "Map Colour=[" << typeBuffer[4*cnt] << "," <<
-          //typeBuffer[4*cnt + 1] << "," << typeBuffer[4*cnt + 2] << "," << typeBuffer[4*cnt + 3] << "]";
-          //std::cout << " (with colIdx = " << colIdx << " at location " << (xoff + j) << ", " << (yoff + i) << std::endl;
+    // build colour buffer for texture:
 
-        }
-      cnt++;
-    }
-  //std::cout << "Buffer built...\n";
-  if (initTexture)
-    {
-      //std::cout << "Overlay texture created at full resolution\n";
-       f->glTexImage2D(GL_TEXTURE_2D, 0,GL_RGBA8, Rwidth, Rheight, 0,GL_RGBA, GL_FLOAT, typeBuffer); CE();
-    }
-  else
-    {
-      //std::cout << "Overlay textured sub'd\n";
-      f->glTexSubImage2D(GL_TEXTURE_2D, 0, xoff, yoff, Rwidth, Rheight, GL_RGBA, GL_FLOAT, typeBuffer); CE();
-    }
+    int cnt = 0;
+    int colIdx;
+    //std::cout << "Width, Height = " << Rwidth << "," << Rheight << std::endl;
+    for (int i = 0; i < Rheight; i++)
+      for (int j = 0; j < Rwidth; j++)
+      {
+        index = (yoff + i)*wd + (xoff + j);
+          colIdx = ptr[index];
+        if (colIdx == 0 && tinfo != CONSTRAINT) // background should be used - use terMatDiffuse; for CONSTRAINT, ignore
+          {
+            //std::cout << "BG col at [" << i << "," << j << "]\n";
+            //std::cout << "Ter Colour=[" << terMatDiffuse[0] << "," <<
+            //  terMatDiffuse[1] << "," << terMatDiffuse[2] << "," << terMatDiffuse[3] << "]\n";
+            typeBuffer[4*cnt]   = terMatDiffuse[0];
+            typeBuffer[4*cnt+1] = terMatDiffuse[1];
+            typeBuffer[4*cnt+2] = terMatDiffuse[2];
+            typeBuffer[4*cnt+3] = terMatDiffuse[3];
+          }
+        else
+          {
+            typeBuffer[4*cnt]   = (*ct)[ colIdx ][0];
+            typeBuffer[4*cnt+1] = (*ct)[ colIdx ][1];
+            typeBuffer[4*cnt+2] = (*ct)[ colIdx ][2];
+            typeBuffer[4*cnt+3] = (*ct)[ colIdx ][3];
+
+            //std::cout << "Map Colour=[" << typeBuffer[4*cnt] << "," <<
+            //typeBuffer[4*cnt + 1] << "," << typeBuffer[4*cnt + 2] << "," << typeBuffer[4*cnt + 3] << "]";
+            //std::cout << " (with colIdx = " << colIdx << " at location " << (xoff + j) << ", " << (yoff + i) << std::endl;
+
+          }
+        cnt++;
+      }
+    //std::cout << "Buffer built...\n";
+    if (initTexture)
+      {
+        //std::cout << "Overlay texture created at full resolution\n";
+         f->glTexImage2D(GL_TEXTURE_2D, 0,GL_RGBA8, Rwidth, Rheight, 0,GL_RGBA, GL_FLOAT, typeBuffer); CE();
+      }
+    else
+      {
+        //std::cout << "Overlay textured sub'd\n";
+        f->glTexSubImage2D(GL_TEXTURE_2D, 0, xoff, yoff, Rwidth, Rheight, GL_RGBA, GL_FLOAT, typeBuffer); CE();
+      }
+  }
+  typeMapSource[tinfo] = tmap;
+  typeMapRevision[tinfo] = tmap->getRevision();
   //std::cout << "Overlay created\n";
 }
 
@@ -1321,6 +1523,11 @@ void TRenderer::initShaders(void)
   shaderInfo.push_back(std::make_tuple("flatTerr.frag", "flatTerr.vert", "flatTransectShader"));
   shaderInfo.push_back(std::make_tuple("phong-instanced.frag", "phong-instanced.vert", "phongInstancedShader"));
 
+  // edge smoothing for the POST_AA render quality
+  shaderInfo.push_back(std::make_tuple("fxaa.frag", "fxaa.vert", "fxaa"));
+  // flat screen space overlays
+  shaderInfo.push_back(std::make_tuple("screen_colour.frag", "screen_colour.vert", "screenColour"));
+
   for (auto &sh : shaderInfo)
   {
       s = new shaderProgram();
@@ -1367,6 +1574,7 @@ void TRenderer::bindDecals(int width, int height, unsigned char * buffer)
     // bind texture
     f->glEnable(GL_TEXTURE_2D);
     f->glActiveTexture(decalTexUnit); CE();
+    noteTextureBinding();
     f->glGenTextures( 1, &decalTexture ); CE();
     f->glBindTexture( GL_TEXTURE_2D, decalTexture ); CE();
     // int off = 56 * width * 4 + 767 * 4;
@@ -1398,8 +1606,11 @@ void TRenderer::draw(View * view)
 
     //std::cout << "Viewport chk - [" << viewport[0] << "," << viewport[1] << "," << viewport[3] << "," << viewport[3] << "]\n";
 
-    // render at 2X resolution for later linear downsampling (basic anti-aliasing)
-    updateRadianceScalingBuffers(2*viewport[2], 2*viewport[3], true);
+    // render size and anti-aliasing follow this view's quality setting, reduced while the camera moves;
+    // buffers are only reallocated when the resulting size or sample count changes
+    int rwd, rht, samples;
+    renderTargetSize(viewport[2], viewport[3], rwd, rht, samples);
+    updateRadianceScalingBuffers(rwd, rht, samples);
 
     // Set the clear color to white
     f->glClearColor( 1.0f, 1.0f, 1.0f, 1.0f ); CE();
@@ -1556,14 +1767,14 @@ void TRenderer::draw(View * view)
         GLfloat normClear[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 
         // clear manipulator transparency FBO
-        f->glBindFramebuffer(GL_FRAMEBUFFER, fboManipLayer); CE();
+        f->glBindFramebuffer(GL_FRAMEBUFFER, (_samples > 0 ? fboManipMultisample : fboManipLayer)); CE();
         f->glViewport(0,0,_w, _h); CE(); // draw into entire frame
         // clear frame buffer depth/textures
         ef->glClearBufferfv(GL_DEPTH, 0, &depthClear);
         ef->glClearBufferfv(GL_COLOR, 0, manipLayerClear);
 
         // Render to RS FBO; clear buffers first
-        f->glBindFramebuffer(GL_FRAMEBUFFER, fboRadScaling); CE();
+        f->glBindFramebuffer(GL_FRAMEBUFFER, (_samples > 0 ? fboRSMultisample : fboRadScaling)); CE();
         f->glViewport(0,0,_w, _h); CE(); // draw into entire frame
         // clear frame buffer depth/textures
         ef->glClearBufferfv(GL_DEPTH, 0, &depthClear);
@@ -1647,7 +1858,7 @@ void TRenderer::draw(View * view)
 
     if (shadModel == RADIANCE_SCALING_TRANSECT || shadModel == RADIANCE_SCALING_OVERVIEW)
       {
-        f->glBindFramebuffer(GL_FRAMEBUFFER, fboManipLayer); CE();
+        f->glBindFramebuffer(GL_FRAMEBUFFER, (_samples > 0 ? fboManipMultisample : fboManipLayer)); CE();
         f->glViewport(0,0,_w, _h); CE();
       }
 
@@ -1659,6 +1870,8 @@ void TRenderer::draw(View * view)
             shadModel == RADIANCE_SCALING_TRANSECT ||
             shadModel == RADIANCE_SCALING_OVERVIEW)
       {
+        if (_samples > 0)
+            resolveMultisampleBuffers();
         f->glBindFramebuffer(GL_FRAMEBUFFER, 0);  CE();
         f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]); // reset viewport to system setting
       }
@@ -1750,16 +1963,38 @@ if (shadModel == RADIANCE_SCALING || shadModel == RADIANCE_SCALING_TRANSECT ||
 
     ef->glBindVertexArray(0);  CE();
 
-    // bind draw buffer (system
-    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);  CE();
-    // bind read buffer (fbo)
-    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, fboRSOutput);  CE();
-    // set draw buffer
-    GLenum buf = GL_BACK;
-    ef->glDrawBuffers(1, &buf);
-    // blit to the default framebuffer/back_buffer
-    ef->glBlitFramebuffer(0, 0, _w, _h,
-                viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    if (quality == POST_AA && !interacting)
+    {
+        // draw the composite back to the window through an FXAA pass, which smooths edges without extra samples
+        f->glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);  CE();
+        f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        f->glDisable(GL_BLEND); CE(); // replace the window contents, as the blit would
+
+        programID = (*shaders["fxaa"]).getProgramID();
+        f->glUseProgram(programID); CE();
+        f->glActiveTexture(rsDestTexUnit); CE();
+        f->glBindTexture(GL_TEXTURE_2D, destTexture); CE();
+        f->glUniform1i(f->glGetUniformLocation(programID, "image"), (GLint)(rsDestTexUnit - GL_TEXTURE0)); CE();
+        GLfloat texelSize[2] = {1.0f/_w, 1.0f/_h};
+        f->glUniform2fv(f->glGetUniformLocation(programID, "texelSize"), 1, texelSize); CE();
+
+        ef->glBindVertexArray(vaoScreenQuad); CE();
+        f->glDrawArrays(GL_TRIANGLE_FAN, 0, 4);  CE();
+        ef->glBindVertexArray(0);  CE();
+    }
+    else
+    {
+        // bind draw buffer (system
+        f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFBO);  CE();
+        // bind read buffer (fbo)
+        f->glBindFramebuffer(GL_READ_FRAMEBUFFER, fboRSOutput);  CE();
+        // set draw buffer
+        GLenum buf = (outputFBO != 0 ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+        ef->glDrawBuffers(1, &buf);
+        // blit to the default framebuffer/back_buffer, filtering down a supersampled or up a reduced render
+        ef->glBlitFramebuffer(0, 0, _w, _h,
+                    viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
 
     //std::cout << "Blit target: [" << viewport[0] << "," << viewport[1] << "," <<
     //viewport[0] + viewport[2] << "," << viewport[1] + viewport[3] << "]\n";
@@ -1772,6 +2007,74 @@ if (shadModel == RADIANCE_SCALING || shadModel == RADIANCE_SCALING_TRANSECT ||
   f->glUseProgram(0);  CE();
 }
 
+void TRenderer::drawScreenRect(const GLint rect[4], const glm::vec4 &colour)
+{
+    if (!shadersReady || vaoScreenQuad == 0 || rect[2] <= 0 || rect[3] <= 0)
+        return;
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+
+    // a full screen quad clipped to the rectangle by the scissor test
+    f->glEnable(GL_SCISSOR_TEST); CE();
+    f->glScissor(rect[0], rect[1], rect[2], rect[3]); CE();
+    f->glDisable(GL_DEPTH_TEST); CE();
+    f->glEnable(GL_BLEND); CE();
+    f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); CE();
+
+    GLuint programID = (*shaders["screenColour"]).getProgramID();
+    f->glUseProgram(programID); CE();
+    f->glUniform4fv(f->glGetUniformLocation(programID, "colour"), 1, glm::value_ptr(colour)); CE();
+    ef->glBindVertexArray(vaoScreenQuad); CE();
+    f->glDrawArrays(GL_TRIANGLE_FAN, 0, 4);  CE();
+    ef->glBindVertexArray(0);  CE();
+
+    f->glUseProgram(0);  CE();
+    f->glDisable(GL_BLEND); CE();
+    f->glEnable(GL_DEPTH_TEST); CE();
+    f->glDisable(GL_SCISSOR_TEST); CE();
+}
+
+void TRenderer::drawScreenLines(const std::vector<float> &ndc, const glm::vec4 &colour)
+{
+    if (!shadersReady || ndc.size() < 4)
+        return;
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QOpenGLExtraFunctions *ef = QOpenGLContext::currentContext()->extraFunctions();
+
+    if (vaoScreenLines == 0)
+    {
+        ef->glGenVertexArrays(1, &vaoScreenLines); CE();
+        ef->glBindVertexArray(vaoScreenLines); CE();
+        f->glGenBuffers(1, &vboScreenLines); CE();
+        f->glBindBuffer(GL_ARRAY_BUFFER, vboScreenLines); CE();
+        f->glEnableVertexAttribArray(0); CE();
+        f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), (void*)(0)); CE();
+    }
+    else
+    {
+        ef->glBindVertexArray(vaoScreenLines); CE();
+        f->glBindBuffer(GL_ARRAY_BUFFER, vboScreenLines); CE();
+    }
+    f->glBufferData(GL_ARRAY_BUFFER, ndc.size() * sizeof(GLfloat), ndc.data(), GL_STREAM_DRAW); CE();
+
+    f->glDisable(GL_DEPTH_TEST); CE();
+    f->glEnable(GL_BLEND); CE();
+    f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); CE();
+
+    GLuint programID = (*shaders["screenColour"]).getProgramID();
+    f->glUseProgram(programID); CE();
+    f->glUniform4fv(f->glGetUniformLocation(programID, "colour"), 1, glm::value_ptr(colour)); CE();
+    f->glDrawArrays(GL_LINES, 0, (GLsizei) (ndc.size() / 2));  CE();
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0); CE();
+    ef->glBindVertexArray(0);  CE();
+
+    f->glUseProgram(0);  CE();
+    f->glDisable(GL_BLEND); CE();
+    f->glEnable(GL_DEPTH_TEST); CE();
+}
+
 void TRenderer::drawSun(View * view, int renderPass)
 {
     if (!shadersReady) // not compiled!
@@ -1983,10 +2286,31 @@ void TRenderer::forceTextureRebind(void)
          f->glBindTexture(GL_TEXTURE_2D, manipDepthTexture); CE();
          f->glActiveTexture(manipTranspTexUnit);
          f->glBindTexture(GL_TEXTURE_2D, manipTranspTexture); CE();
+         f->glActiveTexture(typemapTexUnit);
+         f->glBindTexture(GL_TEXTURE_2D, typeMapTexture); CE();
+         f->glActiveTexture(constraintTexUnit);
+         f->glBindTexture(GL_TEXTURE_2D, constraintTexture); CE();
+         f->glActiveTexture(decalTexUnit);
+         f->glBindTexture(GL_TEXTURE_2D, decalTexture); CE();
+         texturesBoundBy[QOpenGLContext::currentContext()] = this;
     }
     //else
     //    std::cerr << "forceTextureRebind - Error! Heightmap texture undefined!\n";
 }
 
+void TRenderer::bindTextures(void)
+{
+    if (texturesBoundBy[QOpenGLContext::currentContext()] != this)
+        forceTextureRebind();
+}
+
+void TRenderer::noteTextureBinding(void)
+{
+    // binding one of our textures leaves our own set intact but invalidates that of any other renderer
+    const TRenderer * &owner = texturesBoundBy[QOpenGLContext::currentContext()];
+    if (owner != this)
+        owner = nullptr;
+}
+
 
 } // end of namespace PMrender
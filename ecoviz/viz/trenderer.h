@@ -30,6 +30,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 
@@ -45,6 +46,21 @@
 
 namespace PMrender {
 
+// Heightmap texture for one terrain, shared by every renderer that draws it. Textures are visible to all contexts
+// in the application's share group, so height data is uploaded once however many views show the terrain.
+struct SharedHeightMap
+{
+    GLuint texture = 0;         // texture id, 0 if not yet uploaded
+    int width = 0, height = 0;  // dimensions of the texture
+    long revision = -1;         // revision of the height data currently held by the texture
+
+    // deletes the texture if a context is current, otherwise defers deletion to the next heightmap update
+    ~SharedHeightMap();
+
+    // delete textures whose owners went away while no context was current
+    static void releaseOrphans(void);
+};
+
 class TRenderer: protected QOpenGLExtraFunctions
 {
  public:
@@ -61,6 +77,14 @@ class TRenderer: protected QOpenGLExtraFunctions
     // select type map info to update - PAINT upfdated paint type map,
     // CONSTRAINT updates the overlay data (additional constraints etc)
     enum typeMapInfo {PAINT, CONSTRAINT};
+    // anti-aliasing applied to the offscreen radiance scaling render before it reaches the window
+    enum renderQuality
+    {
+        NATIVE,         // render at window resolution, no anti-aliasing
+        SUPERSAMPLE_2X, // render at twice window resolution and filter down on output
+        MSAA,           // multisampled render, resolved before the compositing pass
+        POST_AA         // render at window resolution and smooth edges in a final FXAA pass
+    };
 
  private:
 
@@ -106,14 +130,23 @@ class TRenderer: protected QOpenGLExtraFunctions
     unsigned int indexSize; // number of elements in index buffer.
 
     GLfloat *typeBuffer;// local storage used to avoid multiple allocatiosn when managing type painting updates
+    int typeBufferCells; // number of RGBA cells typeBuffer can hold
     GLuint normalTexture; //  normal texture identifier - data generated from shader pass
     GLuint fboNormalMap; // normal map FBO
-    GLuint heightmapTexture; // id of heightmap texture; generated outside class
+    GLuint heightmapTexture; // id of heightmap texture; owned by heightmapShare
+    std::shared_ptr<SharedHeightMap> heightmapShare; // shared heightmap of the terrain last drawn
+    long heightmapRevision; // height data revision from which terrain geometry and normals were last built
     GLuint typeMapTexture; // texure used to store type map
     GLuint fboRadScaling; // FBO for radiance scaling renders
     GLuint fboRSOutput; // FBO for final composited Rad scaling output
     GLuint fboManipLayer; // FBO for manipulator transparency fix
+    GLuint fboRSMultisample; // multisampled stand-in for fboRadScaling, resolved into its textures (MSAA only)
+    GLuint fboManipMultisample; // multisampled stand-in for fboManipLayer (MSAA only)
+    GLuint msRenderbuffers[6]; // depth, gradient, normal, colour, manipulator depth and colour for the multisampled FBOs
     GLuint constraintTexture; // texture to store additional terrain vis data (freezng, overlay etc)
+    TypeMap * typeMapSource[2]; // type maps (PAINT, CONSTRAINT) whose contents the textures currently hold
+    long typeMapRevision[2]; // revisions of those type maps at the time of upload
+    int typeMapWidth[2], typeMapHeight[2]; // dimensions of the type map textures
 
     GLenum htmapTexUnit; // height/normal map - texture units reserved
     GLenum normalMapTexUnit;
@@ -165,6 +198,11 @@ class TRenderer: protected QOpenGLExtraFunctions
     float scalex, scaley; // extent of terrain in metres
     int width, height; // dimensions of height map
     int _w, _h;       // dimensions of FrameBuffer for radiance scaling
+    int _samples;     // samples per pixel of the radiance scaling render, 0 if not multisampled
+    renderQuality quality; // anti-aliasing used when the view is idle
+    float interactionScale; // fraction of window resolution rendered while the camera is being moved
+    bool interacting; // camera is being moved, so render at interactionScale without anti-aliasing
+    GLuint outputFBO; // framebuffer receiving the final radiance scaling image, 0 for the window
     terrainShadingModel shadModel;
     float terrainBase; // lowest point on terrain - based moved to this height
     float terrainBasePad; // extra space used to avoid have 'thin' terrains
@@ -181,6 +219,10 @@ class TRenderer: protected QOpenGLExtraFunctions
    // screen (z-plane) aligned quad: (X,Y, s, t); tex coords are centred on pixels, hence +0.25 contribution
    GLuint vaoScreenQuad;
    GLuint vboScreenQuad;
+
+   // streamed 2D line segments for screen overlays, created on first use
+   GLuint vaoScreenLines;
+   GLuint vboScreenLines;
    GLfloat screenQuad[16] = {-1.0f, -1.0f,   0.0f, 0.0f,
                              1.0f, -1.0f,    1.0f, 0.0f,
                              1.0f, 1.0f,     1.0f, 1.0f,
@@ -203,7 +245,11 @@ class TRenderer: protected QOpenGLExtraFunctions
     bool prepareWalls(void);
     void generateNormalTexture(void);
     void drawManipulators(GLuint program, bool drawTO_FB=false);
-    bool initRadianceScalingBuffers(int vWd, int vHt);
+    bool initRadianceScalingBuffers(int vWd, int vHt, int samples = 0);
+    bool initMultisampleBuffers(int samples);
+    void resolveMultisampleBuffers(void);
+    // size and sample count of the radiance scaling render for a vwd X vht viewport under the current quality settings
+    void renderTargetSize(int vwd, int vht, int &rwd, int &rht, int &samples);
     // manage creation/destruction of new models
     void initInstanceData(void);
     void destroyInstanceData(void);
@@ -240,8 +286,31 @@ public:
     }
 
     // update radiance scaling FBO textures/attachments if viewport has changed size
-    // vwd and vht are current viewport width and height, resp.
-    void updateRadianceScalingBuffers(int vwd, int vht, bool force = false);
+    // vwd and vht are current viewport width and height, resp., samples > 0 adds multisampled render targets
+    void updateRadianceScalingBuffers(int vwd, int vht, int samples = 0, bool force = false);
+
+    // anti-aliasing of radiance scaling renders when the view is idle
+    void setRenderQuality(renderQuality q){ quality = q; }
+    renderQuality getRenderQuality(void){ return quality; }
+
+    // fraction of window resolution (0,1] to render at while the camera is moving
+    void setInteractionScale(float s){ interactionScale = std::max(0.1f, std::min(1.0f, s)); }
+    float getInteractionScale(void){ return interactionScale; }
+
+    // drop to interactionScale without anti-aliasing while on is true, restoring full quality when it is turned off
+    void setInteractive(bool on){ interacting = on; }
+    bool getInteractive(void){ return interacting; }
+
+    // write the final radiance scaling image to fbo (single colour attachment) rather than the window; 0 restores the window
+    void setOutputFramebuffer(GLuint fbo){ outputFBO = fbo; }
+
+    // blend a flat colour over the rectangle [x, y, width, height] (window coordinates) of the current framebuffer,
+    // weighted by the colour's alpha
+    void drawScreenRect(const GLint rect[4], const glm::vec4 &colour);
+
+    // blend flat coloured line segments over the current framebuffer; ndc holds x, y pairs in normalised device
+    // coordinates, two points per segment
+    void drawScreenLines(const std::vector<float> &ndc, const glm::vec4 &colour);
 
     // assumes modelling matrix is Identity for terrain
     void setCamera(glm::mat4x4& mx)
@@ -428,9 +497,10 @@ public:
     // init render object - call before any other operations! - just sets up and compiles shaders
     void initShaders(void);
 
-    // call when height data has been changed (including whenit is first generated)
-    // force==true will cause everything to be rebuilt, rather than simply updated
-    void updateHeightMap(int wd, int ht, float scx, float scy, float* data, bool force = false);
+    // call before drawing with the terrain's shared heightmap and the current revision of its height data.
+    // The texture is uploaded only if no other renderer has uploaded this revision yet, and terrain geometry and
+    // normals are rebuilt only if this renderer has not yet seen this terrain and revision.
+    void updateHeightMap(int wd, int ht, float scx, float scy, const float* data, std::shared_ptr<SharedHeightMap> shared, long revision);
 
     /// load Decal texture map given an image stored in a suitable buffer (of width * height dimensions)
     void bindDecals(int width, int height, unsigned char * buffer);
@@ -444,8 +514,8 @@ public:
     void drawSun(View * view, int renderPass);
 
     // use tmap to generate/update the internal texture overay representation for terrain. This texture
-    // will usually be created only once and dirty regions in tmap then be sub'd into the internal texture
-    // for performamce reasons.
+    // will usually be created only once and the regions of tmap changed since the last upload then be
+    // sub'd into the internal texture for performamce reasons.
     void updateTypeMapTexture(TypeMap* tmap, typeMapInfo tinfo = typeMapInfo::PAINT, bool force = false);
 
     // when using multiple  renderer instances with one OpenGL context, each rendered allocatestextures and stores
@@ -454,6 +524,14 @@ public:
     // rendering to be rebound to the correct  tex unit so that the shaders get the correct textures (which will be unique per
     // object) as input.
     void forceTextureRebind(void);
+
+    // as forceTextureRebind, but only rebinds if some other renderer has bound textures in the current context since
+    // this renderer last did so. Use in the paint path instead of forceTextureRebind.
+    void bindTextures(void);
+
+ private:
+    // record that this renderer has bound one of its own textures, which disturbs any other renderer's bindings
+    void noteTextureBinding(void);
 };
 
 }
@@ -344,6 +344,7 @@ TypeMap::~TypeMap()
 void TypeMap::clear()
 {
     tmap->fill(0);
+    touch(coverRegion());
 }
 
 void TypeMap::initPaletteColTable()
@@ -512,6 +513,45 @@ void TypeMap::clipRegion(Region &reg)
     if(reg.y1 > height()) reg.y1 = height();
 }
 
+void TypeMap::touch(Region reg)
+{
+    const int maxChanges = 64;
+
+    revision++;
+    clipRegion(reg);
+    if(reg.empty())
+        return;
+
+    if(!changes.empty())
+    {
+        // runs of neighbouring single cell writes fold into one rectangle
+        Region &last = changes.back().second;
+        Region merged = last | reg;
+        if(merged.pixels() <= 2 * (last.pixels() + reg.pixels()))
+        {
+            last = merged;
+            changes.back().first = revision;
+            return;
+        }
+    }
+
+    if((int) changes.size() >= maxChanges)
+    {
+        // collapsing to the bounding region of every change keeps the log complete, if less precise
+        for(auto &c: changes)
+            reg |= c.second;
+        changes.clear();
+    }
+    changes.push_back(std::make_pair(revision, reg));
+}
+
+void TypeMap::changedSince(long since, std::vector<Region> &regions) const
+{
+    for(auto &c: changes)
+        if(c.first > since && !c.second.empty())
+            regions.push_back(c.second);
+}
+
 void TypeMap::matchDim(int w, int h)
 {
     int mx, my;
@@ -525,6 +565,7 @@ void TypeMap::matchDim(int w, int h)
         dirtyreg = Region(0, 0, w, h);
         tmap->setDim(w, h);
         tmap->fill(0); // set to empty type
+        touch(coverRegion());
     }
 }
 
@@ -535,6 +576,7 @@ void TypeMap::replaceMap(basic_types::MapInt * newmap)
     for (int y = 0; y < tmap->height(); y++)
         for (int x = 0; x < tmap->width(); x++)
             tmap->set(y,x, newmap->get(y,x));
+    touch(coverRegion());
 }
 
 int TypeMap::load(const std::string &filename, TypeMapType purpose)
@@ -591,6 +633,7 @@ int TypeMap::load(const std::string &filename, TypeMapType purpose)
             }
         }
         infile.close();
+        touch(coverRegion());
         // cerr << "maxtp = " << maxtp << endl;
         // cerr << "mintp = " << mintp << endl;
     }
@@ -625,23 +668,50 @@ bool TypeMap::loadCategoryImage(const std::string &filename)
             col.getRgb(&r, &g, &b); // all channels store the same info so just use red
             tmap->set(y,x, r - 100); // convert greyscale colour to category index
         }
+    touch(coverRegion());
     return true;
 }
 
 int TypeMap::convert(basic_types::MapFloat * map, TypeMapType purpose, float range)
 {
-    int tp, maxtp = 0;
+    int maxtp = 0;
     int width, height;
-    float val;
+    std::vector<basic_types::MapRect> rects;
 
     map->getDim(width, height);
+
+    // the type map is transposed with respect to the float map
+    bool incremental = (map == convertSource && revision == convertRevision && purpose == convertPurpose && range == convertRange
+                        && tmap->width() == height && tmap->height() == width);
     matchDim(height, width);
-    // convert to internal type map format
-    int mincm, maxcm;
-    mincm = 100; maxcm = -1;
+    if(incremental)
+        map->changedSince(convertSourceRevision, rects);
+    else
+        rects.push_back(basic_types::MapRect{0, 0, width, height});
 
-    for(int x = 0; x < width; x++)
-        for(int y = 0; y < height; y++)
+    for(auto &r: rects)
+    {
+        maxtp = std::max(maxtp, convertRect(map, purpose, range, r));
+        touch(Region(r.y0, r.x0, r.y1, r.x1));
+    }
+
+    // the float map's change log is left intact for any other type map converting it
+    convertSource = map;
+    convertSourceRevision = map->getRevision();
+    convertPurpose = purpose;
+    convertRange = range;
+    convertRevision = revision;
+    return maxtp;
+}
+
+int TypeMap::convertRect(basic_types::MapFloat * map, TypeMapType purpose, float range, const basic_types::MapRect &r)
+{
+    int tp, maxtp = 0;
+    float val;
+
+    // convert to internal type map format
+    for(int x = r.x0; x < r.x1; x++)
+        for(int y = r.y0; y < r.y1; y++)
         {
             tp = 0;
             switch(purpose)
@@ -779,6 +849,7 @@ void TypeMap::setPurpose(TypeMapType purpose)
         default:
             break;
     }
+    touch(coverRegion()); // every cell changes colour
 }
 
 void TypeMap::resetType(int ind)
@@ -791,10 +862,12 @@ void TypeMap::resetType(int ind)
                 tmap->set(j,i,0);
     dirtyreg.x0 = 0; dirtyreg.y0 = 0;
     dirtyreg.x1 = tmap->width(); dirtyreg.y1 = tmap->height();
+    touch(dirtyreg);
 }
 
 void TypeMap::setColour(int ind, GLfloat * col)
 {
     for(int i = 0; i < 4; i++)
         colmap[ind][i] = col[i];
+    touch(coverRegion());
 }
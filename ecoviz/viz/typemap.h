@@ -145,6 +145,13 @@ private:
     Region dirtyreg;                ///< bounding box in terrain grid integer coordinates (e.g, x=[0-width), y=[0-hieght))
     TypeMapType usage;              ///< indicates map purpose
     int numSamples;                 ///< number of active entries in lookup table
+    long revision = 0;              ///< incremented whenever types, colours or the update region change
+    std::vector<std::pair<long, Region>> changes; ///< region changed at each revision, oldest first, so textures can be updated in part
+    const basic_types::MapFloat * convertSource = nullptr; ///< float map most recently converted into this type map
+    TypeMapType convertPurpose = TypeMapType::EMPTY; ///< purpose of the most recent conversion
+    float convertRange = 0.0f;      ///< range of the most recent conversion
+    long convertRevision = -1;      ///< revision immediately after the most recent conversion
+    long convertSourceRevision = -1; ///< revision of the float map that the most recent conversion caught up with
     ///< global data map from which a sub-region is extracted on demand
 
     /// Set up the colour table with natural USGS inspired map colours
@@ -167,6 +174,22 @@ private:
     /// clip a region to the bounds of the map
     void clipRegion(Region &reg);
 
+    /**
+     * @brief touch Record a change to part of the map and advance the revision
+     * @param reg   changed cells, in type map coordinates
+     */
+    void touch(Region reg);
+
+    /**
+     * @brief convertRect   Convert a rectangle of a floating point map into types
+     * @param map       source map
+     * @param purpose   map purpose, which determines the discretization
+     * @param range     upper bound of values for colour ramps
+     * @param r         cells of @a map to convert
+     * @retval largest type written
+     */
+    int convertRect(basic_types::MapFloat * map, TypeMapType purpose, float range, const basic_types::MapRect &r);
+
 public:
 
     TypeMap(){ usage = TypeMapType::EMPTY; }
@@ -188,7 +211,7 @@ public:
     int height(){ return tmap->height(); }
 
     /// fill map with a certain colour
-    void fill(int val){ tmap->fill(val); }
+    void fill(int val){ tmap->fill(val); touch(coverRegion()); }
 
     /// Match type map dimensions to @a w (width) and @a h (height)
     void matchDim(int w, int h);
@@ -201,7 +224,7 @@ public:
     
     /// getter for individual value
     int get(int x, int y){ return tmap->get(y,x); }
-    void set(int x, int y, int val){ tmap->set(y,x,val); }
+    void set(int x, int y, int val){ tmap->set(y,x,val); touch(Region(y, x, y+1, x+1)); }
     
     /// replace underlying map
     void replaceMap(basic_types::MapInt * newmap);
@@ -212,7 +235,12 @@ public:
     /// load from category data from PNG file, return number of clusters
     bool loadCategoryImage(const std::string &filename);
 
-    /// convert a floating point map into a discretized type map
+    /**
+     * @brief convert   Convert a floating point map into a discretized type map. If the same map was the last one converted,
+     *                  with the same purpose and range and no other change to the type map since, only the cells
+     *                  marked dirty in @a map are converted. The dirty list of @a map is cleared.
+     * @retval largest type written by this conversion
+     */
     int convert(basic_types::MapFloat * map, TypeMapType purpose, float range = 1.0f);
 
     /// save a mask file version of the type map
@@ -233,11 +261,22 @@ public:
     /// getter for update region
     Region getRegion(void) { return dirtyreg; }
 
+    /// revision of the map contents, so that consumers such as textures can tell whether they are out of date
+    long getRevision(void) { return revision; }
+
+    /**
+     * @brief changedSince  Find the parts of the map changed after a given revision
+     * @param since     revision at which the consumer last caught up
+     * @param regions   changed regions, possibly overlapping, are appended here
+     */
+    void changedSince(long since, std::vector<Region> &regions) const;
+
     /// setter for update region
     void setRegion(const Region& toupdate)
     {
         dirtyreg = toupdate;
         clipRegion(dirtyreg);
+        touch(dirtyreg);
     }
 
     /// return region that covers the entire type map
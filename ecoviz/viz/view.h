@@ -82,6 +82,7 @@ private:
     ViewMode viewmode;          // {ARCBALL, FLY} modes of viewing
     float terextent;            // the diagonal extent of the terrain for sizing orthogonal views to fit
     float terdepth;             //< the depth from near to far clipping planes for orthogonal views
+    bool moving;                //< camera is being moved by the user or an animation
     Timer time;
 
     /// Recalculate viewing direction and up vector
@@ -119,9 +120,14 @@ public:
         cop = vpPoint(0.0f, 0.0f, 1.0f);
         terextent = 1.0f;
         terdepth = 1.0f;
+        moving = false;
         updateDir();
     }
 
+    /// Mark the camera as moving, so that views sharing it can render at reduced quality until it settles
+    void setMoving(bool on){ moving = on; }
+    bool isMoving(){ return moving; }
+
     /// save out view matrix, as text files
     /// the filename basename will be used to produce:
     /// basename-view.txt
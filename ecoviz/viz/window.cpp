@@ -126,6 +126,7 @@ void Window::setupRenderPanel()
     numContours = 1.0f / contourSep;
     contourWidth = 1.0f; // in pixels ?
     contourIntensity = 1.2f; // 130% of base colour
+    contoursOn = false;
 
     // radiance scaling parameters
     radianceTransition = 0.2f;
@@ -693,6 +694,7 @@ void Window::setupVizPerspective(QSurfaceFormat glFormat, int i)
     // signal to slot connections
 
     connect(pview, SIGNAL(signalRepaintAllGL()), this, SLOT(repaintAllGL()));
+    connect(pview, SIGNAL(signalRepaintAllMoved()), this, SLOT(repaintAllMoved()));
     connect(pview, SIGNAL(signalShowTransectView()), this, SLOT(showTransectViews()));
     connect(pview, SIGNAL(signalSyncPlace(bool)), this, SLOT(transectSyncPlace(bool)));
     connect(pview, SIGNAL(signalRebindTransectPlants()), transectViews[i], SLOT(rebindPlants()));
@@ -1022,6 +1024,7 @@ Window::Window(string datadir, string lprefix, string rprefix)
     QSurfaceFormat::setDefaultFormat(fmt);
     basedir = datadir;
     prefix[0] = lprefix; prefix[1] = rprefix;
+    scheduler = new FrameScheduler(this); // must exist before any view is created
 
     // NOTE: to enable MSAA rendering into FBO requires some more work, fix then enable - else white screen.
     //glFormat.setSampleBuffers( true );
@@ -1216,11 +1219,15 @@ void Window::scaleRenderParams(float scale)
         pview->getRenderer()->setGridParams(numGridX, numGridZ, gridWidth, gridIntensity);
         pview->getRenderer()->setContourParams(numContours, contourWidth, contourIntensity);
         pview->getRenderer()->setRadianceScalingParams(radianceEnhance);
+        pview->getOverviewWindow()->setContourInterval(contoursOn ? contourSep : 0.0f);
     }
 }
 
 void Window::keyPressEvent(QKeyEvent *e)
 {
+    if(e->key() == Qt::Key_R) // report suppressed repaints and plant bind costs alongside the per-view frame timings
+        scheduler->setReporting(!scheduler->getReporting());
+
     // pass to render windows
     for(auto pview: perspectiveViews)
         pview->keyPressEvent(e);
@@ -1250,20 +1257,28 @@ void Window::repaintAllGL()
     }*/
     // updateOverviews();
 
+    // views are painted together on the next frame, however many times this is called before then
     rendercount = 0;
     for(auto pview: perspectiveViews)
-        pview->repaint();
+        scheduler->request(pview, FrameScheduler::OTHER);
     for(auto tview: transectViews)
-        tview->repaint();
+        scheduler->request(tview, FrameScheduler::OTHER);
     for(auto mview: timelineViews)
-        mview->repaint();
+        scheduler->request(mview, FrameScheduler::OTHER);
     for(auto cview: chartViews)
-        cview->repaint();
+        scheduler->request(cview, FrameScheduler::OTHER);
     // PCM: probbaly not needed mostly...
     //for (auto mapviews: overviewMaps)
     //    if (mapviews != nullptr) mapviews->repaint();
 }
 
+void Window::repaintAllMoved()
+{
+    for(auto pview: perspectiveViews)
+        scheduler->request(pview, FrameScheduler::CAMERA);
+    repaintAllGL();
+}
+
 void Window::saveSceneView(int i)
 {
     viewScene scnview(perspectiveViews[i]->getMapRegion(), (* perspectiveViews[i]->getView()));
@@ -1293,43 +1308,33 @@ void Window::loadSceneView(int i)
     view = scnview.getView();
     extractNewSubTerrain(i, region.x0, region.y0, region.x1, region.y1);
     perspectiveViews[i]->setView(view);
-    repaintAllGL();
+    repaintAllMoved();
 }
 
 
 // ISSUES: 1) this may not remove/add transect buttons correctly
-//         2) this does not touch the chart/timeline (these were built with  original sub-terrain and stats are for that -
-//            note that the Timeline should br OK since it uses full terrain data, but chart is based on original terrain)
 
 void Window::extractNewSubTerrain(int i, int x0, int y0, int x1, int y1)
 {
     active = false;
 
-    // clear transects and widgets
+    // The widgets, their GL contexts and renderers are kept: only the terrain, transect and plant bindings change.
+    // Locked perspective views share one View, so give each its own before a scene switch replaces it; the
+    // lock is re-established below.
+    if(viewLock == LockState::LOCKEDFROMLEFT)
+        perspectiveViews[1]->unlockView();
+    if(viewLock == LockState::LOCKEDFROMRIGHT)
+        perspectiveViews[0]->unlockView();
+    // unlocking replaces the transect control, so only do so if the transects are actually locked
+    if(transectLock != LockState::UNLOCKED)
+        unlockTransects();
+
     for(int j = 0; j < 2; j++)
     {
         if(i == 2 || i == j) // one (i == 0 or i == 1) or both (i == 3) perspective views
         {
-            destroyVizTransect(j);
-
-            // destroy perspective views and  associated widgets
-            View *oldView = new View(*perspectiveViews[j]->getView());
             bool oldLock = perspectiveViews[j]->getViewLockState();
 
-            destroyVizPerspective(j);
-
-            QSurfaceFormat glFormat;
-            glFormat.setProfile( QSurfaceFormat::CoreProfile );
-            glFormat.setDepthBufferSize(24);
-            glFormat.setVersion(4,1);
-            // glFormat.setOptions(QSurfaceFormat::DeprecatedFunctions);
-
-            /*
-            glFormat.setVersion( 4, 1 );
-            // fmt.setSamples(16);
-            // fmt.setDepthBufferSize(24);
-            glFormat.setProfile( QSurfaceFormat::CoreProfile );*/
-
             // get current region (which should have changed from before)
             Region newReg = Region(x0,y0,x1,y1);
 
@@ -1345,27 +1350,15 @@ void Window::extractNewSubTerrain(int i, int x0, int y0, int x1, int y1)
             scenes[j]->getTerrain()->setFocus(midPoint);
             // cerr << "MIDPOINT = " << midPoint.x << ", " << midPoint.y << ", " << midPoint.z << endl;
 
-            // rebuild transect control structure
-            assert(transectControls.size() == 2);
-            assert(transectControls[j] == nullptr);
-            Transect * t = new Transect(scenes[j]->getTerrain());
-            transectControls[j] = t;
-
-            // rebuild transect widget
-            setupVizTransect(glFormat, j);
+            // any transect belonged to the previous sub-terrain, so start afresh on the new one
+            transectControls[j]->reset(scenes[j]->getTerrain());
+            transectViews[j]->switchTransectScene(scenes[j], transectControls[j]);
             transectViews[j]->setVisible(false);
-            transectControls[j]->init(scenes[j]->getTerrain());
+            transectViews[j]->setActive(false);
 
-            // rebuild perspective widget
-            setupVizPerspective(glFormat, j);
-            perspectiveViews[j]->setScene(scenes[j]);
+            // keep the camera, re-centred on the new sub-terrain; plants are re-picked and rebound for it
+            perspectiveViews[j]->switchPerspectiveScene(scenes[j]);
             perspectiveViews[j]->getOverviewWindow()->setSelectionRegion(mapScenes[j]->getSelectedRegion());
-            // required to preserve View Mx, will cause issues if left/reight perspective views are 'locked'
-            // NOTE: the glWidget never frees 'view' and thus leaks memory. But changing this would require a
-            // lot more code (should store View not View * and make copies - it's a lightweight object, but embedded
-            // in many places, so lot of rewriting.
-            perspectiveViews[j]->lockView(oldView);
-            perspectiveViews[j]->getView()->setForcedFocus(midPoint); // otherwise focus change is not copied from terrain
 
             // (3) for new terrain (aftr initial terrain) we need to ensure thats buffer size changes are accounted for.
             scenes[j]->getTerrain()->setBufferToDirty();
@@ -1373,23 +1366,19 @@ void Window::extractNewSubTerrain(int i, int x0, int y0, int x1, int y1)
 
             perspectiveViews[j]->rebindPlants();
 
-            // restablish broken connection from timeline widget signals
-            //connect(timelineViews[i], SIGNAL(signalRepaintAllGL()), this, SLOT(repaintAllGL()));
-            //connect(timelineViews[i], SIGNAL(signalRebindPlants()), chartViews[i], SLOT(updateTimeBar()));
-            //connect(timelineViews[i], SIGNAL(signalSync(int)), this, SLOT(timelineSync(int)));
-            connect(timelineViews[j], SIGNAL(signalRebindPlants()), perspectiveViews[j], SLOT(rebindPlants()));
-            connect(timelineViews[j], SIGNAL(signalRebindPlants()), transectViews[j], SLOT(rebindPlants()));
-
-            //overviewMaps[i]->setSelectionRegion(mapScenes[i]->getSelectedRegion());
-            //overviewMaps[i]->updateViewParams();
-            //overviewMaps[i]->forceUpdate();
-
             rendercount++;
-            perspectiveViews[j]->setDataMap(dmapIdx[j], convertRampIdx(i), false); // note that update is deferred until texture has been initialized
+            perspectiveViews[j]->setDataMap(dmapIdx[j], convertRampIdx(j), false); // note that update is deferred until texture has been initialized
             perspectiveViews[j]->setViewLockState(oldLock);
-        }
-        // PCM: + signal to clear transect!!!
 
+            // charts follow the new sub-terrain; region statistics are table lookups, so this is cheap
+            auto charts = TimelineGraph::getChartTypes();
+            for(int c = 0; c < (int) graphModels[j].size() && c < (int) charts.size(); c++)
+            {
+                graphModels[j][c]->setTimeLine(scenes[j]->getTimeline());
+                graphModels[j][c]->extractDataSeries(scenes[j], charts[c]);
+            }
+            chartViews[j]->updateTimeBar();
+        }
     }
 
     // if the views are locked then resync
@@ -1462,7 +1451,7 @@ void Window::lockViewsFromLeft()
         }
 
         rendercount++;
-        repaintAllGL();
+        repaintAllMoved(); // one of the views has taken on the camera of the other
     }
     else
     {
@@ -1493,7 +1482,7 @@ void Window::lockViewsFromRight()
         }
 
         rendercount++;
-        repaintAllGL();
+        repaintAllMoved(); // one of the views has taken on the camera of the other
     }
     else
     {
@@ -1719,8 +1708,12 @@ void Window::timelineSync(int t)
 
 void Window::showContours(int show)
 {
+    contoursOn = (show == Qt::Checked);
     for(auto pview: perspectiveViews)
-        pview->getRenderer()->drawContours(show == Qt::Checked);
+    {
+        pview->getRenderer()->drawContours(contoursOn);
+        pview->getOverviewWindow()->setContourInterval(contoursOn ? contourSep : 0.0f);
+    }
     rendercount++;
     repaintAllGL();
 }
@@ -2016,6 +2009,7 @@ void Window::lineEditChange()
         pview->getRenderer()->setGridParams(numGridX, numGridZ, gridWidth, gridIntensity);
         pview->getRenderer()->setContourParams(numContours, contourWidth, contourIntensity);
         pview->getRenderer()->setRadianceScalingParams(radianceEnhance);
+        pview->getOverviewWindow()->setContourInterval(contoursOn ? contourSep : 0.0f);
     }
     rendercount++;
     repaintAllGL();
@@ -66,6 +66,7 @@
 #include "gloverview.h"
 #include "chartwindow.h"
 #include "mitsuba_model.h"
+#include "framescheduler.h"
 #include <QWidget>
 #include <QtWidgets>
 #include <string>
@@ -142,12 +143,17 @@ public:
 
     QSize sizeHint() const;
 
+    /// scheduler through which views request repaints
+    FrameScheduler * getScheduler(){ return scheduler; }
+
     /// Adjust rendering parameters, grid and contours, to accommodate current scale
     void scaleRenderParams(float scale);
     void run_viewer();
 
 public slots:
     void repaintAllGL();
+    /// as repaintAllGL, but the shared camera of the perspective views has moved, so their plants are rebound before painting
+    void repaintAllMoved();
     void transectSyncPlace(bool firstplace);
     void timelineSync(int t);
 
@@ -228,6 +234,7 @@ private:
     //std::vector<GLOverview *> overviewMaps;     ///< OpenGL over maps (left and right)
     std::vector<TimeWindow *> timelineViews;    ///< widget for timeline control
     std::vector<ChartWindow *> chartViews;      ///< widget for displaying graphs
+    FrameScheduler * scheduler;                 ///< coalesces repaint requests from all views into one paint per frame
     std::vector<std::vector< TimelineGraph *> > graphModels;   ///< Underlying graph data associated with scene, multiple graphs per scene
     QWidget * vizPanel;                         ///< Central panel with visualization subwidgets
     QWidget * renderPanel;                      ///< Side panel to adjust various rendering style parameters
@@ -254,6 +261,7 @@ private:
     // rendering parameters
     float gridSepX, numGridX, gridSepZ, numGridZ, gridWidth, gridIntensity; ///< grid params
     float contourSep, numContours, contourWidth, contourIntensity; ///< contour params
+    bool contoursOn; ///< contours shown, in the perspective views and as lines on the overviews
     float radianceTransition, radianceEnhance; ///< radiance scaling params
 
     // render panel widgets
@@ -0,0 +1,59 @@
+#version 410
+
+// fast approximate anti-aliasing (after T. Lottes, FXAA 3.11 console variant):
+// find local luminance edges and blend across them along the edge direction
+
+out vec4 fcolour;
+
+in vec2 texCoord;
+
+uniform sampler2D image;  // composited radiance scaling output, linearly filtered
+uniform vec2 texelSize;   // (1/width, 1/height) of image
+
+const float reduceMin = 1.0/128.0;
+const float reduceMul = 1.0/8.0;
+const float spanMax = 8.0;
+
+float luma(vec3 c)
+{
+  return dot(c, vec3(0.299, 0.587, 0.114));
+}
+
+void main(void)
+{
+  vec3 rgbNW = texture(image, texCoord + vec2(-1.0, -1.0) * texelSize).rgb;
+  vec3 rgbNE = texture(image, texCoord + vec2(1.0, -1.0) * texelSize).rgb;
+  vec3 rgbSW = texture(image, texCoord + vec2(-1.0, 1.0) * texelSize).rgb;
+  vec3 rgbSE = texture(image, texCoord + vec2(1.0, 1.0) * texelSize).rgb;
+  vec4 centre = texture(image, texCoord);
+
+  float lumaNW = luma(rgbNW);
+  float lumaNE = luma(rgbNE);
+  float lumaSW = luma(rgbSW);
+  float lumaSE = luma(rgbSE);
+  float lumaM = luma(centre.rgb);
+
+  float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+  float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+  // direction along the edge, perpendicular to the luminance gradient
+  vec2 dir;
+  dir.x = -((lumaNW + lumaNE) - (lumaSW + lumaSE));
+  dir.y = ((lumaNW + lumaSW) - (lumaNE + lumaSE));
+
+  float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * reduceMul), reduceMin);
+  float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+  dir = clamp(dir * rcpDirMin, vec2(-spanMax), vec2(spanMax)) * texelSize;
+
+  vec3 rgbA = 0.5 * (texture(image, texCoord + dir * (1.0/3.0 - 0.5)).rgb +
+                     texture(image, texCoord + dir * (2.0/3.0 - 0.5)).rgb);
+  vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(image, texCoord + dir * -0.5).rgb +
+                                   texture(image, texCoord + dir * 0.5).rgb);
+
+  // the wider sample may have crossed onto another surface, in which case keep the narrow one
+  float lumaB = luma(rgbB);
+  if (lumaB < lumaMin || lumaB > lumaMax)
+    fcolour = vec4(rgbA, centre.a);
+  else
+    fcolour = vec4(rgbB, centre.a);
+}
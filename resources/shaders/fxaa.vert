@@ -0,0 +1,14 @@
+#version 410
+#extension GL_ARB_explicit_attrib_location: enable
+
+// pass through vertex shader: screen aligned quad for the FXAA pass
+
+layout (location=0) in vec2 vertex;
+layout (location=1) in vec2 tcoord;
+
+out vec2 texCoord;
+
+void main(void) {
+  texCoord = tcoord;
+  gl_Position = vec4(vertex.x, vertex.y, 0.0, 1.0); //clip space position - already in clip space
+}
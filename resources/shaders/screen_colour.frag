@@ -0,0 +1,12 @@
+#version 410
+
+// flat colour for screen space overlays; alpha controls blending with the image beneath
+
+out vec4 fcolour;
+
+uniform vec4 colour;
+
+void main(void)
+{
+  fcolour = colour;
+}
@@ -0,0 +1,10 @@
+#version 410
+#extension GL_ARB_explicit_attrib_location: enable
+
+// pass through vertex shader: screen aligned quad, position only
+
+layout (location=0) in vec2 vertex;
+
+void main(void) {
+  gl_Position = vec4(vertex.x, vertex.y, 0.0, 1.0); //clip space position - already in clip space
+}